@@ -129,6 +129,17 @@ class MySessionStats : public SessionStats
             return "";
     }
 
+    // Fills dest[] with combined_n() values, taking the stats
+    // from a single snapshot rather than one counter at a time.
+    void combined_values(std::vector<long long> &dest) const
+    {
+        const Snapshot snap = snapshot();
+        for (size_t i = 0; i < N_STATS; ++i)
+            dest.push_back(snap[i]);
+        for (size_t i = 0; i < Error::N_ERRORS; ++i)
+            dest.push_back(errors[i]);
+    }
+
     count_t combined_value(const size_t index) const
     {
         if (index < N_STATS + Error::N_ERRORS)
@@ -1188,9 +1199,15 @@ OPENVPN_CLIENT_EXPORT std::vector<long long> OpenVPNClient::stats_bundle() const
     {
         MySessionStats *stats = state->stats.get();
         if (stats)
+        {
             stats->dco_update();
-        for (size_t i = 0; i < n; ++i)
-            sv.push_back(stats ? stats->combined_value(i) : 0);
+            stats->combined_values(sv);
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+                sv.push_back(0);
+        }
     }
     else
     {
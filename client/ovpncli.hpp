@@ -331,6 +331,49 @@ struct ConfigCommon
     // with all tun builder properties pushed by server.
     // Currently only implemented on Linux.
     bool generateTunBuilderCaptureEvent = false;
+
+    // Receive and send up to this many UDP datagrams per system
+    // call using recvmmsg/sendmmsg. Set to 0 to disable.
+    // Currently only implemented on Linux.
+    int udpBatchSize = 0;
+
+    // When UDP batching is enabled, also try to use UDP
+    // segmentation offload (GSO) for sending and generic
+    // receive offload (GRO) for receiving, if supported
+    // by the kernel.  Currently only implemented on Linux.
+    bool udpSegmentationOffload = false;
+
+    // Open the tun device with IFF_VNET_HDR and TSO/USO offloads,
+    // so that the kernel can pass large TCP/UDP segments which are
+    // split just before encryption.  Currently only implemented
+    // on Linux without tun builder, for layer 3 tunnels.
+    bool tunOffload = false;
+
+    // Submit UDP transport and tun I/O through io_uring, falling
+    // back to the regular code paths if the kernel doesn't support
+    // it.  Currently only implemented on Linux.
+    bool ioUring = false;
+
+    // Resolve all remote hosts up front with this many DNS queries
+    // in flight, instead of one at a time.  Values <= 1 keep the
+    // sequential behavior.  Only used when remotes are resolved
+    // up front, i.e. with tunPersist or happyEyeballs.
+    int resolveParallel = 0;
+
+    // Race connection attempts to all resolved remote addresses,
+    // starting a new one every 250 ms and alternating IPv6 and IPv4
+    // (RFC 8305).  The first server to answer is used and the other
+    // attempts are dropped.  Not used with proxies or dco.
+    bool happyEyeballs = false;
+
+    // Keep resolved remote server addresses in this file, so that
+    // after a restart the client can connect right away to the
+    // address that last worked, while DNS is queried again in the
+    // background.  Entries expire remoteCacheTTL seconds after they
+    // were resolved.  Implies resolving all remotes up front.
+    // Not used with proxies.
+    std::string remoteCacheFile;
+    int remoteCacheTTL = 86400;
 };
 
 // OpenVPN config-file/profile. Includes a few settings that we do not just
@@ -362,6 +405,8 @@ struct Config : public ConfigCommon
     // Compression mode, one of:
     // yes -- allow compression on both uplink and downlink
     // asym -- allow compression on downlink only (i.e. server -> client)
+    // adaptive -- like yes, but LZ4 stops compressing uplink packets
+    //             for a while when recent ones didn't shrink
     // no (default if empty) -- support compression stubs only
     std::string compressionMode;
 
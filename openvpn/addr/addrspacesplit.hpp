@@ -16,6 +16,7 @@
 
 #include <openvpn/common/exception.hpp>
 #include <openvpn/addr/route.hpp>
+#include <openvpn/addr/routetrie.hpp>
 
 namespace openvpn::IP {
 class AddressSpaceSplitter : public RouteList
@@ -36,62 +37,35 @@ class AddressSpaceSplitter : public RouteList
     AddressSpaceSplitter(const RouteList &in, const Addr::VersionMask vermask)
     {
         in.verify_canonical();
-        if (vermask & Addr::V4_MASK)
-            descend(in, Route(Addr::from_zero(Addr::V4), 0));
-        if (vermask & Addr::V6_MASK)
-            descend(in, Route(Addr::from_zero(Addr::V6), 0));
+        RouteTrie<bool> trie;
+        for (const auto &r : in)
+            trie[r] = true;
+        split(trie, vermask);
     }
 
-  private:
-    enum class Type
-    {
-        EQUAL,
-        SUBROUTE,
-        LEAF,
-    };
-    /**
-     * This method construct a non-overlapping list of routes spanning the address
-     * space in @param route.  The routes are constructed in a way that each
-     * route in the returned list is smaller or equalto each route in
-     * parameter @param in
-     *
-     * @param route The route we currently are looking at and split if it does
-     *	      not meet the requirements
-     */
-    void descend(const RouteList &in, const Route &route)
+    template <typename T>
+    AddressSpaceSplitter(const RouteTrie<T> &trie, const Addr::VersionMask vermask)
     {
-        switch (find(in, route))
-        {
-        case Type::SUBROUTE:
-            {
-                Route r1, r2;
-                if (route.split(r1, r2))
-                {
-                    descend(in, r1);
-                    descend(in, r2);
-                }
-                else
-                    push_back(route);
-                break;
-            }
-        case Type::EQUAL:
-        case Type::LEAF:
-            push_back(route);
-            break;
-        }
+        split(trie, vermask);
     }
 
-    static Type find(const RouteList &in, const Route &route)
+  private:
+    /**
+     * This method constructs a non-overlapping list of routes spanning the
+     * address space.  The routes are constructed in a way that each route
+     * in the list is smaller or equal to each route in @param trie that it
+     * overlaps.  The trie yields them in a single traversal, rather than
+     * searching the input for each candidate route.
+     */
+    template <typename T>
+    void split(const RouteTrie<T> &trie, const Addr::VersionMask vermask)
     {
-        Type type = Type::LEAF;
-        for (const auto &r : in)
-        {
-            if (route == r)
-                type = Type::EQUAL;
-            else if (route.contains(r))
-                return Type::SUBROUTE;
-        }
-        return type;
+        auto add = [this](const Route &route)
+        { push_back(route); };
+        if (vermask & Addr::V4_MASK)
+            trie.partition(Addr::V4, add);
+        if (vermask & Addr::V6_MASK)
+            trie.partition(Addr::V6, add);
     }
 };
 } // namespace openvpn::IP
@@ -978,6 +978,20 @@ class Addr
         }
     }
 
+    // bit pos, counting from the least significant bit
+    bool bit(unsigned int pos) const
+    {
+        switch (ver)
+        {
+        case V4:
+            return u.v4.bit(pos);
+        case V6:
+            return u.v6.bit(pos);
+        default:
+            OPENVPN_IP_THROW("bit: address unspecified");
+        }
+    }
+
     // IPv6 scope ID or -1 if not IPv6
     int scope_id() const
     {
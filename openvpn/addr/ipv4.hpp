@@ -447,6 +447,12 @@ class Addr // NOTE: must be union-legal, so default constructor does not initial
         return (u.addr & 0x7F000000) == 0x7F000000;
     }
 
+    // bit pos, counting from the least significant bit
+    bool bit(unsigned int pos) const
+    {
+        return (u.addr >> pos) & 1;
+    }
+
     // number of network bits in netmask,
     // throws exception if addr is not a netmask
     unsigned int prefix_len() const
@@ -12,10 +12,14 @@
 #ifndef OPENVPN_ADDR_POOL_H
 #define OPENVPN_ADDR_POOL_H
 
+#include <algorithm>
+#include <cstdint>
 #include <deque>
-#include <optional>
+#include <iterator>
+#include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <openvpn/common/exception.hpp>
 #include <openvpn/addr/ip.hpp>
@@ -25,6 +29,12 @@ namespace openvpn::IP {
 
 // Maintain a pool of IP addresses.
 // Should be IP::Addr, IPv4::Addr, or IPv6::Addr.
+//
+// Owned addresses are stored as blocks of contiguous addresses, each with
+// a sparse bitmap of addresses in use, split into chunks that only exist
+// while one of their addresses is in use.  Free addresses are queued as
+// runs of contiguous addresses, so memory usage doesn't depend on the
+// size of the ranges added to the pool.
 template <typename ADDR>
 class PoolType
 {
@@ -37,20 +47,36 @@ class PoolType
      */
     void add_range(const RangeType<ADDR> &range)
     {
-        for (const auto &address : range)
+        ADDR addr = range.start();
+        size_t n = range.extent();
+        while (n)
         {
-            add_addr(address);
+            // skip the part of the range that is already owned
+            size_t offset;
+            const auto owner = find_block(addr, offset);
+            if (owner != blocks.end())
+            {
+                const size_t skip = std::min(n, owner->second.extent - offset);
+                addr += static_cast<long>(skip);
+                n -= skip;
+                continue;
+            }
+
+            // add the rest, up to the next owned block
+            size_t len = n;
+            const auto next = blocks.upper_bound(addr);
+            if (next != blocks.end() && next->first <= addr + static_cast<long>(n - 1))
+                len = (next->first - addr).to_ulong();
+            add_block(addr, len);
+            addr += static_cast<long>(len);
+            n -= len;
         }
     }
 
     // Add single address to pool (pool will own the address).
     void add_addr(const ADDR &addr)
     {
-        auto [iter, inserted] = map.try_emplace(addr, false);
-        if (inserted)
-        {
-            freelist.push_back(addr);
-        }
+        add_range(RangeType<ADDR>(addr, 1));
     }
 
     /**
@@ -59,7 +85,7 @@ class PoolType
      */
     [[nodiscard]] size_t n_in_use() const noexcept
     {
-        return map.size() - freelist.size();
+        return n_owned - n_queued;
     }
 
     /**
@@ -68,7 +94,7 @@ class PoolType
      */
     [[nodiscard]] size_t n_free() const noexcept
     {
-        return freelist.size();
+        return n_queued;
     }
 
     // Acquire an address from pool.  Returns true if successful,
@@ -80,18 +106,24 @@ class PoolType
             freelist_fill();
             if (freelist.empty())
                 return false;
-            const ADDR &a = freelist.front();
-            auto e = map.find(a);
-            if (e == map.end()) // any address in freelist must exist in map
-                throw Exception("PoolType: address in freelist doesn't exist in map");
-            if (!e->second)
-            {
-                e->second = true;
-                dest = a;
+            Run &run = freelist.front();
+            const ADDR addr = run.start;
+            if (--run.count)
+                ++run.start;
+            else
                 freelist.pop_front();
+            --n_queued;
+
+            // skip addresses acquired with acquire_specific_addr()
+            size_t offset;
+            const auto owner = find_block(addr, offset);
+            if (owner == blocks.end()) // any address in freelist must be owned
+                throw Exception("PoolType: address in freelist isn't owned by pool");
+            if (set_in_use(owner->second, offset))
+            {
+                dest = addr;
                 return true;
             }
-            freelist.pop_front();
         }
     }
 
@@ -107,13 +139,9 @@ class PoolType
      */
     bool acquire_specific_addr(const ADDR &addr)
     {
-        auto optional_iterator = is_address_available(addr);
-        if (optional_iterator)
-        {
-            (*optional_iterator)->second = true;
-            return true;
-        }
-        return false;
+        size_t offset;
+        const auto owner = find_block(addr, offset);
+        return owner != blocks.end() && set_in_use(owner->second, offset);
     }
 
     // Return a previously acquired address to the pool.  Does nothing if
@@ -121,12 +149,10 @@ class PoolType
     // (b) the address is not owned by the pool.
     void release_addr(const ADDR &addr)
     {
-        auto optional_iterator = is_address_in_use(addr);
-        if (optional_iterator)
-        {
-            freelist.push_back(addr);
-            (*optional_iterator)->second = false;
-        }
+        size_t offset;
+        const auto owner = find_block(addr, offset);
+        if (owner != blocks.end() && clear_in_use(owner->second, offset))
+            queue_free(addr, 1);
     }
 
     // Override to refill freelist on demand
@@ -137,12 +163,24 @@ class PoolType
     std::string to_string() const
     {
         std::string ret;
-        for (const auto &e : map)
+        for (const auto &b : blocks)
         {
-            if (e.second)
+            std::vector<size_t> chunk_indices;
+            for (const auto &c : b.second.chunks)
+                chunk_indices.push_back(c.first);
+            std::sort(chunk_indices.begin(), chunk_indices.end());
+
+            for (const size_t ci : chunk_indices)
             {
-                ret += e.first.to_string();
-                ret += '\n';
+                const Chunk &chunk = b.second.chunks.at(ci);
+                for (size_t i = 0; i < CHUNK_BITS; ++i)
+                {
+                    if (chunk.words[i / 64] & (std::uint64_t(1) << (i % 64)))
+                    {
+                        ret += (b.first + static_cast<long>(ci * CHUNK_BITS + i)).to_string();
+                        ret += '\n';
+                    }
+                }
             }
         }
         return ret;
@@ -151,32 +189,119 @@ class PoolType
     virtual ~PoolType() = default;
 
   private:
-    std::deque<ADDR> freelist;
-    std::unordered_map<ADDR, bool> map;
+    enum
+    {
+        CHUNK_WORDS = 64,
+        CHUNK_BITS = CHUNK_WORDS * 64,
+    };
 
-    /**
-     * @brief Checks if address is available (free)
-     * @param addr IP Address to check
-     * @return Optional iterator to position; std::nullopt if address is not available
-     */
-    auto is_address_available(const ADDR &addr) -> std::optional<decltype(map.begin())> // Easy decltype for map iterator
+    // in-use bits of CHUNK_BITS consecutive addresses
+    struct Chunk
+    {
+        std::uint64_t words[CHUNK_WORDS] = {};
+        size_t n_in_use = 0;
+    };
+
+    // contiguous addresses owned by the pool, keyed by first address
+    struct Block
+    {
+        ADDR last;
+        size_t extent;
+        std::unordered_map<size_t, Chunk> chunks; // chunks without addresses in use are omitted
+    };
+
+    typedef std::map<ADDR, Block> BlockMap;
+
+    // contiguous free addresses
+    struct Run
     {
-        auto it = map.find(addr);
-        if (it != map.end() && !it->second)
-            return it;
-        return std::nullopt;
+        ADDR start;
+        size_t count;
+    };
+
+    std::deque<Run> freelist;
+    BlockMap blocks;
+    size_t n_owned = 0;
+    size_t n_queued = 0;
+
+    // Returns the block that owns addr, with the offset of addr in it,
+    // or blocks.end() if addr is not owned by the pool
+    typename BlockMap::iterator find_block(const ADDR &addr, size_t &offset)
+    {
+        auto i = blocks.upper_bound(addr);
+        if (i == blocks.begin())
+            return blocks.end();
+        --i;
+        if (i->second.last < addr)
+            return blocks.end();
+        offset = (addr - i->first).to_ulong();
+        return i;
     }
 
-    /**
-     * @brief Checks if address is in use
-     * @param addr IP Address to check
-     * @return Optional containing iterator to position if found, std::nullopt otherwise
-     */
-    auto is_address_in_use(const ADDR &addr) -> std::optional<decltype(map.begin())> // Easy decltype for map iterator
+    // add len addresses starting at addr, none of which are owned yet
+    void add_block(const ADDR &addr, const size_t len)
+    {
+        const auto next = blocks.upper_bound(addr);
+        bool extended = false;
+        if (next != blocks.begin())
+        {
+            Block &prev = std::prev(next)->second;
+            if (prev.last < addr && prev.last + 1 == addr)
+            {
+                prev.last += static_cast<long>(len);
+                prev.extent += len;
+                extended = true;
+            }
+        }
+        if (!extended)
+            blocks.emplace_hint(next, addr, Block{addr + static_cast<long>(len - 1), len, {}});
+        n_owned += len;
+        queue_free(addr, len);
+    }
+
+    void queue_free(const ADDR &addr, const size_t len)
+    {
+        if (!freelist.empty())
+        {
+            Run &back = freelist.back();
+            if (back.start < addr && back.start + static_cast<long>(back.count) == addr)
+            {
+                back.count += len;
+                n_queued += len;
+                return;
+            }
+        }
+        freelist.push_back(Run{addr, len});
+        n_queued += len;
+    }
+
+    // Mark address in use, returns false if it already was
+    static bool set_in_use(Block &block, const size_t offset)
+    {
+        Chunk &chunk = block.chunks[offset / CHUNK_BITS];
+        std::uint64_t &word = chunk.words[(offset % CHUNK_BITS) / 64];
+        const std::uint64_t mask = std::uint64_t(1) << (offset % 64);
+        if (word & mask)
+            return false;
+        word |= mask;
+        ++chunk.n_in_use;
+        return true;
+    }
+
+    // Mark address free, returns false if it already was
+    static bool clear_in_use(Block &block, const size_t offset)
     {
-        if (auto it = map.find(addr); it != map.end())
-            return it;
-        return std::nullopt;
+        const auto c = block.chunks.find(offset / CHUNK_BITS);
+        if (c == block.chunks.end())
+            return false;
+        std::uint64_t &word = c->second.words[(offset % CHUNK_BITS) / 64];
+        const std::uint64_t mask = std::uint64_t(1) << (offset % 64);
+        if (!(word & mask))
+            return false;
+        word &= ~mask;
+        if (!--c->second.n_in_use)
+            block.chunks.erase(c);
+        return true;
     }
 };
 
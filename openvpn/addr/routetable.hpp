@@ -0,0 +1,535 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Longest-prefix-match table of IPv4 and IPv6 routes, with a value of
+// type T attached to each route, for example to find the client session
+// that a packet read from the server tun device should be sent to.
+//
+// The table is changed by a single writer thread, while any number of
+// reader threads look up addresses without locking.  Changes made by
+// the writer are batched until commit(), which builds an immutable
+// snapshot of the table and publishes it to the readers.  Old snapshots
+// are deleted by a later commit() once no reader can still use them.
+//
+// IPv4 snapshots use a DIR-16-8-8 multibit trie, so that a lookup takes
+// at most three memory accesses.  IPv6 snapshots keep host routes, such
+// as the addresses of client sessions, in a hash table, and other routes
+// in a path-compressed binary trie stored in a vector.
+//
+// Readers copy the value out of the snapshot, so T should be cheap to
+// copy and safe to copy concurrently, such as a session ID or a raw
+// pointer.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <openvpn/common/exception.hpp>
+#include <openvpn/common/ffs.hpp>
+#include <openvpn/addr/ip.hpp>
+#include <openvpn/addr/route.hpp>
+#include <openvpn/ip/ipcommon.hpp>
+#include <openvpn/ip/ip4.hpp>
+#include <openvpn/ip/ip6.hpp>
+
+namespace openvpn::IP {
+
+template <typename T>
+class RouteTable
+{
+  private:
+    class Snapshot;
+
+    struct alignas(64) Slot
+    {
+        // epoch of the commit that the reader saw, or 0 if not in a lookup
+        std::atomic<std::uint64_t> epoch{0};
+    };
+
+  public:
+    // Looks up addresses on behalf of a single thread.  All readers must
+    // be destroyed before the table.
+    class Reader
+    {
+      public:
+        explicit Reader(RouteTable &table_arg)
+            : table(table_arg)
+        {
+            std::lock_guard<std::mutex> lock(table.readers_mutex);
+            table.readers.push_back(&slot);
+        }
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        ~Reader()
+        {
+            std::lock_guard<std::mutex> lock(table.readers_mutex);
+            auto &r = table.readers;
+            r.erase(std::remove(r.begin(), r.end(), &slot), r.end());
+        }
+
+        // Find the value of the longest route containing addr,
+        // returns false if no route contains addr.
+        bool lookup(const IPv4::Addr &addr, T &value)
+        {
+            const Snapshot *s = enter();
+            const bool ret = s->get(s->lookup4(addr.to_uint32()), value);
+            leave();
+            return ret;
+        }
+
+        bool lookup(const IPv6::Addr &addr, T &value)
+        {
+            const Snapshot *s = enter();
+            const bool ret = s->get(s->lookup6(Snapshot::key6(addr)), value);
+            leave();
+            return ret;
+        }
+
+        bool lookup(const Addr &addr, T &value)
+        {
+            switch (addr.version())
+            {
+            case Addr::V4:
+                return lookup(addr.to_ipv4_nocheck(), value);
+            case Addr::V6:
+                return lookup(addr.to_ipv6_nocheck(), value);
+            default:
+                return false;
+            }
+        }
+
+        // Look up the destination address of an IPv4 or IPv6 packet,
+        // returns false for truncated or non-IP packets.
+        bool lookup_packet(const unsigned char *data, const size_t size, T &value)
+        {
+            if (!size)
+                return false;
+            switch (IPCommon::version(data[0]))
+            {
+            case IPCommon::IPv4:
+                {
+                    if (size < sizeof(IPv4Header))
+                        return false;
+                    std::uint32_t daddr;
+                    std::memcpy(&daddr, data + offsetof(IPv4Header, daddr), sizeof(daddr));
+                    return lookup(IPv4::Addr::from_uint32_net(daddr), value);
+                }
+            case IPCommon::IPv6:
+                {
+                    if (size < sizeof(IPv6Header))
+                        return false;
+                    const Snapshot *s = enter();
+                    const bool ret = s->get(s->lookup6(Snapshot::key6(data + offsetof(IPv6Header, daddr))), value);
+                    leave();
+                    return ret;
+                }
+            default:
+                return false;
+            }
+        }
+
+      private:
+        const Snapshot *enter()
+        {
+            // the seq_cst store must precede the load of the snapshot
+            slot.epoch.store(table.epoch.load());
+            return table.current.load();
+        }
+
+        void leave()
+        {
+            slot.epoch.store(0, std::memory_order_release);
+        }
+
+        RouteTable &table;
+        Slot slot;
+    };
+
+    OPENVPN_EXCEPTION(route_table_error);
+
+    RouteTable()
+        : current(new Snapshot())
+    {
+    }
+
+    RouteTable(const RouteTable &) = delete;
+    RouteTable &operator=(const RouteTable &) = delete;
+
+    ~RouteTable()
+    {
+        delete current.load();
+    }
+
+    // Add route or replace its value, route must be canonical.
+    // Not visible to readers before commit().
+    void add(const Route &route, T value)
+    {
+        route.verify_canonical();
+        if (route.version() != Addr::V4 && route.version() != Addr::V6)
+            throw route_table_error("address unspecified");
+        routes[route] = std::move(value);
+    }
+
+    // Remove route, returns false if it wasn't in the table.
+    // Not visible to readers before commit().
+    bool remove(const Route &route)
+    {
+        return routes.erase(route) > 0;
+    }
+
+    // Remove all routes with value, such as the routes of a
+    // disconnected session.  Returns the number of routes removed.
+    size_t remove_value(const T &value)
+    {
+        size_t n = 0;
+        for (auto i = routes.begin(); i != routes.end();)
+        {
+            if (i->second == value)
+            {
+                i = routes.erase(i);
+                ++n;
+            }
+            else
+                ++i;
+        }
+        return n;
+    }
+
+    void clear()
+    {
+        routes.clear();
+    }
+
+    // number of routes, including uncommitted changes
+    size_t size() const
+    {
+        return routes.size();
+    }
+
+    // Publish the changes since the last commit() to readers,
+    // and delete snapshots that readers no longer use.
+    void commit()
+    {
+        std::unique_ptr<const Snapshot> s(new Snapshot(routes));
+        const Snapshot *old = current.exchange(s.release());
+        retired.emplace_back(epoch.fetch_add(1), std::unique_ptr<const Snapshot>(old));
+        reclaim();
+    }
+
+  private:
+    class Snapshot
+    {
+      public:
+        Snapshot()
+            : tbl16(1 << 16, 0)
+        {
+        }
+
+        // std::map orders routes by prefix length first, so longer
+        // routes overwrite the entries of the shorter ones containing them
+        explicit Snapshot(const std::map<Route, T> &routes)
+            : Snapshot()
+        {
+            values.reserve(routes.size());
+            for (const auto &r : routes)
+            {
+                values.push_back(r.second);
+                const auto entry = static_cast<std::uint32_t>(values.size());
+                if (r.first.version() == Addr::V4)
+                    add4(r.first.addr.to_ipv4_nocheck().to_uint32(), r.first.prefix_len, entry);
+                else if (r.first.prefix_len == 128)
+                    hosts6[key6(r.first.addr.to_ipv6_nocheck())] = entry;
+                else
+                    add6(key6(r.first.addr.to_ipv6_nocheck()), r.first.prefix_len, entry);
+            }
+        }
+
+        std::uint32_t lookup4(const std::uint32_t addr) const
+        {
+            std::uint32_t e = tbl16[addr >> 16];
+            if (e & GROUP)
+            {
+                e = tbl8[group_base(e) + ((addr >> 8) & 0xFF)];
+                if (e & GROUP)
+                    e = tbl8[group_base(e) + (addr & 0xFF)];
+            }
+            return e;
+        }
+
+        // IPv6 address as 32-bit words, most significant first
+        typedef std::array<std::uint32_t, 4> Key6;
+
+        static Key6 key6(const unsigned char *bytes)
+        {
+            Key6 key;
+            for (size_t i = 0; i < key.size(); ++i, bytes += 4)
+                key[i] = (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) | (std::uint32_t(bytes[2]) << 8) | bytes[3];
+            return key;
+        }
+
+        static Key6 key6(const IPv6::Addr &addr)
+        {
+            unsigned char bytes[16];
+            addr.to_byte_string(bytes);
+            return key6(bytes);
+        }
+
+        // Descend by testing one bit per node, then check prefixes from
+        // the bottom up.  A node's prefix is also the prefix of its
+        // descendants, so the first matching node and its ancestors match.
+        std::uint32_t lookup6(const Key6 &key) const
+        {
+            if (!hosts6.empty())
+            {
+                const auto h = hosts6.find(key);
+                if (h != hosts6.end())
+                    return h->second;
+            }
+
+            const Node6 *path[129];
+            size_t depth = 0;
+            for (std::uint32_t i = root6; i;)
+            {
+                const Node6 &n = nodes6[i];
+                if (n.entry)
+                    path[depth++] = &n;
+                if (n.prefix_len == 128)
+                    break;
+                i = n.child[bit(key, n.prefix_len)];
+            }
+            while (depth--)
+            {
+                const Node6 &n = *path[depth];
+                if (common_prefix_len(n.key, key, n.prefix_len) == n.prefix_len)
+                    return n.entry;
+            }
+            return 0;
+        }
+
+        bool get(const std::uint32_t entry, T &value) const
+        {
+            if (!entry)
+                return false;
+            value = values[entry - 1];
+            return true;
+        }
+
+      private:
+        // An entry is 0 for no route, the index + 1 of a value,
+        // or GROUP | the index of a group of 256 entries in tbl8.
+        static constexpr std::uint32_t GROUP = 0x80000000;
+
+        static size_t group_base(const std::uint32_t entry)
+        {
+            return size_t(entry & ~GROUP) << 8;
+        }
+
+        void add4(const std::uint32_t addr, const unsigned int prefix_len, const std::uint32_t entry)
+        {
+            if (prefix_len <= 16)
+            {
+                fill(tbl16, addr >> 16, 1u << (16 - prefix_len), entry);
+                return;
+            }
+            const size_t g2 = group(tbl16, addr >> 16) + ((addr >> 8) & 0xFF);
+            if (prefix_len <= 24)
+            {
+                fill(tbl8, g2, 1u << (24 - prefix_len), entry);
+                return;
+            }
+            fill(tbl8, group(tbl8, g2) + (addr & 0xFF), 1u << (32 - prefix_len), entry);
+        }
+
+        // Returns the tbl8 index of the group below tbl[i], adding it
+        // if needed.  A new group inherits the entry it replaces.
+        size_t group(std::vector<std::uint32_t> &tbl, const size_t i)
+        {
+            if (!(tbl[i] & GROUP))
+            {
+                const size_t g = tbl8.size() >> 8;
+                if (g >= GROUP)
+                    throw route_table_error("too many IPv4 routes");
+                const std::uint32_t inherit = tbl[i]; // tbl may be tbl8
+                tbl8.resize(tbl8.size() + 256, inherit);
+                tbl[i] = GROUP | static_cast<std::uint32_t>(g);
+            }
+            return group_base(tbl[i]);
+        }
+
+        struct Key6Hash
+        {
+            size_t operator()(const Key6 &key) const
+            {
+                const std::uint64_t h = ((std::uint64_t(key[0]) << 32 | key[1]) * 0x9E3779B97F4A7C15ULL)
+                                        ^ ((std::uint64_t(key[2]) << 32 | key[3]) * 0xC2B2AE3D27D4EB4FULL);
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+        };
+
+        // Every node is a route or a branch point between two subtrees,
+        // as in RouteTrie.  Children are indices in nodes6, 0 for none.
+        struct Node6
+        {
+            Key6 key;
+            unsigned int prefix_len;
+            std::uint32_t entry; // 0 for branch points
+            std::uint32_t child[2];
+        };
+
+        void add6(const Key6 &key, const unsigned int prefix_len, const std::uint32_t entry)
+        {
+            // the link to follow is child[side] of parent, or root6 if parent is 0
+            std::uint32_t parent = 0;
+            unsigned int side = 0;
+            while (true)
+            {
+                const std::uint32_t i = link6(parent, side);
+                if (!i)
+                {
+                    const std::uint32_t leaf = new_node6(key, prefix_len, entry);
+                    link6(parent, side) = leaf;
+                    return;
+                }
+
+                const Node6 n = nodes6[i];
+                const unsigned int common = common_prefix_len(n.key, key, std::min(n.prefix_len, prefix_len));
+                if (common == n.prefix_len)
+                {
+                    // n contains route
+                    if (common == prefix_len)
+                    {
+                        nodes6[i].entry = entry;
+                        return;
+                    }
+                    parent = i;
+                    side = bit(key, common);
+                    continue;
+                }
+
+                // route contains n, or they diverge below a new branch point
+                std::uint32_t b;
+                if (common == prefix_len)
+                    b = new_node6(key, prefix_len, entry);
+                else
+                {
+                    const std::uint32_t leaf = new_node6(key, prefix_len, entry);
+                    b = new_node6(mask6(key, common), common, 0);
+                    nodes6[b].child[bit(key, common)] = leaf;
+                }
+                nodes6[b].child[bit(n.key, common)] = i;
+                link6(parent, side) = b;
+                return;
+            }
+        }
+
+        std::uint32_t &link6(const std::uint32_t parent, const unsigned int side)
+        {
+            return parent ? nodes6[parent].child[side] : root6;
+        }
+
+        std::uint32_t new_node6(const Key6 &key, const unsigned int prefix_len, const std::uint32_t entry)
+        {
+            if (nodes6.empty())
+                nodes6.emplace_back(); // index 0 is unused
+            nodes6.push_back(Node6{key, prefix_len, entry, {0, 0}});
+            return static_cast<std::uint32_t>(nodes6.size() - 1);
+        }
+
+        // bit i of key, counting from the most significant bit
+        static unsigned int bit(const Key6 &key, const unsigned int i)
+        {
+            return (key[i >> 5] >> (31 - (i & 31))) & 1;
+        }
+
+        // length of the common prefix of k1 and k2, up to max_len
+        static unsigned int common_prefix_len(const Key6 &k1, const Key6 &k2, const unsigned int max_len)
+        {
+            for (unsigned int i = 0; i < k1.size() && i * 32 < max_len; ++i)
+            {
+                const std::uint32_t x = k1[i] ^ k2[i];
+                if (x)
+                    return std::min(i * 32 + 32 - find_last_set(x), max_len);
+            }
+            return max_len;
+        }
+
+        static Key6 mask6(Key6 key, const unsigned int prefix_len)
+        {
+            for (unsigned int i = 0; i < key.size(); ++i)
+            {
+                if (prefix_len <= i * 32)
+                    key[i] = 0;
+                else if (prefix_len < i * 32 + 32)
+                    key[i] &= ~std::uint32_t(0) << (i * 32 + 32 - prefix_len);
+            }
+            return key;
+        }
+
+        static void fill(std::vector<std::uint32_t> &tbl, const size_t i, const size_t n, const std::uint32_t entry)
+        {
+            std::fill(tbl.begin() + i, tbl.begin() + i + n, entry);
+        }
+
+        std::vector<T> values;
+        std::vector<std::uint32_t> tbl16;
+        std::vector<std::uint32_t> tbl8;
+        std::unordered_map<Key6, std::uint32_t, Key6Hash> hosts6;
+        std::vector<Node6> nodes6;
+        std::uint32_t root6 = 0;
+    };
+
+    // Delete retired snapshots that were replaced before
+    // every ongoing lookup started.
+    void reclaim()
+    {
+        std::uint64_t min_epoch = UINT64_MAX;
+        {
+            std::lock_guard<std::mutex> lock(readers_mutex);
+            for (const Slot *slot : readers)
+            {
+                const std::uint64_t e = slot->epoch.load();
+                if (e && e < min_epoch)
+                    min_epoch = e;
+            }
+        }
+        retired.erase(std::remove_if(retired.begin(),
+                                     retired.end(),
+                                     [min_epoch](const auto &r)
+                                     { return r.first < min_epoch; }),
+                      retired.end());
+    }
+
+    std::map<Route, T> routes;
+
+    std::atomic<const Snapshot *> current;
+    std::atomic<std::uint64_t> epoch{1};
+
+    // snapshots replaced by commit(), with the epoch before the commit
+    std::vector<std::pair<std::uint64_t, std::unique_ptr<const Snapshot>>> retired;
+
+    std::mutex readers_mutex;
+    std::vector<const Slot *> readers;
+};
+
+} // namespace openvpn::IP
@@ -0,0 +1,187 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Path-compressed binary trie (Patricia trie) of IPv4 and IPv6 routes,
+// with a value of type T attached to each route.
+//
+// Every node is either a route that was inserted, or a branch point
+// between two subtrees, so the trie has less than 2N nodes for N routes.
+// Inserting and looking up a route costs O(W) for address width W,
+// regardless of the number of routes.
+
+#pragma once
+
+#include <memory>
+
+#include <openvpn/common/exception.hpp>
+#include <openvpn/addr/route.hpp>
+
+namespace openvpn::IP {
+
+template <typename T>
+class RouteTrie
+{
+  public:
+    OPENVPN_EXCEPTION(route_trie_error);
+
+    // Return the value of route, which is default-constructed
+    // if route wasn't inserted before.  Route must be canonical.
+    T &operator[](const Route &route)
+    {
+        route.verify_canonical();
+        std::unique_ptr<Node> *link = &root(route.version());
+        while (true)
+        {
+            Node *n = link->get();
+            if (!n)
+            {
+                link->reset(new Node(route, true));
+                return (*link)->value;
+            }
+
+            const unsigned int common = common_prefix_len(n->route, route);
+            if (common == n->route.prefix_len)
+            {
+                // n contains route
+                if (common == route.prefix_len)
+                {
+                    n->set = true;
+                    return n->value;
+                }
+                link = &n->child[bit(route.addr, common)];
+                continue;
+            }
+
+            // route contains n, or they diverge below a new branch point
+            std::unique_ptr<Node> node;
+            if (common == route.prefix_len)
+                node.reset(new Node(route, true));
+            else
+                node.reset(new Node(Route(route.addr & Addr::netmask_from_prefix_len(route.version(), common), common), false));
+            node->child[bit(n->route.addr, common)] = std::move(*link);
+            *link = std::move(node);
+            if (common == route.prefix_len)
+                return (*link)->value;
+
+            Node *leaf = new Node(route, true);
+            (*link)->child[bit(route.addr, common)].reset(leaf);
+            return leaf->value;
+        }
+    }
+
+    // Call fn(route, value) for each inserted route that contains route,
+    // from the shortest to the longest prefix.
+    template <typename FUNC>
+    void match(const Route &route, FUNC fn) const
+    {
+        const Node *n = root(route.version()).get();
+        while (n && n->route.contains(route))
+        {
+            if (n->set)
+                fn(n->route, n->value);
+            if (n->route.prefix_len == route.prefix_len)
+                break;
+            n = n->child[bit(route.addr, n->route.prefix_len)].get();
+        }
+    }
+
+    // Split the whole address space of version v into non-overlapping
+    // routes, and call fn(route) for each of them in address order.
+    // The routes are as large as possible, provided that each of them
+    // is either contained in or disjoint from every inserted route.
+    template <typename FUNC>
+    void partition(const Addr::Version v, FUNC fn) const
+    {
+        partition(root(v).get(), Route(Addr::from_zero(v), 0), fn);
+    }
+
+    bool empty() const
+    {
+        return !root4 && !root6;
+    }
+
+  private:
+    struct Node
+    {
+        Node(const Route &route_arg, const bool set_arg)
+            : route(route_arg),
+              set(set_arg)
+        {
+        }
+
+        Route route;
+        bool set; // false for branch points
+        T value{};
+        std::unique_ptr<Node> child[2];
+    };
+
+    // n is the shortest node within route, or nullptr
+    template <typename FUNC>
+    static void partition(const Node *n, const Route &route, FUNC &fn)
+    {
+        if (!n || (n->route.prefix_len == route.prefix_len && !n->child[0] && !n->child[1]))
+        {
+            fn(route);
+            return;
+        }
+
+        // a shorter route is inside, so split
+        Route half[2];
+        route.split(half[0], half[1]);
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            const Node *c = nullptr;
+            if (n->route.prefix_len == route.prefix_len)
+                c = n->child[i].get();
+            else if (bit(n->route.addr, route.prefix_len) == i)
+                c = n;
+            partition(c, half[i], fn);
+        }
+    }
+
+    // bit i of addr, counting from the most significant bit
+    static unsigned int bit(const Addr &addr, const unsigned int i)
+    {
+        return addr.bit(addr.size() - 1 - i);
+    }
+
+    static unsigned int common_prefix_len(const Route &r1, const Route &r2)
+    {
+        const unsigned int len = std::min(r1.prefix_len, r2.prefix_len);
+        unsigned int i = 0;
+        while (i < len && bit(r1.addr, i) == bit(r2.addr, i))
+            ++i;
+        return i;
+    }
+
+    std::unique_ptr<Node> &root(const Addr::Version v)
+    {
+        switch (v)
+        {
+        case Addr::V4:
+            return root4;
+        case Addr::V6:
+            return root6;
+        default:
+            throw route_trie_error("address unspecified");
+        }
+    }
+
+    const std::unique_ptr<Node> &root(const Addr::Version v) const
+    {
+        return const_cast<RouteTrie *>(this)->root(v);
+    }
+
+    std::unique_ptr<Node> root4;
+    std::unique_ptr<Node> root6;
+};
+
+} // namespace openvpn::IP
@@ -53,6 +53,7 @@
 #include <openvpn/common/exception.hpp>
 #include <openvpn/common/rc.hpp>
 #include <openvpn/buffer/bufclamp.hpp>
+#include <openvpn/buffer/bufpool.hpp>
 #include <openvpn/common/make_rc.hpp>
 
 #ifdef OPENVPN_BUFFER_ABORT
@@ -868,6 +869,7 @@ struct BufAllocFlags
         DESTRUCT_ZERO = (1 << 1),  ///< if enabled, destructor will zero data before deletion
         GROW = (1 << 2),           ///< if enabled, buffer will grow (otherwise buffer_full exception will be thrown)
         ARRAY = (1 << 3),          ///< if enabled, use as array
+        POOL = (1 << 4),           ///< if enabled, recycle storage through a per-thread BufferPool
     };
 };
 
@@ -1061,6 +1063,13 @@ class BufferAllocatedType : public BufferType<T>
     void free_data();
 
   private:
+    /**
+     * @brief Allocates storage for the buffer, from the per-thread pool if requested.
+     * @param capacity The capacity to allocate.
+     * @param flags The flags for the buffer.
+     */
+    static T *alloc_data(const size_t capacity, const unsigned int flags);
+
     unsigned int flags_;
 };
 
@@ -1635,7 +1644,7 @@ ConstBufferType<T>::ConstBufferType(const U *data, const size_t offset, const si
 
 template <typename T>
 BufferAllocatedType<T>::BufferAllocatedType(const size_t offset, const size_t size, const size_t capacity, const unsigned int flags)
-    : BufferType<T>(capacity ? new T[capacity] : nullptr, offset, size, capacity), flags_(flags)
+    : BufferType<T>(capacity ? alloc_data(capacity, flags) : nullptr, offset, size, capacity), flags_(flags)
 {
     if (flags & BufAllocFlags::CONSTRUCT_ZERO)
         std::memset(data_raw(), 0, capacity * sizeof(T));
@@ -1820,7 +1829,18 @@ void BufferAllocatedType<T>::free_data()
 {
     if (size() && (flags_ & BufAllocFlags::DESTRUCT_ZERO))
         std::memset(data_raw(), 0, capacity() * sizeof(T));
-    delete[] data_raw();
+    if (flags_ & BufAllocFlags::POOL)
+        BufferPool<T>::free(data_raw(), capacity());
+    else
+        delete[] data_raw();
+}
+
+template <typename T>
+T *BufferAllocatedType<T>::alloc_data(const size_t capacity, const unsigned int flags)
+{
+    if (flags & BufAllocFlags::POOL)
+        return BufferPool<T>::alloc(capacity);
+    return new T[capacity];
 }
 
 //  ===============================================================================================
@@ -0,0 +1,153 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace openvpn {
+
+/**
+   @brief Per-thread cache of fixed-size buffer allocations.
+   @details Used by BufferAllocatedType for buffers that have the BufAllocFlags::POOL
+            flag set.  Packet buffers are allocated with the capacity of a Frame::Context,
+            and all contexts of a Frame are standardized to the same capacity, so a few
+            exact-size classes per thread are enough to turn steady-state packet
+            forwarding into free-list pushes and pops.  Blocks always come from, and
+            are eventually returned to, new[]/delete[], so a pooled block may be freed
+            on any thread or by a buffer that doesn't have the POOL flag.
+ */
+template <typename T>
+class BufferPool
+{
+  public:
+    enum
+    {
+        MAX_CLASSES = 4,  ///< distinct capacities cached per thread
+        MAX_FREE = 256,   ///< blocks cached per capacity
+    };
+
+    static T *alloc(const size_t capacity)
+    {
+        if (Cache *c = cache())
+        {
+            if (SizeClass *sc = c->find(capacity))
+            {
+                if (!sc->free.empty())
+                {
+                    T *data = sc->free.back();
+                    sc->free.pop_back();
+                    return data;
+                }
+            }
+        }
+        return new T[capacity];
+    }
+
+    static void free(T *data, const size_t capacity)
+    {
+        if (Cache *c = cache())
+        {
+            if (SizeClass *sc = c->find_or_add(capacity))
+            {
+                if (sc->free.size() < MAX_FREE)
+                {
+                    sc->free.push_back(data);
+                    return;
+                }
+            }
+        }
+        delete[] data;
+    }
+
+    // number of blocks of the given capacity cached by the calling thread
+    static size_t cached(const size_t capacity)
+    {
+        if (Cache *c = cache())
+        {
+            if (SizeClass *sc = c->find(capacity))
+                return sc->free.size();
+        }
+        return 0;
+    }
+
+    // release all blocks cached by the calling thread
+    static void drain()
+    {
+        if (Cache *c = cache())
+            c->clear();
+    }
+
+  private:
+    struct SizeClass
+    {
+        size_t capacity = 0;
+        std::vector<T *> free;
+    };
+
+    struct Cache
+    {
+        ~Cache()
+        {
+            clear();
+            dead() = true;
+        }
+
+        SizeClass *find(const size_t capacity)
+        {
+            for (auto &sc : classes)
+                if (sc.capacity == capacity)
+                    return &sc;
+            return nullptr;
+        }
+
+        SizeClass *find_or_add(const size_t capacity)
+        {
+            if (SizeClass *sc = find(capacity))
+                return sc;
+            if (classes.size() >= MAX_CLASSES)
+                return nullptr;
+            classes.emplace_back();
+            classes.back().capacity = capacity;
+            classes.back().free.reserve(MAX_FREE);
+            return &classes.back();
+        }
+
+        void clear()
+        {
+            for (auto &sc : classes)
+                for (T *data : sc.free)
+                    delete[] data;
+            classes.clear();
+        }
+
+        std::vector<SizeClass> classes;
+    };
+
+    // Buffers may be freed during thread or static teardown after
+    // the cache itself has been destroyed; they bypass the cache then.
+    static bool &dead()
+    {
+        thread_local bool d = false;
+        return d;
+    }
+
+    static Cache *cache()
+    {
+        if (dead())
+            return nullptr;
+        thread_local Cache c;
+        return &c;
+    }
+};
+
+} // namespace openvpn
@@ -40,6 +40,8 @@
 #define OPENVPN_CLIENT_CLICONNECT_H
 
 #include <memory>
+#include <vector>
+#include <algorithm>
 #include <utility>
 #include <chrono>
 using namespace std::chrono_literals;
@@ -83,7 +85,8 @@ class ClientConnect : ClientProto::NotifyCallback,
           server_poll_timer(io_context_arg),
           restart_wait_timer(io_context_arg),
           conn_timer(io_context_arg),
-          conn_timer_pending(false)
+          conn_timer_pending(false),
+          race_timer(io_context_arg)
     {
     }
 
@@ -98,11 +101,18 @@ class ClientConnect : ClientProto::NotifyCallback,
             RemoteList::BulkResolve::Ptr bulkres(new RemoteList::BulkResolve(io_context,
                                                                              remote_list,
                                                                              client_options->stats_ptr()));
+            bulkres->set_max_parallel(client_options->resolve_parallel());
             if (bulkres->work_available())
             {
                 ClientEvent::Base::Ptr ev = new ClientEvent::Resolve();
                 client_options->events().add_event(std::move(ev));
                 bulk_resolve = bulkres;
+
+                // With addresses from the persistent remote cache, connect
+                // to the last good one right away and refresh the cache in
+                // the background.
+                if (client_options->remote_cache_preloaded())
+                    new_client();
                 bulk_resolve->start(this); // asynchronous -- will call back to bulk_resolve_done
             }
             else
@@ -130,6 +140,7 @@ class ClientConnect : ClientProto::NotifyCallback,
             halt = true;
             if (bulk_resolve)
                 bulk_resolve->cancel();
+            race_cancel();
             if (client)
             {
                 client->tun_set_disconnect();
@@ -175,6 +186,7 @@ class ClientConnect : ClientProto::NotifyCallback,
         if (!halt && !paused)
         {
             paused = true;
+            race_cancel();
             if (client)
             {
                 client->send_explicit_exit_notify();
@@ -300,6 +312,48 @@ class ClientConnect : ClientProto::NotifyCallback,
     }
 
   private:
+    // One of the connection attempts raced in happy eyeballs mode.
+    // Forwards the callbacks of its session to ClientConnect.
+    struct Racer : public ClientProto::NotifyCallback, public RC<thread_unsafe_refcount>
+    {
+        typedef RCPtr<Racer> Ptr;
+
+        Racer(ClientConnect *parent_arg, const RemoteList::Candidate &candidate_arg)
+            : parent(parent_arg),
+              candidate(candidate_arg)
+        {
+        }
+
+        void client_proto_terminate() override
+        {
+            parent->race_terminate(this);
+        }
+
+        void client_proto_first_packet() override
+        {
+            parent->race_first_packet(this);
+        }
+
+        void client_proto_connected() override
+        {
+            parent->client_proto_connected();
+        }
+
+        void client_proto_auth_pending_timeout(int timeout) override
+        {
+            parent->client_proto_auth_pending_timeout(timeout);
+        }
+
+        void client_proto_renegotiated() override
+        {
+            parent->client_proto_renegotiated();
+        }
+
+        ClientConnect *parent;
+        const RemoteList::Candidate candidate;
+        Client::Ptr client;
+    };
+
     void interim_finalize()
     {
         if (!client_finalized)
@@ -313,6 +367,8 @@ class ClientConnect : ClientProto::NotifyCallback,
     {
         if (!halt && generation == 0)
             new_client();
+        else if (!halt && client && client->reached_connected_state())
+            client_options->remote_cache_save(client->server_endpoint_addr());
     }
 
     void cancel_timers()
@@ -340,7 +396,7 @@ class ClientConnect : ClientProto::NotifyCallback,
 
     void server_poll_callback(unsigned int gen, const openvpn_io::error_code &e)
     {
-        if (!e && gen == generation && !halt && !client->first_packet_received())
+        if (!e && gen == generation && !halt && !(client && client->first_packet_received()))
         {
             OPENVPN_LOG("Server poll timeout, trying next remote entry...");
             new_client();
@@ -395,6 +451,8 @@ class ClientConnect : ClientProto::NotifyCallback,
         conn_timer.cancel();
         conn_timer_pending = false;
 
+        client_options->remote_cache_save(client->server_endpoint_addr());
+
         // Monitor connection lifecycle notifications, such as sleep,
         // wakeup, network-unavailable, and network-available.
         // Not all platforms define a lifecycle object.  Some platforms
@@ -657,9 +715,17 @@ class ClientConnect : ClientProto::NotifyCallback,
                 client_options->remote_reset_cache_item();
         }
 
-        // client_config in cliopt.hpp
-        Client::Config::Ptr cli_config = client_options->client_config(!transport_factory_relay);
-        client.reset(new Client(io_context, *cli_config, this)); // build ClientProto::Session from cliproto.hpp
+        race_cancel();
+        race_winner.reset();
+        const bool race = race_prepare();
+        if (race)
+            client.reset(); // set by race_first_packet()
+        else
+        {
+            // client_config in cliopt.hpp
+            Client::Config::Ptr cli_config = client_options->client_config(!transport_factory_relay);
+            client.reset(new Client(io_context, *cli_config, this)); // build ClientProto::Session from cliproto.hpp
+        }
         client_finalized = false;
 
         // relay?
@@ -679,7 +745,103 @@ class ClientConnect : ClientProto::NotifyCallback,
                                          self->server_poll_callback(gen, error); });
         }
         conn_timer_start(conn_timeout);
-        client->start();
+        if (race)
+            race_launch();
+        else
+            client->start();
+    }
+
+    // Happy eyeballs (RFC 8305): start a connection attempt to each
+    // resolved remote address, staggered by race_delay_.  The first
+    // server to answer wins and becomes the client, the other attempts
+    // are stopped.  The race is decided before the TLS handshake, so
+    // that credentials are only ever sent to the winner.
+    bool race_prepare()
+    {
+        race_candidates.clear();
+        race_next = 0;
+        if (client_options->happy_eyeballs() && !transport_factory_relay)
+            race_candidates = client_options->remote_candidates();
+        return race_candidates.size() >= 2;
+    }
+
+    void race_launch()
+    {
+        const RemoteList::Candidate &candidate = race_candidates[race_next++];
+        client_options->select_remote(candidate);
+
+        Racer::Ptr racer(new Racer(this, candidate));
+        Client::Config::Ptr cli_config = client_options->client_config(true);
+        racer->client.reset(new Client(io_context, *cli_config, racer.get()));
+        racers.push_back(racer);
+
+        if (race_next < race_candidates.size())
+        {
+            race_timer.expires_after(Time::Duration::milliseconds(race_delay_));
+            race_timer.async_wait([self = Ptr(this), gen = generation](const openvpn_io::error_code &error)
+                                  {
+                                  OPENVPN_ASYNC_HANDLER;
+                                  self->race_timer_callback(gen, error); });
+        }
+        racer->client->start();
+    }
+
+    void race_timer_callback(unsigned int gen, const openvpn_io::error_code &e)
+    {
+        if (!e && gen == generation && !halt && !client && race_next < race_candidates.size())
+            race_launch();
+    }
+
+    void race_first_packet(Racer *racer)
+    {
+        if (client)
+            return;
+
+        race_winner.reset(racer);
+        client = racer->client;
+        race_cancel();
+
+        // make the winner current, so that reconnects start from it
+        const std::string host = client_options->select_remote(racer->candidate);
+        OPENVPN_LOG("Happy eyeballs: " << host << " answered first");
+    }
+
+    void race_terminate(Racer *racer)
+    {
+        if (halt)
+            return;
+        if (racer == race_winner.get())
+        {
+            client_proto_terminate();
+            return;
+        }
+
+        const Racer::Ptr rp(racer);
+        racers.erase(std::remove(racers.begin(), racers.end(), rp), racers.end());
+        if (race_next < race_candidates.size())
+        {
+            // don't wait for the timer if an attempt failed
+            race_timer.cancel();
+            race_launch();
+        }
+        else if (racers.empty())
+        {
+            // all attempts failed, handle it like a normal failure
+            race_winner = rp;
+            client = rp->client;
+            client_proto_terminate();
+        }
+    }
+
+    void race_cancel()
+    {
+        race_timer.cancel();
+        for (auto &racer : racers)
+        {
+            if (racer != race_winner)
+                racer->client->stop(false);
+        }
+        racers.clear();
     }
 
     // ClientLifeCycle::NotifyCallback callbacks
@@ -721,8 +883,14 @@ class ClientConnect : ClientProto::NotifyCallback,
     bool conn_timer_pending;
     std::unique_ptr<AsioWork> asio_work;
     RemoteList::BulkResolve::Ptr bulk_resolve;
+    AsioTimer race_timer;
+    std::vector<RemoteList::Candidate> race_candidates;
+    size_t race_next = 0;
+    std::vector<Racer::Ptr> racers;
+    Racer::Ptr race_winner;
 
     static constexpr std::chrono::milliseconds default_delay_ = 2000ms;
+    static constexpr std::chrono::milliseconds race_delay_ = 250ms;
 };
 
 } // namespace openvpn
@@ -17,6 +17,7 @@
 #include <openvpn/common/exception.hpp>
 #include <openvpn/tun/client/emuexr.hpp>
 #include <openvpn/addr/addrspacesplit.hpp>
+#include <openvpn/addr/routetrie.hpp>
 
 namespace openvpn {
 class EmulateExcludeRouteImpl : public EmulateExcludeRoute
@@ -32,6 +33,14 @@ class EmulateExcludeRouteImpl : public EmulateExcludeRoute
     }
 
   private:
+    enum
+    {
+        INCLUDE = (1 << 0),
+        EXCLUDE = (1 << 1),
+    };
+
+    typedef IP::RouteTrie<unsigned int> RouteTrie;
+
     void add_route(const bool add, const IP::Addr &addr, const int prefix_len) override
     {
         (add ? include : exclude).emplace_back(addr, prefix_len);
@@ -53,28 +62,14 @@ class EmulateExcludeRouteImpl : public EmulateExcludeRoute
     void emulate(TunBuilderBase *tb, IPVerFlags &ipv, const IP::Addr &server_addr) const override
     {
         const unsigned int ip_ver_flags = ipv.ip_ver_flags();
-        IP::RouteList rl, tempExcludeList;
-        rl.reserve(include.size() + exclude.size());
-        rl.insert(rl.end(), include.begin(), include.end());
-        rl.insert(rl.end(), exclude.begin(), exclude.end());
 
         // Check if we have to exclude the server, if yes we temporarily add it to the list
         // of excluded networks as small individual /32 or /128 network
-        const IP::RouteList *excludedRoutes = &exclude;
-
-        if (exclude_server_address_
-            && (server_addr.version_mask() & ip_ver_flags)
-            && !exclude.contains(IP::Route(server_addr, server_addr.size())))
-        {
-            rl.emplace_back(server_addr, server_addr.size());
-            // Create a temporary list that includes all the routes + the server
-            tempExcludeList = exclude;
-            tempExcludeList.emplace_back(server_addr, server_addr.size());
-            excludedRoutes = &tempExcludeList;
-        }
-
+        const bool exclude_server = exclude_server_address_
+                                    && (server_addr.version_mask() & ip_ver_flags)
+                                    && !exclude.contains(IP::Route(server_addr, server_addr.size()));
 
-        if (excludedRoutes->empty())
+        if (exclude.empty() && !exclude_server)
         {
             // Samsung's Android VPN API does different things if you have
             // 0.0.0.0/0 in the list of installed routes
@@ -95,11 +90,19 @@ class EmulateExcludeRouteImpl : public EmulateExcludeRoute
             return;
         }
 
+        RouteTrie routes;
+        for (const auto &r : include)
+            routes[r] |= INCLUDE;
+        for (const auto &r : exclude)
+            routes[r] |= EXCLUDE;
+        if (exclude_server)
+            routes[IP::Route(server_addr, server_addr.size())] |= EXCLUDE;
+
         // Complete address space (0.0.0.0/0 or ::/0) split into smaller networks
         // Figure out which parts of this non overlapping address we want to install
-        for (const auto &r : IP::AddressSpaceSplitter(rl, ip_ver_flags))
+        for (const auto &r : IP::AddressSpaceSplitter(routes, ip_ver_flags))
         {
-            if (check_route_should_be_installed(r, *excludedRoutes))
+            if (check_route_should_be_installed(r, routes))
                 if (!tb->tun_builder_add_route(r.addr.to_string(), r.prefix_len, -1, r.addr.version() == IP::Addr::V6))
                     throw emulate_exclude_route_error("tun_builder_add_route failed");
         }
@@ -107,7 +110,7 @@ class EmulateExcludeRouteImpl : public EmulateExcludeRoute
         ipv.set_emulate_exclude_routes();
     }
 
-    bool check_route_should_be_installed(const IP::Route &r, const IP::RouteList &excludedRoutes) const
+    static bool check_route_should_be_installed(const IP::Route &r, const RouteTrie &routes)
     {
         // The whole address space was partioned into NON-overlapping routes that
         // we get one by one with the parameter r.
@@ -115,29 +118,23 @@ class EmulateExcludeRouteImpl : public EmulateExcludeRoute
         // excluded IPs.
         // Figure out if this particular route should be installed or not
 
-        IP::Route const *bestroute = nullptr;
-        // Get the best (longest-prefix/smallest) route from included routes that completely
-        // matches this route
-        for (const auto &incRoute : include)
-        {
-            if (incRoute.contains(r))
-            {
-                if (!bestroute || bestroute->prefix_len < incRoute.prefix_len)
-                    bestroute = &incRoute;
-            }
-        }
+        // Get the best (longest-prefix/smallest) included and excluded routes
+        // that completely match this route
+        int include_len = -1;
+        int exclude_len = -1;
+        routes.match(r, [&](const IP::Route &route, const unsigned int flags)
+                     {
+            if (flags & INCLUDE)
+                include_len = route.prefix_len;
+            if (flags & EXCLUDE)
+                exclude_len = route.prefix_len; });
 
         // No positive route matches the route at all, do not install it
-        if (!bestroute)
+        if (include_len < 0)
             return false;
 
         // Check if there is a more specific exclude route
-        for (const auto &exclRoute : excludedRoutes)
-        {
-            if (exclRoute.contains(r) && exclRoute.prefix_len > bestroute->prefix_len)
-                return false;
-        }
-        return true;
+        return exclude_len <= include_len;
     }
 
     const bool exclude_server_address_;
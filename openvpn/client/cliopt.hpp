@@ -287,7 +287,12 @@ class ClientOptions : public RC<thread_unsafe_refcount>
         // If running in tun_persist mode, we need to do basic DNS caching so that
         // we can avoid emitting DNS requests while the tunnel is blocked during
         // reconnections.
-        remote_list->set_enable_cache(config.clientconf.tunPersist);
+        //
+        // Happy eyeballs needs all remotes resolved before racing them,
+        // and a persistent remote cache is refreshed the same way.
+        remote_list->set_enable_cache(config.clientconf.tunPersist
+                                      || config.clientconf.happyEyeballs
+                                      || !config.clientconf.remoteCacheFile.empty());
 
         // process server/port/family overrides
         remote_list->set_server_override(config.clientconf.serverOverride);
@@ -316,6 +321,14 @@ class ClientOptions : public RC<thread_unsafe_refcount>
             remote_list->set_enable_cache(false); // remote server addresses will be resolved by proxy
             http_proxy_options->proxy_server_set_enable_cache(config.clientconf.tunPersist);
         }
+        else if (!config.clientconf.remoteCacheFile.empty())
+        {
+            // start from addresses resolved by a previous instance
+            remote_cache.reset(new RemoteCache(config.clientconf.remoteCacheFile,
+                                               std::max(config.clientconf.remoteCacheTTL, 0)));
+            remote_cache->load();
+            remote_list->load_cache(*remote_cache);
+        }
 
         check_for_incompatible_options(opt);
 
@@ -438,6 +451,8 @@ class ClientOptions : public RC<thread_unsafe_refcount>
                 tunconf->tun_prop.remote_list = remote_list;
                 tunconf->frame = frame;
                 tunconf->stats = cli_stats;
+                tunconf->vnet_hdr = config.clientconf.tunOffload;
+                tunconf->io_uring = config.clientconf.ioUring;
                 if (config.clientconf.tunPersist)
                     tunconf->tun_persist.reset(new TunLinux::TunPersist(true, TunWrapObjRetain::NO_RETAIN, nullptr));
                 tunconf->load(opt);
@@ -1120,6 +1135,48 @@ class ClientOptions : public RC<thread_unsafe_refcount>
         remote_list->reset_cache_item();
     }
 
+    // true if connection attempts should be raced (RFC 8305)
+    bool happy_eyeballs() const
+    {
+        return clientconf.happyEyeballs && !alt_proxy && !http_proxy_options && !dco;
+    }
+
+    std::vector<RemoteList::Candidate> remote_candidates() const
+    {
+        return remote_list->candidates();
+    }
+
+    // make a remote address current and load its transport config,
+    // returns the server host
+    std::string select_remote(const RemoteList::Candidate &c)
+    {
+        remote_list->select(c);
+        return load_transport_config();
+    }
+
+    // true if the current remote address was loaded from the
+    // persistent remote cache and can be connected to right away
+    bool remote_cache_preloaded() const
+    {
+        return remote_cache && remote_list->endpoint_available(nullptr, nullptr, nullptr);
+    }
+
+    // write resolved addresses to the persistent remote cache, and
+    // if connected_addr is defined, record it as the last good one
+    void remote_cache_save(const IP::Addr &connected_addr)
+    {
+        if (remote_cache)
+        {
+            remote_list->save_cache(*remote_cache, connected_addr);
+            remote_cache->save();
+        }
+    }
+
+    size_t resolve_parallel() const
+    {
+        return clientconf.resolveParallel > 1 ? clientconf.resolveParallel : 1;
+    }
+
     bool pause_on_connection_timeout()
     {
         if (reconnect_notify)
@@ -1406,6 +1463,9 @@ class ClientOptions : public RC<thread_unsafe_refcount>
                 udpconf->stats = cli_stats;
                 udpconf->socket_protect = socket_protect;
                 udpconf->server_addr_float = server_addr_float;
+                udpconf->batch_size = clientconf.udpBatchSize;
+                udpconf->offload = clientconf.udpSegmentationOffload;
+                udpconf->io_uring = clientconf.ioUring;
 #ifdef OPENVPN_GREMLIN
                 udpconf->gremlin_config = gremlin_config;
 #endif
@@ -1450,6 +1510,7 @@ class ClientOptions : public RC<thread_unsafe_refcount>
     ProtoContext::ProtoConfig::Ptr cp_main;
     ProtoContext::ProtoConfig::Ptr cp_relay;
     RemoteList::Ptr remote_list;
+    RemoteCache::Ptr remote_cache;
     bool server_addr_float;
     TransportClientFactory::Ptr transport_factory;
     TunClientFactory::Ptr tun_factory;
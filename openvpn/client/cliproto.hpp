@@ -84,6 +84,10 @@ struct NotifyCallback
     virtual void client_proto_renegotiated()
     {
     }
+    // called when the first packet from the server arrives
+    virtual void client_proto_first_packet()
+    {
+    }
 };
 
 class Session : ProtoContextCallbackInterface,
@@ -274,6 +278,14 @@ class Session : ProtoContextCallbackInterface,
         return bool(connected_);
     }
 
+    // the server address the transport is connected to
+    IP::Addr server_endpoint_addr() const
+    {
+        if (transport)
+            return transport->server_endpoint_addr();
+        return IP::Addr();
+    }
+
     // If fatal() returns something other than Error::UNDEF, it
     // is intended to flag the higher levels (cliconnect.hpp)
     // that special handling is required.  This handling might include
@@ -342,13 +354,21 @@ class Session : ProtoContextCallbackInterface,
                 ClientEvent::Base::Ptr ev = new ClientEvent::Connecting();
                 cli_events->add_event(std::move(ev));
                 first_packet_received_ = true;
+                if (notify_callback)
+                    notify_callback->client_proto_first_packet();
             }
 
             // get packet type
             ProtoContext::PacketType pt = proto_context.packet_type(buf);
 
             // process packet
-            if (pt.is_data())
+            if (pt.is_data() && recv_batch)
+            {
+                // decrypted with the rest of the batch, see transport_recv_batch_end()
+                recv_batch_add(buf);
+                return;
+            }
+            else if (pt.is_data())
             {
                 // data packet
                 proto_context.data_decrypt(pt, buf);
@@ -370,6 +390,9 @@ class Session : ProtoContextCallbackInterface,
             }
             else if (pt.is_control())
             {
+                // data packets received before it may depend on the current keys
+                recv_batch_flush();
+
                 // control packet
                 proto_context.control_net_recv(pt, std::move(buf));
 
@@ -400,6 +423,79 @@ class Session : ProtoContextCallbackInterface,
         }
     }
 
+    void transport_recv_batch_begin() override
+    {
+        recv_batch = true;
+    }
+
+    void transport_recv_batch_end() override
+    {
+        recv_batch = false;
+        try
+        {
+            recv_batch_flush();
+
+            // schedule housekeeping wakeup
+            set_housekeeping_timer();
+        }
+        catch (const ExceptionCode &e)
+        {
+            if (e.code_defined())
+            {
+                if (e.fatal())
+                    transport_error((Error::Type)e.code(), e.what());
+                else
+                    cli_stats->error((Error::Type)e.code());
+            }
+            else
+                process_exception(e, "transport_recv_batch_end_excode");
+        }
+        catch (const std::exception &e)
+        {
+            process_exception(e, "transport_recv_batch_end");
+        }
+    }
+
+    // defer a data packet until the end of the batch, taking over its buffer
+    void recv_batch_add(BufferAllocated &buf)
+    {
+        if (recv_batch_count == recv_batch_bufs.size())
+            recv_batch_bufs.emplace_back();
+        recv_batch_bufs[recv_batch_count++].swap(buf);
+        if (recv_batch_count == ProtoContext::DATA_BATCH_MAX)
+            recv_batch_flush();
+    }
+
+    // decrypt the deferred data packets, and pass them to tun in order
+    void recv_batch_flush()
+    {
+        const size_t n = recv_batch_count;
+        if (!n || halt)
+            return;
+        recv_batch_count = 0;
+
+        proto_context.data_decrypt_batch(recv_batch_bufs.data(), n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            BufferAllocated &buf = recv_batch_bufs[i];
+            if (buf.size())
+            {
+#ifdef OPENVPN_PACKET_LOG
+                log_packet(buf, false);
+#endif
+                // make packet appear as incoming on tun interface
+                if (tun)
+                {
+                    OPENVPN_LOG_CLIPROTO("TUN send, size=" << buf.size());
+                    tun->tun_send(buf);
+                }
+            }
+        }
+
+        // do a lightweight flush
+        proto_context.flush(false);
+    }
+
     void transport_needs_send() override
     {
     }
@@ -1030,17 +1126,27 @@ class Session : ProtoContextCallbackInterface,
             auto pushed_options_list = OptionList::parse_from_csv_static(msg.substr(11), &pushed_options_limit);
             try
             {
-                received_options.add(pushed_options_list, pushed_options_filter.get());
+                received_options.add(std::move(pushed_options_list), pushed_options_filter.get());
+
+                // Render the options of each fragment as it arrives, rather
+                // than all of them after the last fragment was received.
+                received_options_log += render_options_sanitized(received_options,
+                                                                 Option::RENDER_PASS_FMT | Option::RENDER_NUMBER | Option::RENDER_BRACKET,
+                                                                 received_options_logged);
+                received_options_logged = received_options.size();
             }
             catch (const Option::RejectedException &e)
             {
+                received_options_log.clear();
+                received_options_logged = 0;
                 recv_halt_restart("RESTART,rejected pushed option: " + e.err());
             }
             if (received_options.complete())
             {
                 // show options
                 OPENVPN_LOG("OPTIONS:" << std::endl
-                                       << render_options_sanitized(received_options, Option::RENDER_PASS_FMT | Option::RENDER_NUMBER | Option::RENDER_BRACKET));
+                                       << received_options_log);
+                std::string().swap(received_options_log);
 
                 // relay servers are not allowed to establish a tunnel with us
                 if (proto_context.conf().relay_mode)
@@ -1430,15 +1536,23 @@ class Session : ProtoContextCallbackInterface,
                 if (o->size() >= 3)
                     inactivity_minimum_bytes = parse_number_throw<unsigned int>(o->get(2, 16), "inactive bytes");
 
+                // Let the stats object batch up tun traffic rather than posting
+                // a timer reset for every packet.  Each direction is batched
+                // separately, so use half the threshold to bound the amount
+                // of combined in/out traffic that can be held back.
+                const count_t batch = inactivity_minimum_bytes / 2;
+
                 out_tun_callback_ = cli_stats->set_inc_callback(
                     SessionStats::Stats::TUN_BYTES_OUT,
                     [self = Ptr(this)](const count_t value)
-                    { self->reset_inactive_timer(value); });
+                    { self->reset_inactive_timer(value); },
+                    batch);
 
                 in_tun_callback_ = cli_stats->set_inc_callback(
                     SessionStats::Stats::TUN_BYTES_IN,
                     [self = Ptr(this)](const count_t value)
-                    { self->reset_inactive_timer(value); });
+                    { self->reset_inactive_timer(value); },
+                    batch);
 
                 schedule_inactive_timer();
             }
@@ -1461,12 +1575,13 @@ class Session : ProtoContextCallbackInterface,
     void reset_inactive_timer(const count_t bytes_count)
     {
         // Ensure that it's called within the io_context in case it needs to be invoked from a separate thread.
-        openvpn_io::post(io_context, [self = Ptr(this), bytes_count]()
-                         {
+        // Runs inline when already there, so that flush_inc_callbacks() counts synchronously.
+        openvpn_io::dispatch(io_context, [self = Ptr(this), bytes_count]()
+                             {
             OPENVPN_ASYNC_HANDLER;
 
             self->inactivity_bytes += bytes_count;
-            if (self->inactivity_bytes >= self->inactivity_minimum_bytes)
+            if (!self->inactive_flush && self->inactivity_bytes >= self->inactivity_minimum_bytes)
             {
                 // OPENVPN_LOG("reset_inactive_timer: " << self->inactivity_bytes);
                 self->inactivity_bytes = 0;
@@ -1480,6 +1595,18 @@ class Session : ProtoContextCallbackInterface,
         {
             if (!e && !halt)
             {
+                // cli_stats holds back up to a batch of tun traffic per
+                // direction, so count it before declaring a timeout
+                inactive_flush = true;
+                cli_stats->flush_inc_callbacks();
+                inactive_flush = false;
+                if (inactivity_minimum_bytes && inactivity_bytes >= inactivity_minimum_bytes)
+                {
+                    inactivity_bytes = 0;
+                    schedule_inactive_timer();
+                    return;
+                }
+
                 fatal_ = Error::INACTIVE_TIMEOUT;
                 send_explicit_exit_notify();
                 if (notify_callback)
@@ -1608,7 +1735,14 @@ class Session : ProtoContextCallbackInterface,
     AsioTimer push_request_timer;
     bool halt = false;
 
+    // data packets of a transport receive batch, see transport_recv_batch_begin()
+    bool recv_batch = false;
+    std::vector<BufferAllocated> recv_batch_bufs;
+    size_t recv_batch_count = 0;
+
     OptionListContinuation received_options;
+    std::string received_options_log;  // rendered pushed options, until complete
+    size_t received_options_logged = 0; // number of received_options rendered
 
     ClientCreds::Ptr creds;
 
@@ -1638,6 +1772,7 @@ class Session : ProtoContextCallbackInterface,
 
     unsigned int inactivity_minimum_bytes = 0;
     std::uint64_t inactivity_bytes = 0;
+    bool inactive_flush = false;
     std::shared_ptr<SessionStats::inc_callback_t> out_tun_callback_;
     std::shared_ptr<SessionStats::inc_callback_t> in_tun_callback_;
 
@@ -0,0 +1,172 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Persistent cache of resolved remote server addresses, so that a client
+// can connect without waiting for DNS after it has been restarted.
+// Each line of the cache file describes one remote:
+//
+//   <host> <port> <proto> <resolve-time> <last-success-time> <addr>...
+//
+// Entries that were resolved more than ttl seconds ago are dropped on load.
+// The cache is only an optimization, so file errors are logged and ignored.
+
+#ifndef OPENVPN_CLIENT_REMOTECACHE_H
+#define OPENVPN_CLIENT_REMOTECACHE_H
+
+#include <ctime>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <utility>
+
+#include <openvpn/common/rc.hpp>
+#include <openvpn/common/file.hpp>
+#include <openvpn/addr/ip.hpp>
+#include <openvpn/transport/protocol.hpp>
+
+namespace openvpn {
+
+class RemoteCache : public RC<thread_unsafe_refcount>
+{
+  public:
+    typedef RCPtr<RemoteCache> Ptr;
+
+    enum
+    {
+        MAX_FILE_SIZE = 65536,
+        MAX_ADDRS = 64,
+    };
+
+    struct Entry
+    {
+        std::vector<IP::Addr> addrs;
+        std::time_t resolve_time = 0;
+        std::time_t last_success = 0;
+    };
+
+    RemoteCache(std::string filename_arg, const std::time_t ttl_arg)
+        : filename(std::move(filename_arg)),
+          ttl_(ttl_arg)
+    {
+    }
+
+    static std::string key(const std::string &host,
+                           const std::string &port,
+                           const Protocol &proto)
+    {
+        return host + ' ' + port + ' ' + proto.str();
+    }
+
+    const Entry *get(const std::string &key) const
+    {
+        const auto i = entries.find(key);
+        if (i != entries.end())
+            return &i->second;
+        return nullptr;
+    }
+
+    void set(const std::string &key, Entry entry)
+    {
+        entries[key] = std::move(entry);
+    }
+
+    std::time_t ttl() const
+    {
+        return ttl_;
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    void load()
+    {
+        entries.clear();
+        try
+        {
+            parse(read_text(filename, MAX_FILE_SIZE), std::time(nullptr));
+        }
+        catch (const open_file_error &)
+        {
+            // no cache yet
+        }
+        catch (const std::exception &e)
+        {
+            OPENVPN_LOG("Remote cache: error reading " << filename << ": " << e.what());
+        }
+    }
+
+    void save() const
+    {
+        try
+        {
+            write_string(filename, render());
+        }
+        catch (const std::exception &e)
+        {
+            OPENVPN_LOG("Remote cache: error writing " << filename << ": " << e.what());
+        }
+    }
+
+    // add the entries of a cache file, skipping expired and malformed lines
+    void parse(const std::string &text, const std::time_t now)
+    {
+        std::istringstream in(text);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::istringstream ls(line);
+            std::string host, port, proto;
+            Entry entry;
+            if (!(ls >> host >> port >> proto >> entry.resolve_time >> entry.last_success))
+                continue;
+            if (entry.resolve_time + ttl_ <= now)
+                continue;
+
+            try
+            {
+                std::string addr;
+                while (ls >> addr && entry.addrs.size() < MAX_ADDRS)
+                    entry.addrs.push_back(IP::Addr(addr));
+            }
+            catch (const std::exception &)
+            {
+                continue;
+            }
+            if (!entry.addrs.empty())
+                entries[host + ' ' + port + ' ' + proto] = std::move(entry);
+        }
+    }
+
+    std::string render() const
+    {
+        std::ostringstream out;
+        for (const auto &e : entries)
+        {
+            out << e.first << ' ' << e.second.resolve_time << ' ' << e.second.last_success;
+            for (const auto &addr : e.second.addrs)
+                out << ' ' << addr.to_string();
+            out << '\n';
+        }
+        return out.str();
+    }
+
+  private:
+    std::string filename;
+    std::time_t ttl_;
+    std::map<std::string, Entry> entries;
+};
+
+} // namespace openvpn
+
+#endif
@@ -40,6 +40,7 @@
 #include <openvpn/client/cliconstants.hpp>
 #include <openvpn/log/sessionstats.hpp>
 #include <openvpn/client/async_resolve.hpp>
+#include <openvpn/client/remotecache.hpp>
 
 #if OPENVPN_DEBUG_REMOTELIST >= 1
 #define OPENVPN_LOG_REMOTELIST(x) OPENVPN_LOG(x)
@@ -129,6 +130,12 @@ class RemoteList : public RC<thread_unsafe_refcount>
         // Time when the item's resolved addresses are considered outdated
         std::time_t decay_time = std::numeric_limits<std::time_t>::max();
 
+        // Time when the item's addresses were last resolved
+        std::time_t resolve_time = 0;
+
+        // Addresses were loaded from a RemoteCache and should be re-resolved
+        bool stale = false;
+
         bool res_addr_list_defined() const
         {
             return res_addr_list && res_addr_list->size() > 0;
@@ -178,6 +185,8 @@ class RemoteList : public RC<thread_unsafe_refcount>
                 }
                 if (rng && res_addr_list->size() >= 2)
                     std::shuffle(res_addr_list->begin(), res_addr_list->end(), *rng);
+                resolve_time = time(nullptr);
+                stale = false;
                 OPENVPN_LOG_REMOTELIST("*** RemoteList::Item endpoint SET " << to_string());
             }
             else if (!res_addr_list)
@@ -204,7 +213,7 @@ class RemoteList : public RC<thread_unsafe_refcount>
 
         bool need_resolve()
         {
-            return !res_addr_list || decay_time <= time(nullptr);
+            return !res_addr_list || stale || decay_time <= time(nullptr);
         }
 
         std::string to_string() const
@@ -256,6 +265,10 @@ class RemoteList : public RC<thread_unsafe_refcount>
         {
             item_ = i;
         }
+        void set_item_addr(const size_t i)
+        {
+            item_addr_ = i;
+        }
 
         size_t item() const
         {
@@ -316,6 +329,7 @@ class RemoteList : public RC<thread_unsafe_refcount>
                     const SessionStats::Ptr &stats_arg)
             : AsyncResolvableTCP(io_context_arg),
               notify_callback(nullptr),
+              io_context(io_context_arg),
               remote_list(remote_list_arg),
               stats(stats_arg),
               index(0)
@@ -328,6 +342,14 @@ class RemoteList : public RC<thread_unsafe_refcount>
             return remote_list->defined() && remote_list->enable_cache;
         }
 
+        // Resolve up to max_parallel distinct hosts concurrently
+        // instead of one at a time.  Values <= 1 keep the
+        // sequential behavior.
+        void set_max_parallel(const size_t max_parallel_arg)
+        {
+            max_parallel = max_parallel_arg;
+        }
+
         void start(NotifyCallback *notify_callback_arg)
         {
             if (notify_callback_arg)
@@ -340,7 +362,10 @@ class RemoteList : public RC<thread_unsafe_refcount>
                     notify_callback = notify_callback_arg;
                     index = 0;
                     async_resolve_lock();
-                    resolve_next();
+                    if (max_parallel > 1)
+                        resolve_parallel();
+                    else
+                        resolve_next();
                 }
                 else
                     notify_callback_arg->bulk_resolve_done();
@@ -351,10 +376,53 @@ class RemoteList : public RC<thread_unsafe_refcount>
         {
             notify_callback = nullptr;
             index = 0;
+            for (auto &query : queries)
+                query->cancel();
+            queries.clear();
             async_resolve_cancel();
         }
 
       protected:
+        // A single DNS query in parallel mode, reporting back to BulkResolve
+        class Query : public RC<thread_unsafe_refcount>, protected AsyncResolvableTCP
+        {
+          public:
+            typedef RCPtr<Query> Ptr;
+
+            Query(openvpn_io::io_context &io_context_arg,
+                  BulkResolve *parent_arg,
+                  const Item::Ptr &item_arg)
+                : AsyncResolvableTCP(io_context_arg),
+                  item(item_arg),
+                  parent(parent_arg)
+            {
+            }
+
+            void start()
+            {
+                OPENVPN_LOG_REMOTELIST("*** BulkResolve RESOLVE on " << item->to_string());
+                async_resolve_name(item->actual_host(), item->server_port);
+            }
+
+            void cancel()
+            {
+                parent = nullptr;
+                async_resolve_cancel();
+            }
+
+            const Item::Ptr item;
+
+          private:
+            void resolve_callback(const openvpn_io::error_code &error,
+                                  results_type results) override
+            {
+                if (parent)
+                    parent->query_done(this, error, results);
+            }
+
+            BulkResolve *parent;
+        };
+
         void resolve_next()
         {
             while (index < remote_list->list.size())
@@ -371,17 +439,62 @@ class RemoteList : public RC<thread_unsafe_refcount>
                 ++index;
             }
 
-            // Done resolving list.  Prune out all entries we were unable to
-            // resolve unless doing so would result in an empty list.
-            // Then call client's callback method.
+            resolve_done();
+        }
+
+        // Start queries for unresolved hosts until max_parallel are in
+        // flight.  Items sharing a host with a pending query are skipped,
+        // as the results of that query will be applied to them too.
+        void resolve_parallel()
+        {
+            while (queries.size() < max_parallel && index < remote_list->list.size())
             {
-                async_resolve_cancel();
-                NotifyCallback *ncb = notify_callback;
-                if (remote_list->cached_item_exists())
-                    remote_list->prune_uncached();
-                cancel();
-                ncb->bulk_resolve_done();
+                const auto &item = remote_list->list[index++];
+                if (!item->need_resolve() || query_pending(*item))
+                    continue;
+                Query::Ptr query(new Query(io_context, this, item));
+                queries.push_back(query);
+                query->start();
+            }
+
+            if (queries.empty() && index >= remote_list->list.size())
+                resolve_done();
+        }
+
+        bool query_pending(const Item &item) const
+        {
+            for (const auto &query : queries)
+            {
+                if (query->item->server_host == item.server_host)
+                    return true;
             }
+            return false;
+        }
+
+        void query_done(Query *query,
+                        const openvpn_io::error_code &error,
+                        const results_type &results)
+        {
+            if (notify_callback)
+            {
+                const Query::Ptr qp(query);
+                queries.erase(std::remove(queries.begin(), queries.end(), qp), queries.end());
+                apply_results(*qp->item, error, results);
+                resolve_parallel();
+            }
+        }
+
+        // Done resolving list.  Prune out all entries we were unable to
+        // resolve unless doing so would result in an empty list.
+        // Then call client's callback method.
+        void resolve_done()
+        {
+            async_resolve_cancel();
+            NotifyCallback *ncb = notify_callback;
+            if (remote_list->cached_item_exists())
+                remote_list->prune_uncached();
+            cancel();
+            ncb->bulk_resolve_done();
         }
 
         // callback on resolve completion
@@ -389,45 +502,56 @@ class RemoteList : public RC<thread_unsafe_refcount>
                               results_type results) override
         {
             if (notify_callback && index < remote_list->list.size())
+            {
+                const auto resolve_item(remote_list->list[index++]);
+                apply_results(*resolve_item, error, results);
+                resolve_next();
+            }
+        }
+
+        void apply_results(const Item &resolve_item,
+                           const openvpn_io::error_code &error,
+                           const results_type &results)
+        {
+            if (!error)
             {
                 auto indexed_item(remote_list->index.item());
                 const auto item_in_use(remote_list->list[indexed_item]);
-                const auto resolve_item(remote_list->list[index++]);
-                if (!error)
+
+                // Set results to Items, where applicable
+                auto rand = remote_list->random ? remote_list->rng.get() : nullptr;
+                for (auto &item : remote_list->list)
                 {
-                    // Set results to Items, where applicable
-                    auto rand = remote_list->random ? remote_list->rng.get() : nullptr;
-                    for (auto &item : remote_list->list)
-                    {
-                        // Skip already resolved and items with different hostname
-                        if (!item->need_resolve()
-                            || item->server_host != resolve_item->server_host)
-                            continue;
+                    // Skip already resolved and items with different hostname
+                    if (!item->need_resolve()
+                        || item->server_host != resolve_item.server_host)
+                        continue;
 
-                        // Reset item's address index as the list changes
-                        if (item == item_in_use)
-                            remote_list->index.reset_item_addr();
+                    // Reset item's address index as the list changes
+                    if (item == item_in_use)
+                        remote_list->index.reset_item_addr();
 
-                        item->set_endpoint_range(results, rand, remote_list->cache_lifetime);
-                        item->random_host = resolve_item->random_host;
-                    }
+                    item->set_endpoint_range(results, rand, remote_list->cache_lifetime);
+                    item->random_host = resolve_item.random_host;
                 }
-                else
-                {
-                    // resolve failed
-                    OPENVPN_LOG("DNS bulk-resolve error on " << resolve_item->actual_host()
-                                                             << ": " << error.message());
-                    if (stats)
-                        stats->error(Error::RESOLVE_ERROR);
-                }
-                resolve_next();
+            }
+            else
+            {
+                // resolve failed
+                OPENVPN_LOG("DNS bulk-resolve error on " << resolve_item.actual_host()
+                                                         << ": " << error.message());
+                if (stats)
+                    stats->error(Error::RESOLVE_ERROR);
             }
         }
 
         NotifyCallback *notify_callback;
+        openvpn_io::io_context &io_context;
         RemoteList::Ptr remote_list;
         SessionStats::Ptr stats;
         size_t index;
+        size_t max_parallel = 1;
+        std::vector<Query::Ptr> queries;
     };
 
     // create a remote list with a RemoteOverride callback
@@ -699,6 +823,56 @@ class RemoteList : public RC<thread_unsafe_refcount>
         return list.at(index);
     }
 
+    // A remote list item and one of its resolved addresses
+    struct Candidate
+    {
+        size_t item;
+        size_t item_addr;
+    };
+
+    // Return the resolved endpoints of all items in the order in which
+    // connection attempts should be made when racing them (RFC 8305,
+    // section 4).  The list order is kept within each address family,
+    // and the families alternate, starting with IPv6.
+    std::vector<Candidate> candidates() const
+    {
+        std::vector<Candidate> v6;
+        std::vector<Candidate> v4;
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            const Item &item = *list[i];
+            if (!item.res_addr_list)
+                continue;
+            for (size_t j = 0; j < item.res_addr_list->size(); ++j)
+            {
+                if ((*item.res_addr_list)[j]->addr.is_ipv6())
+                    v6.push_back({i, j});
+                else
+                    v4.push_back({i, j});
+            }
+        }
+
+        std::vector<Candidate> ret;
+        ret.reserve(v6.size() + v4.size());
+        for (size_t k = 0; k < std::max(v6.size(), v4.size()); ++k)
+        {
+            if (k < v6.size())
+                ret.push_back(v6[k]);
+            if (k < v4.size())
+                ret.push_back(v4[k]);
+        }
+        return ret;
+    }
+
+    // make the given candidate the current connection entry
+    void select(const Candidate &c)
+    {
+        if (c.item_addr >= item_addr_length(c.item))
+            throw remote_list_error("connection candidate is undefined");
+        index.set_item(c.item);
+        index.set_item_addr(c.item_addr);
+    }
+
     // return hostname (or IP address) of current connection entry
     std::string current_server_host() const
     {
@@ -749,6 +923,88 @@ class RemoteList : public RC<thread_unsafe_refcount>
         }
     }
 
+    // Pre-populate items with the addresses from a persistent cache.
+    // The addresses can be used right away, but are marked stale so that
+    // BulkResolve re-resolves them.  Items are ordered by their last
+    // successful connection, most recent first, and the remaining items
+    // keep their order.  Returns true if any addresses were loaded.
+    bool load_cache(const RemoteCache &cache)
+    {
+        std::vector<std::pair<std::time_t, Item::Ptr>> sorted;
+        bool loaded = false;
+        for (auto &item : list)
+        {
+            std::time_t last_success = 0;
+            const RemoteCache::Entry *entry = cache.get(RemoteCache::key(item->server_host,
+                                                                         item->server_port,
+                                                                         item->transport_protocol));
+            if (entry)
+            {
+                ResolvedAddrList::Ptr ral(new ResolvedAddrList());
+                for (const auto &addr : entry->addrs)
+                {
+                    if ((item->transport_protocol.is_ipv6() && !addr.is_ipv6())
+                        || (item->transport_protocol.is_ipv4() && addr.is_ipv6()))
+                        continue;
+                    ResolvedAddr::Ptr ra(new ResolvedAddr());
+                    ra->addr = addr;
+                    ral->push_back(std::move(ra));
+                }
+                if (!ral->empty())
+                {
+                    item->res_addr_list = std::move(ral);
+                    item->resolve_time = entry->resolve_time;
+                    item->stale = true;
+                    last_success = entry->last_success;
+                    loaded = true;
+                    OPENVPN_LOG_REMOTELIST("*** RemoteList::Item endpoint LOAD " << item->to_string());
+                }
+            }
+            sorted.emplace_back(last_success, item);
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b)
+                         { return a.first > b.first; });
+        for (size_t i = 0; i < list.size(); ++i)
+            list[i] = std::move(sorted[i].second);
+        index.reset();
+        return loaded;
+    }
+
+    // Store the addresses of all resolved items in a persistent cache.
+    // If connected_addr is defined, the current item is recorded as the
+    // last successful connection, and connected_addr is moved to the
+    // front of its addresses.  The address is matched rather than taken
+    // from the index, since a bulk resolve may have replaced the list.
+    void save_cache(RemoteCache &cache, const IP::Addr &connected_addr = IP::Addr()) const
+    {
+        const std::time_t now = time(nullptr);
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            const Item &item = *list[i];
+            if (!item.res_addr_list_defined() || !item.resolve_time)
+                continue;
+
+            const std::string key = RemoteCache::key(item.server_host, item.server_port, item.transport_protocol);
+            RemoteCache::Entry entry;
+            const RemoteCache::Entry *prev = cache.get(key);
+            if (prev)
+                entry.last_success = prev->last_success;
+            entry.resolve_time = item.resolve_time;
+            for (const auto &ra : *item.res_addr_list)
+                entry.addrs.push_back(ra->addr);
+
+            if (connected_addr.defined() && i == index.item())
+            {
+                entry.last_success = now;
+                const auto addr = std::find(entry.addrs.begin(), entry.addrs.end(), connected_addr);
+                if (addr != entry.addrs.end())
+                    std::rotate(entry.addrs.begin(), addr, addr + 1);
+            }
+            cache.set(key, std::move(entry));
+        }
+    }
+
     // reset the cache associated with all items
     void reset_cache()
     {
@@ -0,0 +1,120 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Bounded lock-free queue with any number of producer and consumer threads.
+//
+// Every cell has a sequence number that tells producers and consumers
+// whether it is free for the current lap around the ring, so push and
+// pop each cost one CAS on the tail or head index in the common case,
+// and never block or allocate.  T must be default constructible and
+// move assignable.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <openvpn/common/size.hpp>
+
+namespace openvpn {
+
+template <typename T>
+class MPMCQueue
+{
+  public:
+    // capacity is rounded up to a power of 2
+    explicit MPMCQueue(const size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        mask = n - 1;
+        cells.reset(new Cell[n]);
+        for (size_t i = 0; i < n; ++i)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MPMCQueue(const MPMCQueue &) = delete;
+    MPMCQueue &operator=(const MPMCQueue &) = delete;
+
+    // returns false, leaving value untouched, if the queue is full
+    bool push(T &&value)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &c = cells[pos & mask];
+            const size_t seq = c.seq.load(std::memory_order_acquire);
+            const std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    c.value = std::move(value);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // cell of the previous lap not popped yet
+            else
+                pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    // returns false if the queue is empty
+    bool pop(T &value)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &c = cells[pos & mask];
+            const size_t seq = c.seq.load(std::memory_order_acquire);
+            const std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(c.value);
+                    c.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // cell not pushed yet
+            else
+                pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+  private:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    // producers and consumers don't share a cache line
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<size_t> head{0};
+};
+
+} // namespace openvpn
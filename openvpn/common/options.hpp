@@ -40,7 +40,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
-#include <algorithm>   // for std::sort, std::min
+#include <algorithm>   // for std::sort, std::min, std::count
 #include <utility>     // for std::move
 #include <type_traits> // for std::is_nothrow_move_constructible
 #include <unordered_map>
@@ -894,6 +894,7 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
     {
         std::vector<Option>::clear();
         map_.clear();
+        map_size_ = 0;
     }
 
     // caller should call update_map() after this function
@@ -901,10 +902,30 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
     {
         if (lim)
             lim->add_string(str);
-        std::vector<std::string> list = Split::by_char<std::vector<std::string>, Lex, Limits>(str, ',', 0, ~0, lim);
-        for (std::vector<std::string>::const_iterator i = list.begin(); i != list.end(); ++i)
+        reserve(size() + std::count(str.begin(), str.end(), ',') + 1);
+
+        // split by comma and then by space in a single pass,
+        // reusing the field and term buffers
+        Lex lex;
+        std::string field;
+        std::vector<std::string> terms;
+        for (size_t i = 0; i <= str.length(); ++i)
         {
-            const Option opt = Split::by_space<Option, Lex, SpaceMatch, Limits>(*i, lim);
+            if (i < str.length())
+            {
+                const char c = str[i];
+                lex.put(c);
+                if (lex.in_quote() || c != ',')
+                {
+                    field += c;
+                    continue;
+                }
+            }
+            if (lim)
+                lim->add_term();
+            Option opt;
+            parse_option_sized<Lex>(opt, field, terms, lim);
+            field.clear();
             if (opt.size())
             {
                 if (lim)
@@ -991,6 +1012,19 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
         return Split::by_space<Option, LexComment, SpaceMatch, Limits>(line, lim);
     }
 
+    // Split line by space into opt.  The terms are collected in the
+    // caller-provided terms vector first, so that opt is allocated once
+    // at its final size, and terms can be reused for the next line.
+    template <typename LEX>
+    static void parse_option_sized(Option &opt, const std::string &line, std::vector<std::string> &terms, Limits *lim)
+    {
+        terms.clear();
+        Split::by_space_void<std::vector<std::string>, LEX, SpaceMatch, Limits>(terms, line, lim);
+        opt.reserve(terms.size());
+        for (auto &term : terms)
+            opt.push_back(std::move(term));
+    }
+
     // caller should call update_map() after this function
     void parse_from_config(const std::string &str, Limits *lim)
     {
@@ -1001,6 +1035,7 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
         int line_num = 0;
         bool in_multiline = false;
         Option multiline;
+        std::vector<std::string> terms;
         while (in(true))
         {
             ++line_num;
@@ -1030,7 +1065,8 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
             }
             else if (!ignore_line(line))
             {
-                Option opt = parse_option_from_line(line, lim);
+                Option opt;
+                parse_option_sized<LexComment>(opt, line, terms, lim);
                 if (opt.size())
                 {
                     if (is_open_tag(opt.ref(0)))
@@ -1562,9 +1598,8 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
     {
         if (!opt.empty())
         {
-            const size_t i = size();
             push_back(opt);
-            map_[opt.ref(0)].push_back((unsigned int)i);
+            extend_map();
         }
     }
 
@@ -1579,12 +1614,27 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
     void update_map()
     {
         map_.clear();
-        for (size_t i = 0; i < size(); ++i)
+        map_size_ = 0;
+        extend_map();
+    }
+
+    // Add options appended since the last update_map() or extend_map()
+    // call to the hash map.  Only valid if the options that were already
+    // mapped have not been modified, removed or reordered since then.
+    void extend_map()
+    {
+        if (map_size_ > size())
+        {
+            update_map();
+            return;
+        }
+        for (size_t i = map_size_; i < size(); ++i)
         {
             const Option &opt = (*this)[i];
             if (!opt.empty())
                 map_[opt.ref(0)].push_back((unsigned int)i);
         }
+        map_size_ = size();
     }
 
     // return true if line is blank or a comment
@@ -1706,6 +1756,7 @@ class OptionList : public std::vector<Option>, public RCCopyable<thread_unsafe_r
     }
 
     IndexMap map_;
+    size_t map_size_ = 0; // number of leading options indexed by map_
 };
 
 } // namespace openvpn
@@ -0,0 +1,82 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+#ifndef OPENVPN_COMPRESS_ADAPTIVE_H
+#define OPENVPN_COMPRESS_ADAPTIVE_H
+
+// Decide whether a compressor should bother compressing the next packet,
+// based on how well recent packets compressed.
+//
+// After FAIL_THRESHOLD consecutive packets that didn't shrink by at least
+// 1/MIN_GAIN_DIV of their size (typical for traffic that is already
+// encrypted or compressed inside the tunnel), compression is bypassed for
+// a number of packets.  Then a single packet is probed: if it compresses
+// well, normal operation resumes, otherwise the bypass period doubles, up
+// to MAX_SKIP packets.  Since uncompressed packets are always valid on the
+// wire, this only affects the sender.
+
+#include <cstddef>
+#include <algorithm>
+
+namespace openvpn {
+
+class CompressAdaptive
+{
+  public:
+    enum
+    {
+        FAIL_THRESHOLD = 8,
+        MIN_SKIP = 32,
+        MAX_SKIP = 4096,
+        MIN_GAIN_DIV = 32,
+    };
+
+    // true if the next packet should be run through the compressor
+    bool attempt()
+    {
+        if (!skip)
+            return true;
+        --skip;
+        return false;
+    }
+
+    // report the outcome of a compression attempt
+    void result(const size_t in_size, const size_t out_size)
+    {
+        if (out_size + in_size / MIN_GAIN_DIV < in_size)
+        {
+            failures = 0;
+            backoff = 0;
+        }
+        else if (++failures >= FAIL_THRESHOLD)
+        {
+            backoff = backoff ? std::min(backoff * 2, size_t(MAX_SKIP)) : size_t(MIN_SKIP);
+            skip = backoff;
+
+            // the probe after the bypass period decides on its own
+            failures = FAIL_THRESHOLD - 1;
+        }
+    }
+
+    bool bypassing() const
+    {
+        return skip != 0;
+    }
+
+  private:
+    size_t failures = 0;
+    size_t backoff = 0;
+    size_t skip = 0;
+};
+
+} // namespace openvpn
+
+#endif
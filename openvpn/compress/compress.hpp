@@ -168,8 +168,11 @@ class CompressContext
     {
     }
 
-    CompressContext(const Type t, const bool asym)
-        : asym_(asym) // asym indicates asymmetrical compression where only downlink is compressed
+    // asym indicates asymmetrical compression where only downlink is compressed,
+    // adaptive lets LZ4 skip compression while traffic proves incompressible
+    CompressContext(const Type t, const bool asym, const bool adaptive = false)
+        : asym_(asym),
+          adaptive_(adaptive)
     {
         if (!compressor_available(t))
             throw compressor_unavailable();
@@ -184,6 +187,10 @@ class CompressContext
     {
         return asym_;
     }
+    bool adaptive() const
+    {
+        return adaptive_;
+    }
 
     unsigned int extra_payload_bytes() const
     {
@@ -221,9 +228,9 @@ class CompressContext
 #endif
 #ifdef HAVE_LZ4
         case LZ4:
-            return new CompressLZ4(frame, stats, asym_);
+            return new CompressLZ4(frame, stats, asym_, adaptive_);
         case LZ4v2:
-            return new CompressLZ4v2(frame, stats, asym_);
+            return new CompressLZ4v2(frame, stats, asym_, adaptive_);
 #endif
 #ifdef HAVE_SNAPPY
         case SNAPPY:
@@ -530,6 +537,7 @@ class CompressContext
   private:
     Type type_ = NONE;
     bool asym_ = false;
+    bool adaptive_ = false;
 };
 
 } // namespace openvpn
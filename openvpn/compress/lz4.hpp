@@ -18,6 +18,7 @@
 #include <algorithm> // for std::max
 
 #include <openvpn/common/numeric_util.hpp>
+#include <openvpn/compress/adaptive.hpp>
 
 #include <lz4.h>
 
@@ -26,8 +27,9 @@ namespace openvpn {
 class CompressLZ4Base : public Compress
 {
   protected:
-    CompressLZ4Base(const Frame::Ptr &frame, const SessionStats::Ptr &stats)
-        : Compress(frame, stats)
+    CompressLZ4Base(const Frame::Ptr &frame, const SessionStats::Ptr &stats, const bool adaptive_arg)
+        : Compress(frame, stats),
+          adaptive_enabled(adaptive_arg)
     {
     }
 
@@ -58,6 +60,10 @@ class CompressLZ4Base : public Compress
 
     bool do_compress(BufferAllocated &buf)
     {
+        // skip packets while recent ones proved incompressible
+        if (adaptive_enabled && !adaptive.attempt())
+            return false;
+
         // initialize work buffer
         frame->prepare(Frame::COMPRESS_WORK, work);
 
@@ -73,15 +79,17 @@ class CompressLZ4Base : public Compress
                                                             (char *)work.data(),
                                                             (int)buf.size(),
                                                             (int)work.capacity());
+        if (comp_size <= 0)
+        {
+            error(buf);
+            return false;
+        }
+        if (adaptive_enabled)
+            adaptive.result(buf.size(), comp_size);
 
         // did compression actually reduce data length?
         if (comp_size < buf.size())
         {
-            if (comp_size <= 0)
-            {
-                error(buf);
-                return false;
-            }
             OVPN_LOG_VERBOSE("LZ4 compress " << buf.size() << " -> " << comp_size);
             work.set_size(comp_size);
             buf.swap(work);
@@ -105,6 +113,8 @@ class CompressLZ4Base : public Compress
     }
 
     BufferAllocated work;
+    const bool adaptive_enabled;
+    CompressAdaptive adaptive;
 };
 
 class CompressLZ4 : public CompressLZ4Base
@@ -116,11 +126,11 @@ class CompressLZ4 : public CompressLZ4Base
     };
 
   public:
-    CompressLZ4(const Frame::Ptr &frame, const SessionStats::Ptr &stats, const bool asym_arg)
-        : CompressLZ4Base(frame, stats),
+    CompressLZ4(const Frame::Ptr &frame, const SessionStats::Ptr &stats, const bool asym_arg, const bool adaptive_arg = false)
+        : CompressLZ4Base(frame, stats, adaptive_arg),
           asym(asym_arg)
     {
-        OVPN_LOG_INFO("LZ4 init asym=" << asym_arg);
+        OVPN_LOG_INFO("LZ4 init asym=" << asym_arg << " adaptive=" << adaptive_arg);
     }
 
     const char *name() const override
@@ -175,11 +185,11 @@ class CompressLZ4 : public CompressLZ4Base
 class CompressLZ4v2 : public CompressLZ4Base
 {
   public:
-    CompressLZ4v2(const Frame::Ptr &frame, const SessionStats::Ptr &stats, const bool asym_arg)
-        : CompressLZ4Base(frame, stats),
+    CompressLZ4v2(const Frame::Ptr &frame, const SessionStats::Ptr &stats, const bool asym_arg, const bool adaptive_arg = false)
+        : CompressLZ4Base(frame, stats, adaptive_arg),
           asym(asym_arg)
     {
-        OVPN_LOG_INFO("LZ4v2 init asym=" << asym_arg);
+        OVPN_LOG_INFO("LZ4v2 init asym=" << asym_arg << " adaptive=" << adaptive_arg);
     }
 
     const char *name() const override
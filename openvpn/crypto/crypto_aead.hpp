@@ -14,7 +14,9 @@
 #ifndef OPENVPN_CRYPTO_CRYPTO_AEAD_H
 #define OPENVPN_CRYPTO_CRYPTO_AEAD_H
 
-#include <cstring> // for std::memcpy, std::memset
+#include <algorithm> // for std::min
+#include <cstring>   // for std::memcpy, std::memset
+#include <vector>
 
 #include <openvpn/common/size.hpp>
 #include <openvpn/common/exception.hpp>
@@ -154,12 +156,21 @@ class Crypto : public CryptoDCInstance
         static constexpr std::size_t op32_size = 4;
     };
 
+    // packets per call of CipherContextAEAD::encrypt_batch()/decrypt_batch()
+    enum
+    {
+        BATCH_MAX = 64
+    };
+
+    typedef typename CRYPTO_API::CipherContextAEAD::Op CipherOp;
+
     struct Encrypt
     {
         typename CRYPTO_API::CipherContextAEAD impl;
         Nonce nonce;
         PacketIDDataSend pid_send{false};
         BufferAllocated work;
+        std::vector<BufferAllocated> batch_work; // work buffers of a batch
     };
 
     struct Decrypt
@@ -168,6 +179,7 @@ class Crypto : public CryptoDCInstance
         Nonce nonce;
         PacketIDDataReceive pid_recv{};
         BufferAllocated work;
+        std::vector<BufferAllocated> batch_work;
     };
 
   public:
@@ -299,6 +311,23 @@ class Crypto : public CryptoDCInstance
         return Error::SUCCESS;
     }
 
+    // The batch methods build the nonce and work buffer of every packet
+    // first, and then hand the whole batch to the cipher context, which
+    // is where a multi-buffer AES-GCM or ChaCha20-Poly1305 kernel would
+    // interleave the packets.  Output is the same as per packet.
+    bool encrypt_batch(BufferAllocated *bufs, const size_t n, const unsigned char *op32) override
+    {
+        for (size_t i = 0; i < n; i += BATCH_MAX)
+            encrypt_chunk(bufs + i, std::min(n - i, size_t(BATCH_MAX)), op32);
+        return e.pid_send.wrap_warning();
+    }
+
+    void decrypt_batch(BufferAllocated *bufs, Error::Type *results, const size_t n, const std::time_t now, const unsigned char *op32) override
+    {
+        for (size_t i = 0; i < n; i += BATCH_MAX)
+            decrypt_chunk(bufs + i, results + i, std::min(n - i, size_t(BATCH_MAX)), now, op32);
+    }
+
     // Initialization
 
     // TODO: clamp_to_default probably will cause an error further along if triggered, investigate
@@ -356,6 +385,142 @@ class Crypto : public CryptoDCInstance
     }
 
   private:
+    void encrypt_chunk(BufferAllocated *bufs, const size_t n, const unsigned char *op32)
+    {
+        constexpr size_t tag_len = CRYPTO_API::CipherContextAEAD::AUTH_TAG_LEN;
+        Nonce nonces[BATCH_MAX];
+        CipherOp ops[BATCH_MAX];
+        size_t index[BATCH_MAX];
+        if (e.batch_work.size() < n)
+            e.batch_work.resize(n);
+
+        // build nonce and output layout of each non-null packet, as encrypt() does
+        size_t n_ops = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            BufferAllocated &buf = bufs[i];
+            if (!buf.size())
+                continue;
+            BufferAllocated &work = e.batch_work[i];
+            Nonce &nonce = nonces[n_ops];
+            nonce = Nonce(e.nonce, e.pid_send, op32);
+
+            frame->prepare(Frame::ENCRYPT_WORK, work);
+            if (work.max_size() < buf.size())
+                throw aead_error("encrypt work buffer too small");
+            unsigned char *work_data = work.write_alloc(buf.size());
+            unsigned char *auth_tag;
+            if (dc_settings.aeadTagAtTheEnd())
+                auth_tag = work.write_alloc(tag_len);
+            else if (e.impl.requires_authtag_at_end())
+            {
+                // the tag is moved to the front below
+                work.prepend_alloc(tag_len);
+                auth_tag = work.write_alloc(tag_len);
+            }
+            else
+                auth_tag = work.prepend_alloc(tag_len);
+
+            ops[n_ops] = {buf.c_data(), work_data, buf.size(), nonce.iv(), auth_tag, nonce.ad(), nonce.ad_len(e.pid_send), false};
+            index[n_ops++] = i;
+        }
+
+        e.impl.encrypt_batch(ops, n_ops);
+
+        for (size_t j = 0; j < n_ops; ++j)
+        {
+            BufferAllocated &buf = bufs[index[j]];
+            BufferAllocated &work = e.batch_work[index[j]];
+            if (!dc_settings.aeadTagAtTheEnd() && e.impl.requires_authtag_at_end())
+            {
+                std::memcpy(work.data(), ops[j].tag, tag_len);
+                work.inc_size(-tag_len);
+            }
+            buf.swap(work);
+            nonces[j].prepend_ad(buf, e.pid_send);
+        }
+    }
+
+    void decrypt_chunk(BufferAllocated *bufs, Error::Type *results, const size_t n, const std::time_t now, const unsigned char *op32)
+    {
+        constexpr size_t tag_len = CRYPTO_API::CipherContextAEAD::AUTH_TAG_LEN;
+        Nonce nonces[BATCH_MAX];
+        CipherOp ops[BATCH_MAX];
+        size_t index[BATCH_MAX];
+        if (d.batch_work.size() < n)
+            d.batch_work.resize(n);
+
+        // parse nonce and auth tag of each non-null packet, as decrypt() does
+        size_t n_ops = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            BufferAllocated &buf = bufs[i];
+            results[i] = Error::SUCCESS;
+            if (!buf.size())
+                continue;
+            try
+            {
+                BufferAllocated &work = d.batch_work[i];
+                Nonce &nonce = nonces[n_ops];
+                nonce = Nonce(d.nonce, d.pid_recv, buf, op32);
+
+                unsigned char *auth_tag = nullptr;
+                if (!dc_settings.aeadTagAtTheEnd())
+                    auth_tag = buf.read_alloc(tag_len);
+
+                frame->prepare(Frame::DECRYPT_WORK, work);
+                if (work.max_size() < buf.size())
+                    throw aead_error("decrypt work buffer too small");
+
+                if (auth_tag && e.impl.requires_authtag_at_end())
+                {
+                    unsigned char *auth_tag_end = buf.write_alloc(tag_len);
+                    std::memcpy(auth_tag_end, auth_tag, tag_len);
+                    auth_tag = nullptr;
+                }
+                if (!auth_tag && buf.size() < tag_len)
+                    throw aead_error("decrypt input too short");
+
+                ops[n_ops] = {buf.c_data(), work.data(), buf.size(), nonce.iv(), auth_tag, nonce.ad(), nonce.ad_len(d.pid_recv), false};
+                index[n_ops++] = i;
+            }
+            catch (const std::exception &)
+            {
+                buf.reset_size();
+                results[i] = Error::BUFFER_ERROR;
+            }
+        }
+
+        d.impl.decrypt_batch(ops, n_ops);
+
+        // packet IDs are only checked, in order, once a packet is authenticated
+        for (size_t j = 0; j < n_ops; ++j)
+        {
+            const size_t i = index[j];
+            BufferAllocated &buf = bufs[i];
+            BufferAllocated &work = d.batch_work[i];
+            if (!ops[j].ok)
+            {
+                buf.reset_size();
+                results[i] = Error::DECRYPT_ERROR;
+                continue;
+            }
+
+            if (!ops[j].tag)
+                work.set_size(buf.size() - tag_len);
+            else
+                work.set_size(buf.size());
+
+            if (!nonces[j].verify_packet_id(d.pid_recv, now))
+            {
+                buf.reset_size();
+                results[i] = Error::REPLAY_ERROR;
+                continue;
+            }
+            buf.swap(work);
+        }
+    }
+
     CryptoDCSettingsData dc_settings;
     Frame::Ptr frame;
     SessionStats::Ptr stats;
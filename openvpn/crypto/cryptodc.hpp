@@ -42,6 +42,41 @@ class CryptoDCInstance : public RC<thread_unsafe_refcount>
 
     virtual Error::Type decrypt(BufferAllocated &buf, std::time_t now, const unsigned char *op32) = 0;
 
+    // Batched Encrypt/Decrypt
+
+    // Encrypt n buffers in order, with the same result as calling encrypt()
+    // on each of them.  Implementations may override this to amortize
+    // per-packet dispatch and context setup over the batch.
+    // Returns true if packet ID is close to wrapping.
+    virtual bool encrypt_batch(BufferAllocated *bufs, const size_t n, const unsigned char *op32)
+    {
+        bool wrap_warning = false;
+        for (size_t i = 0; i < n; ++i)
+            wrap_warning |= encrypt(bufs[i], op32);
+        return wrap_warning;
+    }
+
+    // Decrypt n buffers in order, with the same result as calling decrypt()
+    // on each of them.  The status of each packet is returned in results[],
+    // which must have room for n entries.  A packet that decrypt() would
+    // throw on, e.g. because it is truncated, is emptied and gets
+    // BUFFER_ERROR, so that it doesn't abort the rest of the batch.
+    virtual void decrypt_batch(BufferAllocated *bufs, Error::Type *results, const size_t n, std::time_t now, const unsigned char *op32)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            try
+            {
+                results[i] = decrypt(bufs[i], now, op32);
+            }
+            catch (const std::exception &)
+            {
+                bufs[i].reset_size();
+                results[i] = Error::BUFFER_ERROR;
+            }
+        }
+    }
+
     // Initialization
 
     // return value of defined()
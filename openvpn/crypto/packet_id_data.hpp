@@ -253,12 +253,22 @@ class PacketIDDataSend
  *
  * Replay window sizing in bytes = 2^REPLAY_WINDOW_ORDER.
  * PKTID_RECV_EXPIRE is backtrack expire in seconds.
+ *
+ * The history is a ring of 64-bit words, each covering 64 consecutive
+ * packet IDs, so that advancing the window clears whole words instead
+ * of walking it bit by bit.  One word more than the window size is
+ * kept, so that the word holding id_high never aliases the oldest IDs
+ * still inside the window.  This keeps the per-packet cost independent of
+ * the window size, which makes large windows (e.g. order 12, 2^15
+ * packets) practical for fast or heavily reordered links.
  */
 template <unsigned int REPLAY_WINDOW_ORDER,
           unsigned int PKTID_RECV_EXPIRE>
 class PacketIDDataReceiveType
 {
   public:
+    static_assert(REPLAY_WINDOW_ORDER >= 3, "replay window must be at least 64 packets");
+
     static constexpr unsigned int REPLAY_WINDOW_BYTES = 1u << REPLAY_WINDOW_ORDER;
     static constexpr unsigned int REPLAY_WINDOW_SIZE = REPLAY_WINDOW_BYTES * 8;
 
@@ -268,8 +278,8 @@ class PacketIDDataReceiveType
               const SessionStats::Ptr &stats_arg)
     {
         wide = wide_arg;
-        base = 0;
         extent = 0;
+        cur_word = 0;
         expire = 0;
         id_high = 0;
         id_floor = 0;
@@ -324,63 +334,42 @@ class PacketIDDataReceiveType
         if (unlikely(!pin.is_valid()))
             return Error::PKTID_INVALID;
 
-
-        if (likely(pin.id == id_high + 1))
-        {
-            // well-formed ID sequence (incremented by 1)
-            base = replay_index(-1);
-            history[base / 8] |= static_cast<uint8_t>(1 << (base % 8));
-            if (extent < REPLAY_WINDOW_SIZE)
-                ++extent;
-            id_high = pin.id;
-        }
-        else if (pin.id > id_high)
+        if (likely(pin.id > id_high))
         {
-            // ID jumped forward by more than one
-
-            const auto delta = pin.id - id_high;
-            if (delta < REPLAY_WINDOW_SIZE)
+            // ID moved forward, clear the words we are moving into
+            const PacketIDData::data_id_t delta = pin.id - id_high;
+            const PacketIDData::data_id_t words = pin.id / WORD_BITS - id_high / WORD_BITS;
+            if (unlikely(words >= N_WORDS))
+                std::memset(history, 0, sizeof(history));
+            else
             {
-                base = replay_index(-delta);
-                history[base / 8] |= static_cast<uint8_t>(1u << (base % 8));
-                extent += static_cast<std::size_t>(delta);
-                if (extent > REPLAY_WINDOW_SIZE)
-                    extent = REPLAY_WINDOW_SIZE;
-                for (unsigned i = 1; i < delta; ++i)
+                for (PacketIDData::data_id_t i = 0; i < words; ++i)
                 {
-                    const auto newbase = replay_index(i);
-                    history[newbase / 8] &= static_cast<uint8_t>(~(1u << (newbase % 8)));
+                    cur_word = cur_word + 1 < N_WORDS ? cur_word + 1 : 0;
+                    history[cur_word] = 0;
                 }
             }
-            else
-            {
-                base = 0;
-                extent = REPLAY_WINDOW_SIZE;
-                std::memset(history, 0, sizeof(history));
-                history[0] = 1;
-            }
+
+            history[cur_word] |= bit_mask(pin.id);
+            extent = delta < REPLAY_WINDOW_SIZE - extent ? extent + static_cast<std::size_t>(delta) : REPLAY_WINDOW_SIZE;
             id_high = pin.id;
         }
         else
         {
             // ID backtrack
             const auto delta = id_high - pin.id;
-            if (delta < extent)
-            {
-                if (pin.id > id_floor)
-                {
-                    const auto ri = replay_index(delta);
-                    std::uint8_t *p = &history[ri / 8];
-                    const std::uint8_t mask = static_cast<uint8_t>(1u << (ri % 8));
-                    if (*p & mask)
-                        return Error::PKTID_REPLAY;
-                    *p |= mask;
-                }
-                else
-                    return Error::PKTID_EXPIRE;
-            }
-            else
+            if (unlikely(delta >= extent))
                 return Error::PKTID_BACKTRACK;
+            if (unlikely(pin.id <= id_floor))
+                return Error::PKTID_EXPIRE;
+
+            // delta < extent, so the word is less than N_WORDS behind cur_word
+            const std::size_t back = static_cast<std::size_t>(id_high / WORD_BITS - pin.id / WORD_BITS);
+            std::uint64_t &word = history[cur_word >= back ? cur_word - back : cur_word + N_WORDS - back];
+            const std::uint64_t mask = bit_mask(pin.id);
+            if (word & mask)
+                return Error::PKTID_REPLAY;
+            word |= mask;
         }
 
         return Error::SUCCESS;
@@ -406,13 +395,16 @@ class PacketIDDataReceiveType
     }
 
   private:
-    [[nodiscard]] constexpr std::size_t replay_index(PacketIDData::data_id_t i) const
+    static constexpr unsigned int WORD_BITS = 64;
+    static constexpr unsigned int N_WORDS = REPLAY_WINDOW_SIZE / WORD_BITS + 1;
+
+    static constexpr std::uint64_t bit_mask(const PacketIDData::data_id_t id)
     {
-        return (base + i) & (REPLAY_WINDOW_SIZE - 1);
+        return std::uint64_t(1) << (id % WORD_BITS);
     }
 
-    std::size_t base;                 // bit position of deque base in history
-    std::size_t extent;               // extent (in bits) of deque in history
+    std::size_t extent;               // extent (in packets) of the window behind id_high
+    std::size_t cur_word;             // index of the history word holding id_high
     Time::base_type expire;           // expiration of history
     PacketIDData::data_id_t id_high;  // highest sequence number received
     PacketIDData::data_id_t id_floor; // we will only accept backtrack IDs > id_floor
@@ -424,8 +416,8 @@ class PacketIDDataReceiveType
 
     SessionStats::Ptr stats;
 
-    //! "sliding window" bitmask of recent packet IDs received */
-    std::uint8_t history[REPLAY_WINDOW_BYTES];
+    //! "sliding window" bitmap of recent packet IDs received, indexed by ID
+    std::uint64_t history[N_WORDS];
 };
 
 // Our standard packet ID window with order=8 (window size=2048).
@@ -20,6 +20,18 @@
 
 namespace openvpn {
 
+// Buffer flags for packet buffers.  Define OPENVPN_BUFFER_POOL to
+// recycle packet buffers through a per-thread BufferPool instead of
+// the general allocator.
+inline unsigned int frame_buffer_flags()
+{
+#ifdef OPENVPN_BUFFER_POOL
+    return BufAllocFlags::POOL;
+#else
+    return 0;
+#endif
+}
+
 inline Frame::Ptr frame_init(const bool align_adjust_3_1,
                              const size_t tun_mtu_max,
                              const size_t control_channel_payload,
@@ -29,7 +41,7 @@ inline Frame::Ptr frame_init(const bool align_adjust_3_1,
     const size_t headroom = 512;
     const size_t tailroom = 512;
     const size_t align_block = 16;
-    const unsigned int buffer_flags = 0;
+    const unsigned int buffer_flags = frame_buffer_flags();
 
     Frame::Ptr frame(new Frame(Frame::Context(headroom, payload, tailroom, 0, align_block, buffer_flags)));
     if (align_adjust_3_1)
@@ -63,7 +75,7 @@ inline Frame::Context frame_init_context_simple(const size_t payload)
     const size_t headroom = 512;
     const size_t tailroom = 512;
     const size_t align_block = 16;
-    const unsigned int buffer_flags = 0;
+    const unsigned int buffer_flags = frame_buffer_flags();
     return Frame::Context(headroom, payload, tailroom, 0, align_block, buffer_flags);
 }
 
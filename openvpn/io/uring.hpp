@@ -0,0 +1,549 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Optional io_uring backend for the packet data path on Linux.
+//
+// An IOUring::Service is attached to an io_context and owns a single
+// ring.  Link objects submit operations (IOUring::Op) to it; submissions
+// are batched into one io_uring_enter() per event loop turn, and
+// completions are reaped from the mapped completion queue when the
+// ring fd becomes readable in the asio reactor.  If the kernel doesn't
+// provide io_uring (or it is blocked by seccomp), Service::get()
+// returns nullptr and callers keep using their asio code paths.
+//
+// The io_context that owns the service must be run by a single thread.
+
+#pragma once
+
+#include <openvpn/common/platform.hpp>
+
+#if defined(OPENVPN_PLATFORM_LINUX) && !defined(OPENVPN_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define OPENVPN_IO_URING
+#endif
+#endif
+
+#ifdef OPENVPN_IO_URING
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include <openvpn/io/io.hpp>
+#include <openvpn/common/exception.hpp>
+#include <openvpn/common/rc.hpp>
+
+#ifndef IORING_REGISTER_PBUF_RING
+#define IORING_REGISTER_PBUF_RING 22
+#endif
+#ifndef IORING_RECV_MULTISHOT
+#define IORING_RECV_MULTISHOT (1U << 1)
+#endif
+
+namespace openvpn::IOUring {
+
+OPENVPN_EXCEPTION(io_uring_error);
+
+// An operation submitted to the ring.  The service holds a reference
+// while the operation is in flight.  complete() is called from the
+// io_context for each completion; flags contains IORING_CQE_F_MORE if
+// a multishot operation will complete again.
+class Op : public RC<thread_unsafe_refcount>
+{
+  public:
+    typedef RCPtr<Op> Ptr;
+
+    virtual void complete(const int res, const unsigned int flags) = 0;
+};
+
+// Thin wrapper around the raw io_uring system calls and shared rings.
+class Ring
+{
+  public:
+    Ring(const unsigned int entries)
+    {
+        struct io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 4;
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0)
+            throw io_uring_error(std::string("io_uring_setup: ") + std::strerror(errno));
+
+        sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+        cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            sq_map_size = cq_map_size = std::max(sq_map_size, cq_map_size);
+
+        sq_map = map(sq_map_size, IORING_OFF_SQ_RING);
+        cq_map = single ? sq_map : map(cq_map_size, IORING_OFF_CQ_RING);
+        sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = (struct io_uring_sqe *)map(sqes_size, IORING_OFF_SQES);
+        if (!sq_map || !cq_map || !sqes)
+        {
+            const int eno = errno;
+            cleanup();
+            throw io_uring_error(std::string("io_uring mmap: ") + std::strerror(eno));
+        }
+
+        unsigned char *sq = (unsigned char *)sq_map;
+        sq_head = (unsigned int *)(sq + p.sq_off.head);
+        sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+        sq_mask = *(unsigned int *)(sq + p.sq_off.ring_mask);
+        sq_entries = p.sq_entries;
+        sq_array = (unsigned int *)(sq + p.sq_off.array);
+        sq_local_tail = *sq_tail;
+
+        unsigned char *cq = (unsigned char *)cq_map;
+        cq_head = (unsigned int *)(cq + p.cq_off.head);
+        cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+        cq_mask = *(unsigned int *)(cq + p.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    }
+
+    ~Ring()
+    {
+        cleanup();
+    }
+
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    int native_handle() const
+    {
+        return fd;
+    }
+
+    // Returns a zeroed SQE, or nullptr if the submission queue is full
+    struct io_uring_sqe *get_sqe()
+    {
+        const unsigned int head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (sq_local_tail - head >= sq_entries)
+            return nullptr;
+        const unsigned int idx = sq_local_tail & sq_mask;
+        struct io_uring_sqe *sqe = &sqes[idx];
+        sq_array[idx] = idx;
+        ++sq_local_tail;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // SQEs not yet consumed by the kernel
+    unsigned int pending() const
+    {
+        return sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    }
+
+    // Submit pending SQEs and optionally wait for min_complete completions.
+    // Returns the number of SQEs consumed, or -errno.
+    int submit(const unsigned int min_complete = 0)
+    {
+        const unsigned int n = pending();
+        __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+        if (!n && !min_complete)
+            return 0;
+        int ret;
+        do
+        {
+            ret = static_cast<int>(::syscall(__NR_io_uring_enter,
+                                             fd,
+                                             n,
+                                             min_complete,
+                                             min_complete ? IORING_ENTER_GETEVENTS : 0,
+                                             nullptr,
+                                             0));
+        } while (ret < 0 && errno == EINTR);
+        return ret < 0 ? -errno : ret;
+    }
+
+    // Completions not yet reaped
+    unsigned int ready() const
+    {
+        return __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) - *cq_head;
+    }
+
+    // Call f(cqe) for every available completion, returns the count
+    template <typename F>
+    unsigned int reap(F &&f)
+    {
+        unsigned int head = *cq_head;
+        unsigned int count = 0;
+        while (true)
+        {
+            const unsigned int tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            if (head == tail)
+                break;
+            const struct io_uring_cqe cqe = cqes[head & cq_mask];
+            __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+            f(cqe);
+            ++count;
+        }
+        return count;
+    }
+
+    int register_op(const unsigned int opcode, void *arg, const unsigned int nr_args)
+    {
+        const int ret = static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+        return ret < 0 ? -errno : ret;
+    }
+
+  private:
+    void *map(const size_t size, const off_t offset)
+    {
+        void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    void cleanup()
+    {
+        if (sqes)
+            ::munmap(sqes, sqes_size);
+        if (cq_map && cq_map != sq_map)
+            ::munmap(cq_map, cq_map_size);
+        if (sq_map)
+            ::munmap(sq_map, sq_map_size);
+        if (fd >= 0)
+            ::close(fd);
+        sqes = nullptr;
+        sq_map = cq_map = nullptr;
+        fd = -1;
+    }
+
+    int fd = -1;
+
+    void *sq_map = nullptr;
+    void *cq_map = nullptr;
+    size_t sq_map_size = 0;
+    size_t cq_map_size = 0;
+    struct io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned int *sq_head = nullptr;
+    unsigned int *sq_tail = nullptr;
+    unsigned int *sq_array = nullptr;
+    unsigned int sq_mask = 0;
+    unsigned int sq_entries = 0;
+    unsigned int sq_local_tail = 0;
+
+    unsigned int *cq_head = nullptr;
+    unsigned int *cq_tail = nullptr;
+    unsigned int cq_mask = 0;
+    struct io_uring_cqe *cqes = nullptr;
+};
+
+// A ring of provided buffers (IORING_REGISTER_PBUF_RING) used by
+// multishot receives: the kernel picks a buffer for each completion
+// and reports its id in the CQE, and we hand it back with recycle()
+// once the data has been consumed.
+class BufRing
+{
+  public:
+    typedef std::unique_ptr<BufRing> UPtr;
+
+    // entries must be a power of 2
+    BufRing(Ring &ring_arg, const unsigned short bgid_arg, const unsigned int entries_arg, const size_t buf_size_arg)
+        : ring(ring_arg),
+          bgid(bgid_arg),
+          entries(entries_arg),
+          buf_size(buf_size_arg)
+    {
+        ring_size = entries * sizeof(struct io_uring_buf);
+        bufs = (struct io_uring_buf *)::mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (bufs == MAP_FAILED)
+        {
+            bufs = nullptr;
+            throw io_uring_error("buffer ring mmap failed");
+        }
+
+        struct io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (std::uint64_t)bufs;
+        reg.ring_entries = entries;
+        reg.bgid = bgid;
+        const int ret = ring.register_op(IORING_REGISTER_PBUF_RING, &reg, 1);
+        if (ret < 0)
+        {
+            ::munmap(bufs, ring_size);
+            bufs = nullptr;
+            throw io_uring_error(std::string("IORING_REGISTER_PBUF_RING: ") + std::strerror(-ret));
+        }
+
+        // the tail is overlaid on the reserved field of the first entry
+        tail = (unsigned short *)((unsigned char *)bufs + offsetof(struct io_uring_buf, resv));
+        data.reset(new unsigned char[entries * buf_size]);
+        for (unsigned int i = 0; i < entries; ++i)
+            recycle(static_cast<unsigned short>(i));
+    }
+
+    ~BufRing()
+    {
+        if (bufs)
+        {
+            struct io_uring_buf_reg reg;
+            std::memset(&reg, 0, sizeof(reg));
+            reg.bgid = bgid;
+            ring.register_op(IORING_UNREGISTER_PBUF_RING, &reg, 1);
+            ::munmap(bufs, ring_size);
+        }
+    }
+
+    BufRing(const BufRing &) = delete;
+    BufRing &operator=(const BufRing &) = delete;
+
+    unsigned short group() const
+    {
+        return bgid;
+    }
+
+    size_t size() const
+    {
+        return buf_size;
+    }
+
+    unsigned char *buffer(const unsigned short bid) const
+    {
+        return data.get() + bid * buf_size;
+    }
+
+    // Give a buffer back to the kernel
+    void recycle(const unsigned short bid)
+    {
+        const unsigned short t = *tail;
+        struct io_uring_buf &b = bufs[t & (entries - 1)];
+        b.addr = (std::uint64_t)buffer(bid);
+        b.len = static_cast<std::uint32_t>(buf_size);
+        b.bid = bid;
+        __atomic_store_n(tail, static_cast<unsigned short>(t + 1), __ATOMIC_RELEASE);
+    }
+
+  private:
+    Ring &ring;
+    const unsigned short bgid;
+    const unsigned int entries;
+    const size_t buf_size;
+    size_t ring_size = 0;
+    struct io_uring_buf *bufs = nullptr;
+    unsigned short *tail = nullptr;
+    std::unique_ptr<unsigned char[]> data;
+};
+
+class Service : public openvpn_io::execution_context::service
+{
+  public:
+    enum
+    {
+        RING_ENTRIES = 256,
+    };
+
+    static inline openvpn_io::execution_context::id id;
+
+    explicit Service(openvpn_io::execution_context &ctx)
+        : openvpn_io::execution_context::service(ctx),
+          io_context(static_cast<openvpn_io::io_context &>(ctx))
+    {
+        try
+        {
+            ring.reset(new Ring(RING_ENTRIES));
+            notify.reset(new openvpn_io::posix::stream_descriptor(io_context, ::dup(ring->native_handle())));
+        }
+        catch (const std::exception &)
+        {
+            ring.reset();
+        }
+    }
+
+    // Returns the service for io_context, or nullptr if io_uring is unavailable
+    static Service *get(openvpn_io::io_context &io_context)
+    {
+        Service &svc = openvpn_io::use_service<Service>(static_cast<openvpn_io::execution_context &>(io_context));
+        return svc.ring ? &svc : nullptr;
+    }
+
+    // Returns a zeroed SQE, flushing the submission queue if it is full.
+    // The SQE must be passed to submit() before returning to the event loop.
+    struct io_uring_sqe *get_sqe()
+    {
+        struct io_uring_sqe *sqe = ring->get_sqe();
+        if (!sqe)
+        {
+            flush();
+            sqe = ring->get_sqe();
+            if (!sqe)
+                throw io_uring_error("submission queue full");
+        }
+        return sqe;
+    }
+
+    // Submit an SQE for op.  The actual io_uring_enter() is deferred
+    // until the end of the current event loop turn.
+    void submit(struct io_uring_sqe *sqe, Op *op)
+    {
+        sqe->user_data = (std::uint64_t)op;
+        intrusive_ptr_add_ref(op);
+        ++in_flight;
+        if (!flush_queued)
+        {
+            flush_queued = true;
+            openvpn_io::post(io_context, [this]()
+                             {
+                flush_queued = false;
+                flush(); });
+        }
+        wait();
+    }
+
+    // Cancel op (all its instances), submitting immediately so that the
+    // cancellation takes effect before the caller closes the fd
+    void cancel(Op *op)
+    {
+        struct io_uring_sqe *sqe = get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = (std::uint64_t)op;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = 0;
+        flush();
+    }
+
+    void flush()
+    {
+        if (!ring)
+            return;
+        if (ring->pending())
+            ring->submit();
+
+        // Completions posted while we were in io_uring_enter() don't
+        // reliably wake up the reactor, so check for them here
+        if (ring->ready() && !reap_queued)
+        {
+            reap_queued = true;
+            openvpn_io::post(io_context, [this]()
+                             {
+                reap_queued = false;
+                reap(); });
+        }
+    }
+
+    // Register a provided buffer ring, returns nullptr if not supported
+    BufRing *buf_ring(const unsigned int entries, const size_t buf_size)
+    {
+        for (auto &br : buf_rings)
+        {
+            if (br->size() == buf_size)
+                return br.get();
+        }
+        try
+        {
+            buf_rings.emplace_back(new BufRing(*ring, static_cast<unsigned short>(buf_rings.size()), entries, buf_size));
+            return buf_rings.back().get();
+        }
+        catch (const std::exception &)
+        {
+            return nullptr;
+        }
+    }
+
+  private:
+    void shutdown() override
+    {
+        if (!ring)
+            return;
+
+        // cancel everything and wait for the kernel to let go of our buffers
+        if (struct io_uring_sqe *sqe = ring->get_sqe())
+        {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+        }
+        for (int i = 0; i < 100 && in_flight; ++i)
+        {
+            ring->submit(1);
+            ring->reap([this](const struct io_uring_cqe &cqe)
+                       { release(cqe, false); });
+        }
+        notify.reset();
+        buf_rings.clear();
+        ring.reset();
+    }
+
+    void wait()
+    {
+        if (!waiting && in_flight)
+        {
+            waiting = true;
+            notify->async_wait(openvpn_io::posix::stream_descriptor::wait_read,
+                               [this](const openvpn_io::error_code &error)
+                               {
+                waiting = false;
+                if (!ring)
+                    return;
+                if (!error)
+                    reap();
+                else
+                    wait(); });
+        }
+    }
+
+    void reap()
+    {
+        if (!ring)
+            return;
+        ring->reap([this](const struct io_uring_cqe &cqe)
+                   { release(cqe, true); });
+        flush();
+
+        // The reactor is edge-triggered, but completions that arrive
+        // from here on are only reported by the next epoll_wait(),
+        // by which time the new wait is queued.  Nothing is queued
+        // once all operations are done, so that io_context::run()
+        // can return.
+        wait();
+    }
+
+    void release(const struct io_uring_cqe &cqe, const bool deliver)
+    {
+        Op *op = (Op *)cqe.user_data;
+        if (!op)
+            return;
+        if (deliver)
+            op->complete(cqe.res, cqe.flags);
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            intrusive_ptr_release(op);
+
+            // don't keep io_context::run() alive with nothing in flight
+            if (!--in_flight && waiting && deliver)
+                notify->cancel();
+        }
+    }
+
+    openvpn_io::io_context &io_context;
+    std::unique_ptr<Ring> ring;
+    std::unique_ptr<openvpn_io::posix::stream_descriptor> notify;
+    std::vector<BufRing::UPtr> buf_rings;
+    size_t in_flight = 0;
+    bool waiting = false;
+    bool flush_queued = false;
+    bool reap_queued = false;
+};
+
+} // namespace openvpn::IOUring
+
+#endif
@@ -9,11 +9,24 @@
 //    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
 //
 
-// IP checksum based on Linux kernel implementation
+// IP checksum based on Linux kernel implementation, with SSE2/AVX2/NEON
+// kernels for longer buffers selected at runtime
 
 #pragma once
 
 #include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define OPENVPN_CSUM_SSE2
+#if defined(__GNUC__)
+#define OPENVPN_CSUM_AVX2
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define OPENVPN_CSUM_NEON
+#endif
 
 #include <openvpn/common/endian.hpp>
 #include <openvpn/common/socktypes.hpp>
@@ -43,7 +56,8 @@ inline std::uint32_t cunfold(const std::uint16_t sum)
     return ~unfold(sum);
 }
 
-inline std::uint32_t compute(const std::uint8_t *buf, size_t len)
+// Portable implementation, also used for short buffers
+inline std::uint32_t compute_scalar(const std::uint8_t *buf, size_t len)
 {
     std::uint32_t result = 0;
 
@@ -105,6 +119,227 @@ inline std::uint32_t compute(const std::uint8_t *buf, size_t len)
     return result;
 }
 
+// Vector kernels return the sum of n 32-bit words in native byte order
+// as a 64-bit accumulator, the caller folds it down to 16 bits.
+enum class Kernel
+{
+    SCALAR,
+    SSE2,
+    AVX2,
+    NEON,
+};
+
+namespace detail {
+
+typedef std::uint64_t (*Sum32)(const std::uint8_t *buf, size_t n);
+
+inline std::uint64_t sum32_scalar(const std::uint8_t *buf, size_t n)
+{
+    std::uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::uint32_t w;
+        std::memcpy(&w, buf + i * 4, 4);
+        sum += w;
+    }
+    return sum;
+}
+
+#ifdef OPENVPN_CSUM_SSE2
+inline std::uint64_t sum32_sse2(const std::uint8_t *buf, size_t n)
+{
+    const __m128i mask = _mm_set1_epi64x(0xffffffff);
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    for (; n >= 8; n -= 8, buf += 32)
+    {
+        const __m128i v0 = _mm_loadu_si128((const __m128i *)buf);
+        const __m128i v1 = _mm_loadu_si128((const __m128i *)(buf + 16));
+        acc0 = _mm_add_epi64(acc0, _mm_and_si128(v0, mask));
+        acc1 = _mm_add_epi64(acc1, _mm_srli_epi64(v0, 32));
+        acc0 = _mm_add_epi64(acc0, _mm_and_si128(v1, mask));
+        acc1 = _mm_add_epi64(acc1, _mm_srli_epi64(v1, 32));
+    }
+    std::uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + sum32_scalar(buf, n);
+}
+#endif
+
+#ifdef OPENVPN_CSUM_AVX2
+__attribute__((target("avx2"))) inline std::uint64_t sum32_avx2(const std::uint8_t *buf, size_t n)
+{
+    const __m256i mask = _mm256_set1_epi64x(0xffffffff);
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    for (; n >= 16; n -= 16, buf += 64)
+    {
+        const __m256i v0 = _mm256_loadu_si256((const __m256i *)buf);
+        const __m256i v1 = _mm256_loadu_si256((const __m256i *)(buf + 32));
+        acc0 = _mm256_add_epi64(acc0, _mm256_and_si256(v0, mask));
+        acc1 = _mm256_add_epi64(acc1, _mm256_srli_epi64(v0, 32));
+        acc0 = _mm256_add_epi64(acc0, _mm256_and_si256(v1, mask));
+        acc1 = _mm256_add_epi64(acc1, _mm256_srli_epi64(v1, 32));
+    }
+    std::uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum32_scalar(buf, n);
+}
+#endif
+
+#ifdef OPENVPN_CSUM_NEON
+inline std::uint64_t sum32_neon(const std::uint8_t *buf, size_t n)
+{
+    uint64x2_t acc0 = vdupq_n_u64(0);
+    uint64x2_t acc1 = vdupq_n_u64(0);
+    for (; n >= 8; n -= 8, buf += 32)
+    {
+        acc0 = vpadalq_u32(acc0, vld1q_u32((const std::uint32_t *)buf));
+        acc1 = vpadalq_u32(acc1, vld1q_u32((const std::uint32_t *)(buf + 16)));
+    }
+    return vaddvq_u64(vaddq_u64(acc0, acc1)) + sum32_scalar(buf, n);
+}
+#endif
+
+inline Sum32 sum32(const Kernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef OPENVPN_CSUM_SSE2
+    case Kernel::SSE2:
+        return sum32_sse2;
+#endif
+#ifdef OPENVPN_CSUM_AVX2
+    case Kernel::AVX2:
+        return sum32_avx2;
+#endif
+#ifdef OPENVPN_CSUM_NEON
+    case Kernel::NEON:
+        return sum32_neon;
+#endif
+    default:
+        return sum32_scalar;
+    }
+}
+
+} // namespace detail
+
+inline bool kernel_available(const Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::SCALAR:
+        return true;
+#ifdef OPENVPN_CSUM_SSE2
+    case Kernel::SSE2:
+        return true;
+#endif
+#ifdef OPENVPN_CSUM_AVX2
+    case Kernel::AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef OPENVPN_CSUM_NEON
+    case Kernel::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+inline const char *kernel_name(const Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::SCALAR:
+        return "scalar";
+    case Kernel::SSE2:
+        return "sse2";
+    case Kernel::AVX2:
+        return "avx2";
+    case Kernel::NEON:
+        return "neon";
+    default:
+        return "unknown";
+    }
+}
+
+// fastest kernel supported by this CPU, detected once
+inline Kernel best_kernel()
+{
+    static const Kernel best = []()
+    {
+        for (const Kernel k : {Kernel::AVX2, Kernel::NEON, Kernel::SSE2})
+            if (kernel_available(k))
+                return k;
+        return Kernel::SCALAR;
+    }();
+    return best;
+}
+
+// Same result as compute_scalar(), using the given kernel for the bulk
+// of the buffer.  Below VECTOR_MIN bytes the setup isn't worth it.
+inline std::uint32_t compute(const std::uint8_t *buf, size_t len, const Kernel kernel)
+{
+    enum
+    {
+        VECTOR_MIN = 64,
+    };
+
+    if (len < VECTOR_MIN || kernel == Kernel::SCALAR)
+        return compute_scalar(buf, len);
+
+    std::uint64_t result = 0;
+    const bool odd = size_t(buf) & 1;
+    if (odd)
+    {
+#ifdef OPENVPN_LITTLE_ENDIAN
+        result += (*buf << 8);
+#else
+        result += *buf;
+#endif
+        len--;
+        buf++;
+    }
+    if (size_t(buf) & 2)
+    {
+        result += *(std::uint16_t *)buf;
+        len -= 2;
+        buf += 2;
+    }
+
+    const size_t n = len >> 2;
+    result += detail::sum32(kernel)(buf, n);
+    buf += n * 4;
+
+    if (len & 2)
+    {
+        result += *(std::uint16_t *)buf;
+        buf += 2;
+    }
+    if (len & 1)
+    {
+#ifdef OPENVPN_LITTLE_ENDIAN
+        result += *buf;
+#else
+        result += (*buf << 8);
+#endif
+    }
+
+    while (result >> 32)
+        result = (result & 0xffffffff) + (result >> 32);
+    std::uint32_t sum = fold(static_cast<std::uint32_t>(result));
+    if (odd)
+        sum = ((sum >> 8) & 0xff) | ((sum & 0xff) << 8);
+    return sum;
+}
+
+inline std::uint32_t compute(const std::uint8_t *buf, size_t len)
+{
+    return compute(buf, len, best_kernel());
+}
+
 inline std::uint32_t compute(const void *buf, const size_t len)
 {
     return compute((const std::uint8_t *)buf, len);
@@ -121,38 +356,44 @@ inline std::uint32_t partial(const void *buf, const size_t len, const std::uint3
     return result;
 }
 
+// 32-bit one's complement add
+inline std::uint32_t add32(std::uint32_t sum, const std::uint32_t v)
+{
+    sum += v;
+    return sum + (sum < v);
+}
+
 inline std::uint32_t diff16(const std::uint32_t *old,
                             const std::uint32_t *new_,
-                            const std::uint32_t oldsum)
+                            std::uint32_t oldsum)
 {
-    // clang-format off
-    std::uint32_t diff[8] = {~old[0], ~old[1], ~old[2], ~old[3],
-                             new_[0], new_[1], new_[2], new_[3]};
-    return partial(diff, sizeof(diff), oldsum);
-    // clang-format on
+    for (int i = 0; i < 4; ++i)
+        oldsum = add32(add32(oldsum, ~old[i]), new_[i]);
+    return oldsum;
 }
 
 inline std::uint32_t diff16(const std::uint8_t *old,
                             const std::uint8_t *new_,
                             const std::uint32_t oldsum)
 {
-    return diff16((const std::uint32_t *)old, (const std::uint32_t *)new_, oldsum);
+    std::uint32_t o[4], n[4];
+    std::memcpy(o, old, sizeof(o));
+    std::memcpy(n, new_, sizeof(n));
+    return diff16(o, n, oldsum);
 }
 
 inline std::uint32_t diff4(const std::uint32_t old,
                            const std::uint32_t new_,
                            const std::uint32_t oldsum)
 {
-    std::uint32_t diff[2] = {~old, new_};
-    return partial(diff, sizeof(diff), oldsum);
+    return add32(add32(oldsum, ~old), new_);
 }
 
 inline std::uint32_t diff2(const std::uint16_t old,
                            const std::uint16_t new_,
                            const std::uint32_t oldsum)
 {
-    std::uint16_t diff[2] = {std::uint16_t(~old), new_};
-    return partial(diff, sizeof(diff), oldsum);
+    return add32(add32(oldsum, std::uint16_t(~old)), new_);
 }
 
 inline std::uint16_t checksum(const void *data, const size_t size)
@@ -14,10 +14,14 @@
 #ifndef OPENVPN_LOG_SESSIONSTATS_H
 #define OPENVPN_LOG_SESSIONSTATS_H
 
+#include <array>
 #include <cstring>
+#include <functional>
+#include <memory>
 
 #include <openvpn/common/size.hpp>
 #include <openvpn/common/count.hpp>
+#include <openvpn/common/likely.hpp>
 #include <openvpn/common/rc.hpp>
 #include <openvpn/error/error.hpp>
 #include <openvpn/time/time.hpp>
@@ -61,6 +65,12 @@ class SessionStats : public RC<thread_safe_refcount>
         return verbose_;
     }
 
+    // Point-in-time copy of all counters, for readers that want a
+    // consistent view without calling get_stat() for every counter.
+    using Snapshot = std::array<count_t, N_STATS>;
+
+    // Called on every packet, so the common case of no registered
+    // callback only costs a counter add and a mask test.
 #ifdef OPENVPN_STATS_VIRTUAL
     virtual
 #endif
@@ -70,8 +80,8 @@ class SessionStats : public RC<thread_safe_refcount>
         if (type < N_STATS)
         {
             stats_[type] += value;
-            if (auto lock = inc_callbacks_[type].lock())
-                std::invoke(*lock, value);
+            if (unlikely(inc_callback_mask_ & (1u << type)))
+                inc_callback(type, value);
         }
     }
 
@@ -88,6 +98,14 @@ class SessionStats : public RC<thread_safe_refcount>
         return stats_[type];
     }
 
+    Snapshot snapshot() const
+    {
+        Snapshot snap;
+        for (size_t i = 0; i < N_STATS; ++i)
+            snap[i] = stats_[i];
+        return snap;
+    }
+
     static const char *stat_name(const size_t type)
     {
         static const char *names[] = {
@@ -226,17 +244,41 @@ class SessionStats : public RC<thread_safe_refcount>
      *
      * The callback can be removed by client code by deleting the returned shared pointer
      *
+     * Increments are accumulated and the callback is invoked with the
+     * accumulated value once it reaches \p batch, so that a callback
+     * that only needs to observe a minimum amount of traffic doesn't run
+     * on every packet.  Any remainder can be delivered with
+     * flush_inc_callbacks().
+     *
      * @param stat Type of stat to be tracked
      * @param callback Notification callback
+     * @param batch Minimum accumulated value before the callback is invoked (0 = every increment)
      * @return Shared pointer which maintains the lifetime of the callback
      */
-    [[nodiscard]] std::shared_ptr<inc_callback_t> set_inc_callback(Stats stat, inc_callback_t callback)
+    [[nodiscard]] std::shared_ptr<inc_callback_t> set_inc_callback(Stats stat, inc_callback_t callback, const count_t batch = 0)
     {
         auto cb_ptr = std::make_shared<inc_callback_t>(callback);
-        inc_callbacks_[stat] = cb_ptr;
+        IncCallback &cb = inc_callbacks_[stat];
+        cb.callback = cb_ptr;
+        cb.batch = batch;
+        cb.pending = 0;
+        inc_callback_mask_ |= (1u << stat);
         return cb_ptr;
     }
 
+    /**
+     * @brief Delivers any increments accumulated but not yet passed
+     *        to the callbacks registered with set_inc_callback()
+     */
+    void flush_inc_callbacks()
+    {
+        for (size_t type = 0; type < N_STATS; ++type)
+        {
+            if ((inc_callback_mask_ & (1u << type)) && inc_callbacks_[type].pending)
+                deliver_inc_callback(type);
+        }
+    }
+
   protected:
     void session_stats_set_verbose(const bool v)
     {
@@ -244,11 +286,41 @@ class SessionStats : public RC<thread_safe_refcount>
     }
 
   private:
+    struct IncCallback
+    {
+        std::weak_ptr<inc_callback_t> callback;
+        count_t batch = 0;
+        count_t pending = 0;
+    };
+
+    void inc_callback(const size_t type, const count_t value)
+    {
+        IncCallback &cb = inc_callbacks_[type];
+        cb.pending += value;
+        if (cb.pending >= cb.batch)
+            deliver_inc_callback(type);
+    }
+
+    void deliver_inc_callback(const size_t type)
+    {
+        IncCallback &cb = inc_callbacks_[type];
+        const count_t value = cb.pending;
+        cb.pending = 0;
+        if (auto lock = cb.callback.lock())
+            std::invoke(*lock, value);
+        else
+            inc_callback_mask_ &= ~(1u << type); // callback was released by its owner
+    }
+
+    // Keep the counters, which are written on every packet, on their own
+    // cache line, away from the refcount and the rarely touched members.
+    alignas(64) volatile count_t stats_[N_STATS];
+    unsigned int inc_callback_mask_ = 0;
+
     bool verbose_;
     Time last_packet_received_;
     DCOTransportSource::Ptr dco_;
-    volatile count_t stats_[N_STATS];
-    std::array<std::weak_ptr<inc_callback_t>, N_STATS> inc_callbacks_;
+    std::array<IncCallback, N_STATS> inc_callbacks_;
 };
 
 } // namespace openvpn
@@ -89,6 +89,21 @@ class CipherContextAEAD : public CipherContextCommon
 
 
 
+    // One packet of encrypt_batch() or decrypt_batch(), with the
+    // arguments of encrypt() or decrypt().  decrypt_batch() sets ok
+    // to the result of decrypt().
+    struct Op
+    {
+        const unsigned char *input;
+        unsigned char *output;
+        size_t length;
+        const unsigned char *iv;
+        unsigned char *tag;
+        const unsigned char *ad;
+        size_t ad_len;
+        bool ok;
+    };
+
     void encrypt(const unsigned char *input,
                  unsigned char *output,
                  size_t length,
@@ -98,19 +113,19 @@ class CipherContextAEAD : public CipherContextCommon
                  size_t ad_len)
     {
         check_initialized();
-        const int status = mbedtls_cipher_auth_encrypt_ext(&ctx,
-                                                           iv,
-                                                           IV_LEN,
-                                                           ad,
-                                                           ad_len,
-                                                           input,
-                                                           length,
-                                                           output,
-                                                           length + AUTH_TAG_LEN,
-                                                           &length,
-                                                           AUTH_TAG_LEN);
-        if (unlikely(status))
-            OPENVPN_THROW(mbedtls_aead_error, "mbedtls_cipher_auth_encrypt failed with status=" << status);
+        encrypt_packet(input, output, length, iv, tag, ad, ad_len);
+    }
+
+    // Encrypt n packets with the key set up by init().  The context is
+    // checked once per batch, and only the IV is reset per packet.
+    void encrypt_batch(Op *ops, const size_t n)
+    {
+        check_initialized();
+        for (size_t i = 0; i < n; ++i)
+        {
+            Op &op = ops[i];
+            encrypt_packet(op.input, op.output, op.length, op.iv, op.tag, op.ad, op.ad_len);
+        }
     }
 
     /**
@@ -136,7 +151,63 @@ class CipherContextAEAD : public CipherContextCommon
                  size_t ad_len)
     {
         check_initialized();
+        return decrypt_packet(input, output, length, iv, tag, ad, ad_len);
+    }
+
+    // Decrypt n packets, see encrypt_batch()
+    void decrypt_batch(Op *ops, const size_t n)
+    {
+        check_initialized();
+        for (size_t i = 0; i < n; ++i)
+        {
+            Op &op = ops[i];
+            op.ok = decrypt_packet(op.input, op.output, op.length, op.iv, op.tag, op.ad, op.ad_len);
+        }
+    }
+
+    bool is_initialized() const
+    {
+        return initialized;
+    }
+
+    static bool is_supported(void *libctx, const CryptoAlgs::Type alg)
+    {
+        unsigned int keysize;
+        return (cipher_type(alg, keysize) != MBEDTLS_CIPHER_NONE);
+    }
 
+  private:
+    void encrypt_packet(const unsigned char *input,
+                        unsigned char *output,
+                        size_t length,
+                        const unsigned char *iv,
+                        unsigned char *tag,
+                        const unsigned char *ad,
+                        size_t ad_len)
+    {
+        const int status = mbedtls_cipher_auth_encrypt_ext(&ctx,
+                                                           iv,
+                                                           IV_LEN,
+                                                           ad,
+                                                           ad_len,
+                                                           input,
+                                                           length,
+                                                           output,
+                                                           length + AUTH_TAG_LEN,
+                                                           &length,
+                                                           AUTH_TAG_LEN);
+        if (unlikely(status))
+            OPENVPN_THROW(mbedtls_aead_error, "mbedtls_cipher_auth_encrypt failed with status=" << status);
+    }
+
+    bool decrypt_packet(const unsigned char *input,
+                        unsigned char *output,
+                        size_t length,
+                        const unsigned char *iv,
+                        const unsigned char *tag,
+                        const unsigned char *ad,
+                        size_t ad_len)
+    {
         if (unlikely(tag != nullptr))
         {
             /* If we are called with a non-null tag, the function is not going to be able to decrypt */
@@ -159,18 +230,6 @@ class CipherContextAEAD : public CipherContextCommon
         return (olen == length - AUTH_TAG_LEN) && (status == 0);
     }
 
-    bool is_initialized() const
-    {
-        return initialized;
-    }
-
-    static bool is_supported(void *libctx, const CryptoAlgs::Type alg)
-    {
-        unsigned int keysize;
-        return (cipher_type(alg, keysize) != MBEDTLS_CIPHER_NONE);
-    }
-
-  private:
     static mbedtls_cipher_type_t cipher_type(const CryptoAlgs::Type alg, unsigned int &keysize)
     {
         switch (alg)
@@ -117,6 +117,21 @@ class CipherContextAEAD
         }
     }
 
+    // One packet of encrypt_batch() or decrypt_batch(), with the
+    // arguments of encrypt() or decrypt().  decrypt_batch() sets ok
+    // to the result of decrypt().
+    struct Op
+    {
+        const unsigned char *input;
+        unsigned char *output;
+        size_t length;
+        const unsigned char *iv;
+        unsigned char *tag;
+        const unsigned char *ad;
+        size_t ad_len;
+        bool ok;
+    };
+
     void encrypt(const unsigned char *input,
                  unsigned char *output,
                  size_t length,
@@ -124,11 +139,84 @@ class CipherContextAEAD
                  unsigned char *tag,
                  const unsigned char *ad,
                  size_t ad_len)
+    {
+        check_initialized();
+        encrypt_packet(input, output, length, iv, tag, ad, ad_len);
+    }
+
+    // Encrypt n packets with the key set up by init().  The context is
+    // checked once per batch, and only the IV is reset per packet.
+    void encrypt_batch(Op *ops, const size_t n)
+    {
+        check_initialized();
+        for (size_t i = 0; i < n; ++i)
+        {
+            Op &op = ops[i];
+            encrypt_packet(op.input, op.output, op.length, op.iv, op.tag, op.ad, op.ad_len);
+        }
+    }
+
+    /**
+     * Decrypts AEAD encrypted data. Note that if tag is the nullptr the tag is assumed to be
+     * part of input and at the end of the input. The length parameter of input includes the tag in
+     * this case
+     *
+     * @param input     Input data to decrypt
+     * @param output    Where decrypted data will be written to
+     * @param iv        IV of the encrypted data.
+     * @param length    length the of the data, this includes the tag at the end if tag is not a nullptr.
+     * @param ad        start of the additional data
+     * @param ad_len    length of the additional data
+     * @param tag       location of the tag to use or nullptr if at the end of the input
+     */
+    bool decrypt(const unsigned char *input,
+                 unsigned char *output,
+                 size_t length,
+                 const unsigned char *iv,
+                 const unsigned char *tag,
+                 const unsigned char *ad,
+                 size_t ad_len)
+    {
+        check_initialized();
+        return decrypt_packet(input, output, length, iv, tag, ad, ad_len);
+    }
+
+    // Decrypt n packets, see encrypt_batch()
+    void decrypt_batch(Op *ops, const size_t n)
+    {
+        check_initialized();
+        for (size_t i = 0; i < n; ++i)
+        {
+            Op &op = ops[i];
+            op.ok = decrypt_packet(op.input, op.output, op.length, op.iv, op.tag, op.ad, op.ad_len);
+        }
+    }
+
+    bool is_initialized() const
+    {
+        return ctx != nullptr;
+    }
+
+    static bool is_supported(SSLLib::Ctx libctx, const CryptoAlgs::Type alg)
+    {
+        unsigned int keysize = 0;
+        CIPHER_unique_ptr cipher(cipher_type(libctx, alg, keysize), EVP_CIPHER_free);
+        return (bool)cipher;
+    }
+
+
+  private:
+    void encrypt_packet(const unsigned char *input,
+                        unsigned char *output,
+                        size_t length,
+                        const unsigned char *iv,
+                        unsigned char *tag,
+                        const unsigned char *ad,
+                        size_t ad_len)
     {
         int len;
         int ciphertext_len;
 
-        check_initialized();
         if (!EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, iv))
         {
             openssl_clear_error_stack();
@@ -162,26 +250,13 @@ class CipherContextAEAD
         }
     }
 
-    /**
-     * Decrypts AEAD encrypted data. Note that if tag is the nullptr the tag is assumed to be
-     * part of input and at the end of the input. The length parameter of input includes the tag in
-     * this case
-     *
-     * @param input     Input data to decrypt
-     * @param output    Where decrypted data will be written to
-     * @param iv        IV of the encrypted data.
-     * @param length    length the of the data, this includes the tag at the end if tag is not a nullptr.
-     * @param ad        start of the additional data
-     * @param ad_len    length of the additional data
-     * @param tag       location of the tag to use or nullptr if at the end of the input
-     */
-    bool decrypt(const unsigned char *input,
-                 unsigned char *output,
-                 size_t length,
-                 const unsigned char *iv,
-                 const unsigned char *tag,
-                 const unsigned char *ad,
-                 size_t ad_len)
+    bool decrypt_packet(const unsigned char *input,
+                        unsigned char *output,
+                        size_t length,
+                        const unsigned char *iv,
+                        const unsigned char *tag,
+                        const unsigned char *ad,
+                        size_t ad_len)
     {
         if (!tag)
         {
@@ -195,7 +270,6 @@ class CipherContextAEAD
             tag = input + length;
         }
 
-        check_initialized();
         if (!EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, iv))
         {
             openssl_clear_error_stack();
@@ -235,20 +309,6 @@ class CipherContextAEAD
         return true;
     }
 
-    bool is_initialized() const
-    {
-        return ctx != nullptr;
-    }
-
-    static bool is_supported(SSLLib::Ctx libctx, const CryptoAlgs::Type alg)
-    {
-        unsigned int keysize = 0;
-        CIPHER_unique_ptr cipher(cipher_type(libctx, alg, keysize), EVP_CIPHER_free);
-        return (bool)cipher;
-    }
-
-
-  private:
     static evp_cipher_type *cipher_type(SSLLib::Ctx libctx,
                                         const CryptoAlgs::Type alg,
                                         unsigned int &keysize)
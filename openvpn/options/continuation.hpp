@@ -73,23 +73,29 @@ class OptionListContinuation : public OptionList
      * @param push_update true if this is PUSH_UPDATE, false if PUSH_REPLY
      */
     void add(const OptionList &other, OptionList::FilterBase *filt, bool push_update = false)
+    {
+        add(OptionList(other), filt, push_update);
+    }
+
+    // Same as above, but consumes other to avoid copying the options.
+    void add(OptionList &&other, OptionList::FilterBase *filt, bool push_update = false)
     {
         if (complete_)
         {
             throw olc_complete();
         }
 
-        OptionList opts{other};
         if (push_update)
         {
-            update(opts);
+            update(other);
         }
+        const bool more = continuation(other);
 
         partial_ = true;
         try
         {
             // throws if pull-filter rejects
-            extend(opts, filt);
+            extend(std::move(other), filt);
         }
         catch (const Option::RejectedException &)
         {
@@ -99,16 +105,21 @@ class OptionListContinuation : public OptionList
                 extend(push_base->multi, nullptr);
             throw;
         }
-        if (!continuation(opts))
+        if (!more)
         {
+            // Options were only appended since the map was last updated,
+            // unless PUSH_UPDATE removed some of them.
+            if (push_update)
+                update_map();
+            else
+                extend_map();
             if (push_base)
             {
                 // Append from base where only a single instance of each option makes sense,
                 // provided that option wasn't already pushed by server.
-                update_map();
                 extend_nonexistent(push_base->singleton);
+                extend_map();
             }
-            update_map();
             complete_ = true;
         }
     }
@@ -234,10 +245,15 @@ class OptionListContinuation : public OptionList
         }
     }
 
+    // checked before opt is consumed, so avoid get_ptr()
+    // which would mark the option as used
     static bool continuation(const OptionList &opt)
     {
-        const Option *o = opt.get_ptr("push-continuation");
-        return o && o->size() >= 2 && o->ref(1) == "2";
+        const auto e = opt.map().find("push-continuation");
+        if (e == opt.map().end() || e->second.empty())
+            return false;
+        const Option &o = opt[e->second.back()];
+        return o.size() >= 2 && o.ref(1) == "2";
     }
 
     bool partial_ = false;
@@ -22,10 +22,14 @@
 
 namespace openvpn {
 
-inline std::string render_options_sanitized(const OptionList &opt, const unsigned int render_flags)
+// Render options starting at index begin, so that a list which is
+// built incrementally can be rendered piece by piece.
+inline std::string render_options_sanitized(const OptionList &opt,
+                                            const unsigned int render_flags,
+                                            const size_t begin = 0)
 {
     std::ostringstream out;
-    for (size_t i = 0; i < opt.size(); i++)
+    for (size_t i = begin; i < opt.size(); i++)
     {
         const Option &o = opt[i];
 #ifndef OPENVPN_SHOW_SESSION_TOKEN
@@ -0,0 +1,424 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Run an OpenVPN server on each of N threads, with client sessions
+// sharded over them.
+//
+// Every shard has its own io_context, thread and TransportServer, which
+// owns the sessions created on it, so ServerProto objects and everything
+// they reference stay single-threaded.  UDP sockets are bound by all
+// shards with SO_REUSEPORT, and the kernel picks the shard that receives
+// a datagram.  That is usually the shard that owns the session, but not
+// always, e.g. after the client's address floats, so a shard calls
+// owner() on each datagram and passes the foreign ones to handoff():
+//
+//  - DATA_V2 packets are steered by peer ID, since each shard only
+//    allocates peer IDs congruent to its own index modulo N,
+//  - control packets are steered by the sender's session ID, which the
+//    owning shard registers with register_psid(),
+//  - everything else, including the initial packet of a new session,
+//    stays on the receiving shard.
+//
+// Handoffs go through a lock-free queue per shard, and wake the owning
+// shard with at most one pending io_context post, so the packet path
+// never takes a lock.  Only control packets consult the session ID
+// directory, which is guarded by striped mutexes.
+//
+// If a shard's thread exits with an exception, all shards are stopped,
+// and handoffs to the dead shard are dropped.  failed() reports this;
+// stop() must still be called to join the threads.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <openvpn/io/io.hpp>
+#include <openvpn/common/rc.hpp>
+#include <openvpn/common/mpmcqueue.hpp>
+#include <openvpn/asio/asiowork.hpp>
+#include <openvpn/buffer/buffer.hpp>
+#include <openvpn/server/peeraddr.hpp>
+#include <openvpn/ssl/proto.hpp>
+#include <openvpn/ssl/psid.hpp>
+#include <openvpn/transport/server/transbase.hpp>
+
+namespace openvpn {
+
+class ShardedServer : public RC<thread_safe_refcount>
+{
+  public:
+    typedef RCPtr<ShardedServer> Ptr;
+
+    // A datagram handed off between shards.  addr is moved along with
+    // the packet, so it must not be referenced by the sending shard.
+    struct Packet
+    {
+        BufferAllocated buf;
+        PeerAddr::Ptr addr;
+    };
+
+    struct Shard : public TransportServer
+    {
+        typedef RCPtr<Shard> Ptr;
+
+        // called in the shard's thread for packets handed off to it
+        virtual void handoff_recv(Packet &pkt) = 0;
+    };
+
+    struct ShardFactory
+    {
+        virtual ~ShardFactory() = default;
+
+        // called for each shard by start(), in the calling thread
+        virtual Shard::Ptr new_shard(ShardedServer &server,
+                                     const unsigned int shard,
+                                     openvpn_io::io_context &io_context) = 0;
+    };
+
+    ShardedServer(const unsigned int n_shards_arg,
+                  ShardFactory &factory_arg,
+                  const size_t queue_size_arg = 4096)
+        : n_shards(std::max(n_shards_arg, 1u)),
+          queue_size(queue_size_arg),
+          factory(factory_arg)
+    {
+    }
+
+    ~ShardedServer()
+    {
+        stop();
+    }
+
+    // Create and start all shards, then start their threads.  Errors
+    // such as a failed bind are thrown here, before any thread is started.
+    void start()
+    {
+        if (!workers.empty())
+            return;
+
+        try
+        {
+            for (unsigned int i = 0; i < n_shards; ++i)
+            {
+                std::unique_ptr<Worker> w(new Worker(i, queue_size));
+                w->shard = factory.new_shard(*this, i, w->io_context);
+                w->shard->start();
+                workers.push_back(std::move(w));
+            }
+        }
+        catch (...)
+        {
+            for (auto &w : workers)
+                w->shard->stop();
+            workers.clear();
+            throw;
+        }
+
+        for (auto &w : workers)
+        {
+            Worker *worker = w.get();
+            worker->running = true;
+            worker->thread = std::thread([this, worker]()
+                                         {
+                try
+                {
+                    worker->io_context.run();
+                }
+                catch (const std::exception &e)
+                {
+                    OPENVPN_LOG("server shard " << worker->index << " exception: " << e.what() << ", stopping all shards");
+                    worker_failed(*worker);
+                }
+                worker->running.store(false, std::memory_order_release); });
+        }
+    }
+
+    // stop all shards and wait for their threads to exit
+    void stop()
+    {
+        for (auto &w : workers)
+        {
+            openvpn_io::post(w->io_context, [worker = w.get()]()
+                             {
+                worker->shard->stop();
+                worker->work.reset();
+                worker->io_context.stop(); });
+        }
+        for (auto &w : workers)
+        {
+            if (w->thread.joinable())
+                w->thread.join();
+        }
+        workers.clear();
+    }
+
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    // true if a shard's thread exited with an exception, see above
+    bool failed() const
+    {
+        return failed_;
+    }
+
+    // Return the shard that owns the session of the datagram in buf,
+    // which was received by shard local.
+    unsigned int owner(const unsigned int local, const Buffer &buf) const
+    {
+        if (buf.empty())
+            return local;
+        const unsigned int op = ProtoContext::opcode_extract(buf[0]);
+        if (op == ProtoContext::DATA_V2)
+        {
+            if (buf.size() < ProtoContext::OP_SIZE_V2)
+                return local;
+            const unsigned int peer_id = (buf[1] << 16) | (buf[2] << 8) | buf[3];
+            if (peer_id == ProtoContext::OP_PEER_ID_UNDEF)
+                return local;
+            return peer_id % n_shards;
+        }
+        if (is_control(op) && buf.size() >= 1 + ProtoSessionID::SIZE)
+        {
+            const std::uint64_t key = psid_key(buf.c_data() + 1);
+            const PsidDirectory::Stripe &s = psids.stripe(key);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            const auto i = s.map.find(key);
+            if (i != s.map.end())
+                return i->second;
+        }
+        return local;
+    }
+
+    // Pass pkt to shard, from any thread.  Returns false, leaving pkt
+    // untouched, if the shard's queue is full or its thread has exited,
+    // and pkt should be dropped.
+    bool handoff(const unsigned int shard, Packet &&pkt)
+    {
+        Worker &w = *workers.at(shard);
+        if (!w.running.load(std::memory_order_relaxed) || !w.queue.push(std::move(pkt)))
+        {
+            ++w.n_dropped;
+            return false;
+        }
+        ++w.n_handoff;
+        if (!w.drain_pending.exchange(true))
+            openvpn_io::post(w.io_context, [this, worker = &w]()
+                             { drain(*worker); });
+        return true;
+    }
+
+    // Allocate a peer ID owned by shard, or return -1 if none is left.
+    // Only call from the shard's thread.
+    int new_peer_id(const unsigned int shard)
+    {
+        Worker &w = *workers.at(shard);
+        if (!w.free_peer_ids.empty())
+        {
+            const int ret = w.free_peer_ids.back();
+            w.free_peer_ids.pop_back();
+            return ret;
+        }
+        if (w.next_peer_id >= ProtoContext::OP_PEER_ID_UNDEF)
+            return -1;
+        const int ret = static_cast<int>(w.next_peer_id);
+        w.next_peer_id += n_shards;
+        return ret;
+    }
+
+    // only call from the thread of the shard that allocated peer_id
+    void release_peer_id(const unsigned int shard, const int peer_id)
+    {
+        if (peer_id >= 0)
+            workers.at(shard)->free_peer_ids.push_back(peer_id);
+    }
+
+    // Steer control packets from the client with session ID psid to
+    // shard, until unregister_psid() is called.  Thread-safe.
+    void register_psid(const ProtoSessionID &psid, const unsigned int shard)
+    {
+        if (!psid.defined())
+            return;
+        const std::uint64_t key = psid_key(psid);
+        PsidDirectory::Stripe &s = psids.stripe(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.map[key] = shard;
+    }
+
+    void unregister_psid(const ProtoSessionID &psid)
+    {
+        if (!psid.defined())
+            return;
+        const std::uint64_t key = psid_key(psid);
+        PsidDirectory::Stripe &s = psids.stripe(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.map.erase(key);
+    }
+
+    // packets handed off to shard
+    std::uint64_t n_handoff(const unsigned int shard) const
+    {
+        return workers.at(shard)->n_handoff.load(std::memory_order_relaxed);
+    }
+
+    // packets dropped because the queue of shard was full, or its thread
+    // had exited
+    std::uint64_t n_dropped(const unsigned int shard) const
+    {
+        return workers.at(shard)->n_dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // max packets passed to handoff_recv() per drain, so that a busy
+    // queue doesn't starve the shard's own socket
+    enum
+    {
+        DRAIN_BATCH = 256,
+    };
+
+    struct Worker
+    {
+        Worker(const unsigned int index_arg, const size_t queue_size)
+            : index(index_arg),
+              work(new AsioWork(io_context)),
+              queue(queue_size),
+              next_peer_id(index_arg)
+        {
+        }
+
+        const unsigned int index;
+        openvpn_io::io_context io_context{1};
+        std::unique_ptr<AsioWork> work; // keep run() going until stop()
+        Shard::Ptr shard;
+        std::thread thread;
+        std::atomic<bool> running{false}; // false once thread has exited
+
+        MPMCQueue<Packet> queue;
+        std::atomic<bool> drain_pending{false};
+        std::atomic<std::uint64_t> n_handoff{0};
+        std::atomic<std::uint64_t> n_dropped{0};
+
+        // shard thread only
+        unsigned int next_peer_id;
+        std::vector<int> free_peer_ids;
+    };
+
+    struct PsidDirectory
+    {
+        enum
+        {
+            N_STRIPES = 64,
+        };
+
+        struct Stripe
+        {
+            mutable std::mutex mutex;
+            std::unordered_map<std::uint64_t, unsigned int> map;
+        };
+
+        Stripe &stripe(const std::uint64_t key)
+        {
+            return stripes[key % N_STRIPES];
+        }
+
+        const Stripe &stripe(const std::uint64_t key) const
+        {
+            return stripes[key % N_STRIPES];
+        }
+
+        Stripe stripes[N_STRIPES];
+    };
+
+    // called in the thread of a shard whose io_context threw
+    void worker_failed(Worker &failed_worker)
+    {
+        failed_ = true;
+        failed_worker.shard->stop();
+        for (auto &w : workers)
+        {
+            if (w.get() == &failed_worker)
+                continue;
+            openvpn_io::post(w->io_context, [worker = w.get()]()
+                             {
+                worker->shard->stop();
+                worker->work.reset();
+                worker->io_context.stop(); });
+        }
+    }
+
+    void drain(Worker &w)
+    {
+        // clear the flag first, so that a concurrent handoff posts again,
+        // and acquire the packets pushed before it was set
+        w.drain_pending.exchange(false);
+        Packet pkt;
+        for (unsigned int i = 0; i < DRAIN_BATCH; ++i)
+        {
+            if (!w.queue.pop(pkt))
+                return;
+            w.shard->handoff_recv(pkt);
+        }
+        if (!w.drain_pending.exchange(true))
+            openvpn_io::post(w.io_context, [this, worker = &w]()
+                             { drain(*worker); });
+    }
+
+    static bool is_control(const unsigned int op)
+    {
+        switch (op)
+        {
+        case ProtoContext::CONTROL_SOFT_RESET_V1:
+        case ProtoContext::CONTROL_V1:
+        case ProtoContext::ACK_V1:
+        case ProtoContext::CONTROL_HARD_RESET_CLIENT_V2:
+        case ProtoContext::CONTROL_HARD_RESET_SERVER_V2:
+        case ProtoContext::CONTROL_HARD_RESET_CLIENT_V3:
+        case ProtoContext::CONTROL_WKC_V1:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // session IDs are random, so their bytes make a good hash key
+    static std::uint64_t psid_key(const unsigned char *data)
+    {
+        std::uint64_t key;
+        std::memcpy(&key, data, sizeof(key));
+        return key;
+    }
+
+    static std::uint64_t psid_key(const ProtoSessionID &psid)
+    {
+        return psid_key(psid.get_buf().c_data());
+    }
+
+    const unsigned int n_shards;
+    const size_t queue_size;
+    ShardFactory &factory;
+    PsidDirectory psids;
+#ifdef UNIT_TEST
+  public:
+#endif
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> failed_{false};
+};
+
+} // namespace openvpn
@@ -206,9 +206,7 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
                                                   logging::LOG_LEVEL_VERB,
                                                   ProtoContext>
 {
-  protected:
-    static constexpr size_t APP_MSG_MAX = 65536;
-
+  public:
     enum
     {
         // packet opcode (high 5 bits) and key-id (low 3 bits) are combined in one byte
@@ -235,7 +233,28 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
         // DATA_V2 constants
         OP_SIZE_V2 = 4,                // size of initial packet opcode
         OP_PEER_ID_UNDEF = 0x00FFFFFF, // indicates that Peer ID is undefined
+    };
+
+    static unsigned int opcode_extract(const unsigned int op)
+    {
+        return op >> OPCODE_SHIFT;
+    }
+
+    static unsigned int key_id_extract(const unsigned int op)
+    {
+        return op & KEY_ID_MASK;
+    }
+
+    static size_t op_head_size(const unsigned int op)
+    {
+        return opcode_extract(op) == DATA_V2 ? OP_SIZE_V2 : 1;
+    }
 
+  protected:
+    static constexpr size_t APP_MSG_MAX = 65536;
+
+    enum
+    {
         // states
         // C_x : client states
         // S_x : server states
@@ -289,21 +308,6 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
         EARLY_NEG_FLAG_RESEND_WKC = 0x0001
     };
 
-    static unsigned int opcode_extract(const unsigned int op)
-    {
-        return op >> OPCODE_SHIFT;
-    }
-
-    static unsigned int key_id_extract(const unsigned int op)
-    {
-        return op & KEY_ID_MASK;
-    }
-
-    static size_t op_head_size(const unsigned int op)
-    {
-        return opcode_extract(op) == DATA_V2 ? OP_SIZE_V2 : 1;
-    }
-
     static unsigned char op_compose(const unsigned int opcode, const unsigned int key_id)
     {
         // As long as 'opcode' stays within the range specified by the enum the cast should be safe.
@@ -323,6 +327,12 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
     OPENVPN_UNTAGGED_EXCEPTION_INHERIT(option_error, process_server_push_error);
     OPENVPN_UNTAGGED_EXCEPTION_INHERIT(option_error, proto_option_error);
 
+    // max packets that data_decrypt_batch() decrypts in one batch
+    enum
+    {
+        DATA_BATCH_MAX = 64
+    };
+
     // configuration data passed to ProtoContext constructor
     class ProtoConfig : public RCCopyable<thread_unsafe_refcount>
     {
@@ -609,10 +619,10 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
                         CompressContext::Type meth = CompressContext::parse_method(meth_name);
                         if (meth == CompressContext::NONE)
                             OPENVPN_THROW_ARG1(proto_option_error, ERR_INVALID_OPTION_VAL, "Unknown compressor: '" << meth_name << '\'');
-                        comp_ctx = CompressContext(pco.is_comp() ? meth : CompressContext::stub(meth), pco.is_comp_asym());
+                        comp_ctx = CompressContext(pco.is_comp() ? meth : CompressContext::stub(meth), pco.is_comp_asym(), pco.is_comp_adaptive());
                     }
                     else
-                        comp_ctx = CompressContext(pco.is_comp() ? CompressContext::ANY : CompressContext::COMP_STUB, pco.is_comp_asym());
+                        comp_ctx = CompressContext(pco.is_comp() ? CompressContext::ANY : CompressContext::COMP_STUB, pco.is_comp_asym(), pco.is_comp_adaptive());
                 }
                 else
                 {
@@ -623,11 +633,11 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
                         {
                             // On the client, by using ANY instead of ANY_LZO, we are telling the server
                             // that it's okay to use any of our supported compression methods.
-                            comp_ctx = CompressContext(pco.is_comp() ? CompressContext::ANY : CompressContext::LZO_STUB, pco.is_comp_asym());
+                            comp_ctx = CompressContext(pco.is_comp() ? CompressContext::ANY : CompressContext::LZO_STUB, pco.is_comp_asym(), pco.is_comp_adaptive());
                         }
                         else
                         {
-                            comp_ctx = CompressContext(pco.is_comp() ? CompressContext::LZO : CompressContext::LZO_STUB, pco.is_comp_asym());
+                            comp_ctx = CompressContext(pco.is_comp() ? CompressContext::LZO : CompressContext::LZO_STUB, pco.is_comp_asym(), pco.is_comp_adaptive());
                         }
                     }
                 }
@@ -859,7 +869,7 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
                     {
                         // if compression is not availabe, CompressContext ctor throws an exception
                         if (pco.is_comp())
-                            comp_ctx = CompressContext(meth, pco.is_comp_asym());
+                            comp_ctx = CompressContext(meth, pco.is_comp_asym(), pco.is_comp_adaptive());
                         else
                         {
                             // server pushes compression but client has compression disabled
@@ -885,7 +895,7 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
                         }
                         else
                         {
-                            comp_ctx = CompressContext(pco.is_comp() ? CompressContext::LZO : CompressContext::LZO_STUB, pco.is_comp_asym());
+                            comp_ctx = CompressContext(pco.is_comp() ? CompressContext::LZO : CompressContext::LZO_STUB, pco.is_comp_asym(), pco.is_comp_adaptive());
                         }
                     }
                 }
@@ -1970,6 +1980,87 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
             }
         }
 
+        // Data channel decrypt of n <= DATA_BATCH_MAX packets that share
+        // the op header of bufs[0], with the same result as calling
+        // decrypt() on each of them.
+        void decrypt_batch(BufferAllocated *bufs, const size_t n)
+        {
+            if (state < ACTIVE
+                || !(crypto_flags & CryptoDCInstance::CRYPTO_DEFINED)
+                || invalidated())
+            {
+                for (size_t i = 0; i < n; ++i)
+                    bufs[i].reset_size(); // no crypto context available
+                return;
+            }
+
+            // Knock off leading op from the buffers, but keep the 32-bit version
+            // to pass to decrypt so it can be used as Additional Data.
+            const size_t head_size = op_head_size(bufs[0][0]);
+            unsigned char op32[OP_SIZE_V2];
+            if (head_size == OP_SIZE_V2)
+                std::memcpy(op32, bufs[0].c_data(), OP_SIZE_V2);
+            for (size_t i = 0; i < n; ++i)
+                bufs[i].advance(head_size);
+
+            // decrypt packets
+            Error::Type results[DATA_BATCH_MAX];
+            try
+            {
+                crypto->decrypt_batch(bufs, results, n, now->seconds_since_epoch(), head_size == OP_SIZE_V2 ? op32 : nullptr);
+            }
+            catch (std::exception &)
+            {
+                proto.stats->error(Error::BUFFER_ERROR);
+                for (size_t i = 0; i < n; ++i)
+                    bufs[i].reset_size();
+                if (proto.is_tcp())
+                    invalidate(Error::BUFFER_ERROR);
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                BufferAllocated &buf = bufs[i];
+                try
+                {
+                    if (invalidated())
+                    {
+                        buf.reset_size();
+                        continue;
+                    }
+
+                    const Error::Type err = results[i];
+                    if (err)
+                    {
+                        proto.stats->error(err);
+                        if (proto.is_tcp() && (err == Error::DECRYPT_ERROR || err == Error::HMAC_ERROR))
+                            invalidate(err);
+                    }
+
+                    // trigger renegotiation if we hit decrypt data limit
+                    if (data_limit)
+                        if (!data_limit_add(DataLimit::Decrypt, buf.size()))
+                            throw proto_option_error(ERR_INVALID_OPTION_CRYPTO, "Unable to add data limit");
+
+                    // decompress packet
+                    if (compress)
+                        compress->decompress(buf);
+
+                    // set MSS for segments server can receive
+                    if (proto.config->mss_fix > 0)
+                        MSSFix::mssfix(buf, numeric_cast<uint16_t>(proto.config->mss_fix));
+                }
+                catch (std::exception &)
+                {
+                    proto.stats->error(Error::BUFFER_ERROR);
+                    buf.reset_size();
+                    if (proto.is_tcp())
+                        invalidate(Error::BUFFER_ERROR);
+                }
+            }
+        }
+
         // usually called by parent ProtoContext object when this KeyContext
         // has been retired.
         void prepare_expire(const EventType current_ev = KeyContext::KEV_NONE)
@@ -4137,6 +4228,46 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
         return ret;
     }
 
+    // Decrypt n data channel packets, with the same result as calling
+    // data_decrypt() on each of them in order.  Each run of packets with
+    // the same op header, and so the same key, is decrypted as a batch.
+    void data_decrypt_batch(BufferAllocated *bufs, const size_t n)
+    {
+        size_t i = 0;
+        while (i < n)
+        {
+            const PacketType type = packet_type(bufs[i]);
+            if (!type.is_data())
+            {
+                data_decrypt(type, bufs[i++]);
+                continue;
+            }
+
+            const size_t head_size = op_head_size(bufs[i][0]);
+            size_t j = i + 1;
+            while (j < n
+                   && j - i < DATA_BATCH_MAX
+                   && bufs[j].size() >= head_size
+                   && std::memcmp(bufs[j].c_data(), bufs[i].c_data(), head_size) == 0)
+                ++j;
+
+            KeyContext &kc = select_key_context(type, false);
+            OVPN_LOG_DEBUG(debug_prefix() << " DATA DECRYPT BATCH key_id=" << kc.key_id() << " n=" << (j - i));
+            kc.decrypt_batch(bufs + i, j - i);
+
+            for (; i < j; ++i)
+            {
+                // update time of most recent packet received
+                if (bufs[i].size())
+                    update_last_received();
+
+                // discard keepalive packets
+                if (proto_context_private::is_keepalive(bufs[i]))
+                    bufs[i].reset_size();
+            }
+        }
+    }
+
     // enter disconnected state
     void disconnect(const Error::Type reason)
     {
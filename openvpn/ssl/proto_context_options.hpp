@@ -28,7 +28,8 @@ struct ProtoContextCompressionOptions : public RC<thread_safe_refcount>
     {
         COMPRESS_NO,
         COMPRESS_YES,
-        COMPRESS_ASYM
+        COMPRESS_ASYM,
+        COMPRESS_ADAPTIVE
     };
 
     ProtoContextCompressionOptions()
@@ -44,6 +45,10 @@ struct ProtoContextCompressionOptions : public RC<thread_safe_refcount>
     {
         return compression_mode == COMPRESS_ASYM;
     }
+    bool is_comp_adaptive() const
+    {
+        return compression_mode == COMPRESS_ADAPTIVE;
+    }
 
     void parse_compression_mode(const std::string &mode)
     {
@@ -53,6 +58,8 @@ struct ProtoContextCompressionOptions : public RC<thread_safe_refcount>
             compression_mode = COMPRESS_YES;
         else if (mode == "asym")
             compression_mode = COMPRESS_ASYM;
+        else if (mode == "adaptive")
+            compression_mode = COMPRESS_ADAPTIVE;
         else
             OPENVPN_THROW_ARG1(option_error, ERR_INVALID_OPTION_VAL, "error parsing compression mode: " << mode);
     }
@@ -70,6 +70,19 @@ struct TransportClientParent
 {
     virtual void transport_recv(BufferAllocated &buf) = 0;
     virtual void transport_needs_send() = 0; // notification that send queue is empty
+
+    // Bracket the transport_recv() calls for packets that were received
+    // together, e.g. by one recvmmsg(), so that they may be processed as
+    // a batch.  transport_recv_batch_end() is not called if the transport
+    // was stopped in between.
+    virtual void transport_recv_batch_begin()
+    {
+    }
+
+    virtual void transport_recv_batch_end()
+    {
+    }
+
     virtual void transport_error(const Error::Type fatal_err, const std::string &err_text) = 0;
     virtual void proxy_error(const Error::Type fatal_err, const std::string &err_text) = 0;
 
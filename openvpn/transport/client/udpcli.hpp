@@ -37,6 +37,9 @@ class ClientConfig : public TransportClientFactory
     bool server_addr_float;
     bool synchronous_dns_lookup;
     int n_parallel;
+    int batch_size; // if > 0, use recvmmsg/sendmmsg batching (Linux only)
+    bool offload;   // with batching, also try UDP GSO/GRO
+    bool io_uring;  // use io_uring if available (Linux only), takes precedence over batching
     Frame::Ptr frame;
     SessionStats::Ptr stats;
 
@@ -64,6 +67,9 @@ class ClientConfig : public TransportClientFactory
         : server_addr_float(false),
           synchronous_dns_lookup(false),
           n_parallel(8),
+          batch_size(0),
+          offload(false),
+          io_uring(false),
           socket_protect(nullptr)
     {
     }
@@ -74,7 +80,7 @@ class Client : public TransportClient, AsyncResolvableUDP
     typedef RCPtr<Client> Ptr;
 
     friend class ClientConfig;      // calls constructor
-    friend class UDPLink<Client *>; // calls udp_read_handler
+    friend class UDPLink<Client *>; // calls udp_read_handler and udp_read_batch_*
 
     typedef UDPLink<Client *> LinkImpl;
 
@@ -230,6 +236,16 @@ class Client : public TransportClient, AsyncResolvableUDP
             config->stats->error(Error::BAD_SRC_ADDR);
     }
 
+    void udp_read_batch_begin() // called by LinkImpl
+    {
+        parent->transport_recv_batch_begin();
+    }
+
+    void udp_read_batch_end() // called by LinkImpl
+    {
+        parent->transport_recv_batch_end();
+    }
+
     void stop_()
     {
         if (!halt)
@@ -291,6 +307,23 @@ class Client : public TransportClient, AsyncResolvableUDP
                                                 self->start_impl_(error); });
     }
 
+    // pick the fastest available receive/send path
+    void start_link_()
+    {
+#ifdef OPENVPN_IO_URING
+        if (config->io_uring && impl->start_uring(config->n_parallel))
+            return;
+#endif
+#ifdef OPENVPN_UDPLINK_BATCH
+        if (config->batch_size > 0)
+        {
+            impl->start_batch(config->batch_size, config->offload);
+            return;
+        }
+#endif
+        impl->start(config->n_parallel);
+    }
+
     // start I/O on UDP socket
     void start_impl_(const openvpn_io::error_code &error)
     {
@@ -305,7 +338,7 @@ class Client : public TransportClient, AsyncResolvableUDP
 #ifdef OPENVPN_GREMLIN
                 impl->gremlin_config(config->gremlin_config);
 #endif
-                impl->start(config->n_parallel);
+                start_link_();
                 parent->transport_connecting();
             }
             else
@@ -14,19 +14,44 @@
 #ifndef OPENVPN_TRANSPORT_UDPLINK_H
 #define OPENVPN_TRANSPORT_UDPLINK_H
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include <openvpn/io/io.hpp>
 
+#include <openvpn/common/platform.hpp>
 #include <openvpn/common/size.hpp>
 #include <openvpn/common/rc.hpp>
 #include <openvpn/frame/frame.hpp>
 #include <openvpn/log/sessionstats.hpp>
+#include <openvpn/io/uring.hpp>
 
 #ifdef OPENVPN_GREMLIN
 #include <openvpn/transport/gremlin.hpp>
 #endif
 
+// Batched receive/send via recvmmsg/sendmmsg is only available on Linux
+#if defined(OPENVPN_PLATFORM_LINUX) && !defined(OPENVPN_UDPLINK_NO_BATCH)
+#define OPENVPN_UDPLINK_BATCH
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#ifndef SOL_UDP
+#define SOL_UDP IPPROTO_UDP
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+
 #if defined(OPENVPN_DEBUG_UDPLINK) && OPENVPN_DEBUG_UDPLINK >= 1
 #define OPENVPN_LOG_UDPLINK_ERROR(x) OPENVPN_LOG(x)
 #else
@@ -84,6 +109,9 @@ class UDPLink : public RC<thread_unsafe_refcount>
 
     // Returns 0 on success, or a system error code on error.
     // May also return SEND_PARTIAL or SEND_SOCKET_HALTED.
+    // In batch mode, the packet is queued and flushed with
+    // a single sendmmsg() call per event loop turn, so send
+    // errors are only reported through stats.
     int send(const Buffer &buf, const AsioEndpoint *endpoint)
     {
 #ifdef OPENVPN_GREMLIN
@@ -92,9 +120,16 @@ class UDPLink : public RC<thread_unsafe_refcount>
             gremlin_send(buf, endpoint);
             return 0;
         }
-        else
 #endif
-            return do_send(buf, endpoint);
+#ifdef OPENVPN_IO_URING
+        if (uring)
+            return uring_send(buf, endpoint);
+#endif
+#ifdef OPENVPN_UDPLINK_BATCH
+        if (batch)
+            return batch_send(buf, endpoint);
+#endif
+        return do_send(buf, endpoint);
     }
 
     void start(const int n_parallel)
@@ -106,9 +141,71 @@ class UDPLink : public RC<thread_unsafe_refcount>
         }
     }
 
+#ifdef OPENVPN_UDPLINK_BATCH
+    // Start I/O in batch mode, where each read readiness event
+    // drains up to batch_size datagrams with a single recvmmsg()
+    // call, and outgoing packets are coalesced into a single
+    // sendmmsg() call per event loop turn.  If offload is true,
+    // also try to enable UDP GSO/GRO, silently falling back to
+    // plain batching if the kernel doesn't support them.
+    void start_batch(const size_t batch_size, const bool offload = false)
+    {
+        if (!halt && !batch)
+        {
+            batch.reset(new Batch(std::min(std::max(batch_size, size_t(1)), size_t(UIO_MAXIOV))));
+            if (offload)
+                enable_offload();
+            queue_read_batch();
+        }
+    }
+#endif
+
+#ifdef OPENVPN_IO_URING
+    // Start I/O through the io_uring service of the socket's io_context,
+    // with a multishot receive into provided buffers if the kernel
+    // supports it, or n_parallel single-shot receives otherwise.
+    // Sends are copied and submitted in batches, so send errors are
+    // only reported through stats.  Returns false if io_uring is
+    // unavailable, in which case the caller should use start().
+    bool start_uring(const int n_parallel)
+    {
+        if (halt || uring)
+            return false;
+        IOUring::Service *svc = IOUring::Service::get(static_cast<openvpn_io::io_context &>(socket.get_executor().context()));
+        if (!svc)
+            return false;
+        uring.reset(new Uring(svc));
+        uring->n_parallel = std::max(n_parallel, 1);
+        uring->buf_ring = svc->buf_ring(Uring::BUF_RING_ENTRIES,
+                                        sizeof(struct io_uring_recvmsg_out) + Uring::NAME_SPACE + frame_context.payload());
+        if (uring->buf_ring)
+        {
+            uring->recv.emplace_back(new UringRecv(true));
+            uring_queue_recv(uring->recv.back().get());
+        }
+        else
+            uring_start_single();
+        return true;
+    }
+#endif
+
     void stop()
     {
+#ifdef OPENVPN_UDPLINK_BATCH
+        // send() already reported the queued packets as sent,
+        // so send them now rather than dropping them
+        if (batch && !halt)
+            batch_flush();
+#endif
         halt = true;
+#ifdef OPENVPN_IO_URING
+        if (uring)
+        {
+            // pending receives hold a reference to us and the socket fd
+            for (auto &op : uring->recv)
+                uring->svc->cancel(op.get());
+        }
+#endif
 #ifdef OPENVPN_GREMLIN
         if (gremlin)
             gremlin->stop();
@@ -122,10 +219,14 @@ class UDPLink : public RC<thread_unsafe_refcount>
 
     ~UDPLink()
     {
+        // too late to flush, the socket may be gone
+        halt = true;
         stop();
     }
 
+#ifndef UNIT_TEST
   private:
+#endif
     void queue_read(PacketFrom *udpfrom)
     {
         OPENVPN_LOG_UDPLINK_VERBOSE("UDPLink::queue_read");
@@ -203,6 +304,707 @@ class UDPLink : public RC<thread_unsafe_refcount>
             return SEND_SOCKET_HALTED;
     }
 
+#ifdef OPENVPN_UDPLINK_BATCH
+    enum
+    {
+        GSO_MAX_SEGMENTS = 64,   // UDP_MAX_SEGMENTS on older kernels
+        GSO_MAX_BYTES = 65000,   // stay below the IP datagram limit
+        GRO_MAX_BYTES = 65535,   // largest coalesced read the kernel may hand us
+    };
+
+    // ancillary data buffer large enough for UDP_SEGMENT or UDP_GRO
+    union CmsgBuf
+    {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    };
+
+    struct Batch
+    {
+        Batch(const size_t size_arg)
+            : size(size_arg),
+              rx(size),
+              rx_iov(size),
+              rx_msg(size),
+              rx_cmsg(size),
+              rx_gso_size(size),
+              tx(size),
+              tx_endpoint(size),
+              tx_has_endpoint(size),
+              tx_iov(size),
+              tx_msg(size),
+              tx_cmsg(size),
+              tx_msg_first(size + 1),
+              tx_msg_bytes(size)
+        {
+        }
+
+        const size_t size;
+
+        // UDP segmentation offload (send) and generic receive
+        // offload (receive), enabled only if the kernel supports them
+        bool gso = false;
+        bool gro = false;
+
+        // receive side, rx_dirty is the number of leading
+        // slots that must be re-prepared before the next read
+        std::vector<PacketFrom::SPtr> rx;
+        std::vector<struct iovec> rx_iov;
+        std::vector<struct mmsghdr> rx_msg;
+        std::vector<CmsgBuf> rx_cmsg;
+        std::vector<size_t> rx_gso_size;
+        std::vector<PacketFrom::SPtr> rx_spare; // recycled GRO segments
+        size_t rx_dirty = size;
+
+        // send side, tx_count packets are queued for the next flush,
+        // tx buffers are retained across flushes to avoid reallocation.
+        // A message may carry several packets if GSO is enabled, in
+        // which case tx_msg_first[m] is the index of its first packet.
+        std::vector<BufferAllocated> tx;
+        std::vector<AsioEndpoint> tx_endpoint;
+        std::vector<unsigned char> tx_has_endpoint;
+        std::vector<struct iovec> tx_iov;
+        std::vector<struct mmsghdr> tx_msg;
+        std::vector<CmsgBuf> tx_cmsg;
+        std::vector<size_t> tx_msg_first;
+        std::vector<size_t> tx_msg_bytes;
+        size_t tx_count = 0;
+        bool tx_flush_queued = false;
+
+        bool tx_same_dest(const size_t i, const size_t j) const
+        {
+            if (tx_has_endpoint[i] != tx_has_endpoint[j])
+                return false;
+            return !tx_has_endpoint[i] || tx_endpoint[i] == tx_endpoint[j];
+        }
+    };
+
+    void enable_offload()
+    {
+        const int fd = socket.native_handle();
+
+        int one = 1;
+        batch->gro = ::setsockopt(fd, SOL_UDP, UDP_GRO, &one, sizeof(one)) == 0;
+
+        int gso_size = 0;
+        socklen_t len = sizeof(gso_size);
+        batch->gso = ::getsockopt(fd, SOL_UDP, UDP_SEGMENT, &gso_size, &len) == 0;
+
+        OPENVPN_LOG_UDPLINK_VERBOSE("UDPLink offload: GSO=" << batch->gso << " GRO=" << batch->gro);
+    }
+
+    void queue_read_batch()
+    {
+        OPENVPN_LOG_UDPLINK_VERBOSE("UDPLink::queue_read_batch");
+        socket.async_wait(openvpn_io::ip::udp::socket::wait_read,
+                          [self = Ptr(this)](const openvpn_io::error_code &error)
+                          {
+            OPENVPN_ASYNC_HANDLER;
+            self->handle_read_batch(error);
+        });
+    }
+
+    void handle_read_batch(const openvpn_io::error_code &error)
+    {
+        OPENVPN_LOG_UDPLINK_VERBOSE("UDPLink::handle_read_batch: " << error.message());
+        if (halt)
+            return;
+        if (error)
+        {
+            OPENVPN_LOG_UDPLINK_ERROR("UDP recv error: " << error.message());
+            stats->error(Error::NETWORK_RECV_ERROR);
+            queue_read_batch();
+            return;
+        }
+
+        // re-arm the slots consumed by the previous read, with GRO
+        // the slots must be able to hold a full coalesced read
+        for (size_t i = 0; i < batch->rx_dirty; ++i)
+        {
+            PacketFrom::SPtr &pf = batch->rx[i];
+            if (!pf)
+                pf.reset(new PacketFrom());
+            if (batch->gro)
+            {
+                pf->buf.reset(frame_context.headroom() + GRO_MAX_BYTES + frame_context.tailroom(),
+                              frame_context.buffer_flags());
+                frame_context.prepare(pf->buf);
+                batch->rx_iov[i].iov_base = pf->buf.data();
+                batch->rx_iov[i].iov_len = pf->buf.remaining(frame_context.tailroom());
+            }
+            else
+            {
+                frame_context.prepare(pf->buf);
+                const openvpn_io::mutable_buffer mb = frame_context.mutable_buffer(pf->buf);
+                batch->rx_iov[i].iov_base = mb.data();
+                batch->rx_iov[i].iov_len = mb.size();
+            }
+        }
+        batch->rx_dirty = 0;
+
+        // the endpoint and msg headers must be reset for every slot since
+        // recvmmsg() overwrites the name and control lengths and flags
+        for (size_t i = 0; i < batch->size; ++i)
+        {
+            struct msghdr &mh = batch->rx_msg[i].msg_hdr;
+            std::memset(&mh, 0, sizeof(mh));
+            mh.msg_name = batch->rx[i]->sender_endpoint.data();
+            mh.msg_namelen = static_cast<socklen_t>(batch->rx[i]->sender_endpoint.capacity());
+            mh.msg_iov = &batch->rx_iov[i];
+            mh.msg_iovlen = 1;
+            if (batch->gro)
+            {
+                mh.msg_control = batch->rx_cmsg[i].buf;
+                mh.msg_controllen = sizeof(batch->rx_cmsg[i].buf);
+            }
+        }
+
+        const int n = ::recvmmsg(socket.native_handle(),
+                                 batch->rx_msg.data(),
+                                 static_cast<unsigned int>(batch->size),
+                                 MSG_DONTWAIT,
+                                 nullptr);
+        if (n < 0)
+        {
+            const int eno = errno;
+            if (eno != EAGAIN && eno != EWOULDBLOCK && eno != EINTR)
+            {
+                OPENVPN_LOG_UDPLINK_ERROR("UDP recvmmsg error: " << std::strerror(eno));
+                stats->error(Error::NETWORK_RECV_ERROR);
+            }
+            queue_read_batch();
+            return;
+        }
+
+        batch->rx_dirty = static_cast<size_t>(n);
+
+        size_t bytes_recvd = 0;
+        size_t packets_recvd = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            const size_t len = batch->rx_msg[i].msg_len;
+            const size_t gso_size = batch->gro ? gro_segment_size(batch->rx_msg[i].msg_hdr) : 0;
+            batch->rx_gso_size[i] = gso_size;
+            bytes_recvd += len;
+            packets_recvd += (gso_size && len > gso_size) ? (len + gso_size - 1) / gso_size : 1;
+        }
+        stats->inc_stat(SessionStats::BYTES_IN, bytes_recvd);
+        stats->inc_stat(SessionStats::PACKETS_IN, packets_recvd);
+
+        read_batch_begin(read_handler, 0);
+        for (int i = 0; i < n && !halt; ++i)
+        {
+            const struct mmsghdr &mm = batch->rx_msg[i];
+            PacketFrom::SPtr &pf = batch->rx[i];
+            if (!mm.msg_len)
+                continue;
+            if (mm.msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                OPENVPN_LOG_UDPLINK_ERROR("UDP recv error: truncated datagram");
+                stats->error(Error::NETWORK_RECV_ERROR);
+                continue;
+            }
+            pf->sender_endpoint.resize(mm.msg_hdr.msg_namelen);
+            pf->buf.set_size(mm.msg_len);
+            OPENVPN_LOG_UDPLINK_VERBOSE("UDP[" << mm.msg_len << "] from " << pf->sender_endpoint);
+            const size_t gso_size = batch->rx_gso_size[i];
+            if (gso_size && mm.msg_len > gso_size)
+                gro_split(*pf, gso_size);
+            else
+                read_dispatch(pf);
+        }
+        if (!halt)
+            read_batch_end(read_handler, 0);
+
+        if (!halt)
+            queue_read_batch();
+    }
+
+    // Tell read handlers that define udp_read_batch_begin() and
+    // udp_read_batch_end() which udp_read_handler() calls are for the
+    // packets of one read, so that they can process them as a batch.
+    template <typename RH>
+    static auto read_batch_begin(RH *rh, int) -> decltype(rh->udp_read_batch_begin(), void())
+    {
+        rh->udp_read_batch_begin();
+    }
+
+    template <typename RH>
+    static void read_batch_begin(RH *, long)
+    {
+    }
+
+    template <typename RH>
+    static auto read_batch_end(RH *rh, int) -> decltype(rh->udp_read_batch_end(), void())
+    {
+        rh->udp_read_batch_end();
+    }
+
+    template <typename RH>
+    static void read_batch_end(RH *, long)
+    {
+    }
+
+    // Returns the segment size of a read coalesced by UDP_GRO, or 0
+    static size_t gro_segment_size(struct msghdr &mh)
+    {
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm))
+        {
+            if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+            {
+                int gso_size = 0;
+                std::memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+                return gso_size > 0 ? static_cast<size_t>(gso_size) : 0;
+            }
+        }
+        return 0;
+    }
+
+    // Split a coalesced read back into one PacketFrom per datagram
+    void gro_split(const PacketFrom &from, const size_t gso_size)
+    {
+        const size_t len = from.buf.size();
+        for (size_t off = 0; off < len && !halt; off += gso_size)
+        {
+            const size_t seg = std::min(gso_size, len - off);
+            PacketFrom::SPtr pf;
+            if (!batch->rx_spare.empty())
+            {
+                pf = std::move(batch->rx_spare.back());
+                batch->rx_spare.pop_back();
+            }
+            else
+                pf.reset(new PacketFrom());
+
+            const size_t payload = frame_context.prepare(pf->buf);
+            if (seg > payload)
+            {
+                OPENVPN_LOG_UDPLINK_ERROR("UDP recv error: GRO segment too large");
+                stats->error(Error::NETWORK_RECV_ERROR);
+                batch->rx_spare.push_back(std::move(pf));
+                return;
+            }
+            pf->buf.write(from.buf.c_data() + off, seg);
+            pf->sender_endpoint = from.sender_endpoint;
+            read_dispatch(pf);
+            if (pf)
+                batch->rx_spare.push_back(std::move(pf));
+        }
+    }
+
+    void read_dispatch(PacketFrom::SPtr &pf)
+    {
+#ifdef OPENVPN_GREMLIN
+        if (gremlin)
+            gremlin_recv(pf);
+        else
+#endif
+            read_handler->udp_read_handler(pf);
+    }
+
+    int batch_send(const Buffer &buf, const AsioEndpoint *endpoint)
+    {
+        if (halt)
+            return SEND_SOCKET_HALTED;
+
+        const size_t i = batch->tx_count++;
+        BufferAllocated &b = batch->tx[i];
+        b.reset(0, buf.size(), 0);
+        b.write(buf.c_data(), buf.size());
+        batch->tx_iov[i].iov_base = b.data();
+        batch->tx_iov[i].iov_len = b.size();
+        batch->tx_has_endpoint[i] = endpoint != nullptr;
+        if (endpoint)
+            batch->tx_endpoint[i] = *endpoint;
+
+        if (batch->tx_count == batch->size)
+            batch_flush();
+        else if (!batch->tx_flush_queued)
+        {
+            batch->tx_flush_queued = true;
+            openvpn_io::post(socket.get_executor(), [self = Ptr(this)]()
+                             {
+                OPENVPN_ASYNC_HANDLER;
+                self->batch->tx_flush_queued = false;
+                self->batch_flush(); });
+        }
+        return 0;
+    }
+
+    void batch_flush()
+    {
+        size_t pkt = 0;
+        while (!halt && pkt < batch->tx_count)
+            pkt = batch_send_msgs(pkt);
+        batch->tx_count = 0;
+    }
+
+    // Send the queued packets starting at first_pkt.  Returns the index
+    // of the first packet that still needs to be sent, which is only
+    // less than tx_count if GSO was rejected by the kernel and has been
+    // disabled.
+    size_t batch_send_msgs(const size_t first_pkt)
+    {
+        const size_t nmsg = batch_build_msgs(first_pkt);
+        size_t m = 0;
+        while (!halt && m < nmsg)
+        {
+            const int n = ::sendmmsg(socket.native_handle(),
+                                     batch->tx_msg.data() + m,
+                                     static_cast<unsigned int>(nmsg - m),
+                                     MSG_DONTWAIT);
+            if (n < 0)
+            {
+                const int eno = errno;
+                if (eno == EINTR)
+                    continue;
+                const size_t segs = batch->tx_msg_first[m + 1] - batch->tx_msg_first[m];
+                if (segs > 1 && (eno == EIO || eno == EINVAL || eno == EOPNOTSUPP))
+                {
+                    // egress device can't do segmentation, fall back to per-packet sends
+                    OPENVPN_LOG_UDPLINK_ERROR("UDP GSO send error, disabling GSO: " << std::strerror(eno));
+                    batch->gso = false;
+                    return batch->tx_msg_first[m];
+                }
+                OPENVPN_LOG_UDPLINK_ERROR("UDP sendmmsg error: " << std::strerror(eno));
+                stats->error(Error::NETWORK_SEND_ERROR);
+
+                // skip the offending message and keep going, as would
+                // have happened with per-packet sends
+                ++m;
+                continue;
+            }
+
+            size_t bytes_sent = 0;
+            for (size_t i = m; i < m + n; ++i)
+            {
+                const size_t len = batch->tx_msg[i].msg_len;
+                bytes_sent += len;
+                if (len != batch->tx_msg_bytes[i])
+                {
+                    OPENVPN_LOG_UDPLINK_ERROR("UDP partial send error");
+                    stats->error(Error::NETWORK_SEND_ERROR);
+                }
+            }
+            stats->inc_stat(SessionStats::BYTES_OUT, bytes_sent);
+            stats->inc_stat(SessionStats::PACKETS_OUT, batch->tx_msg_first[m + n] - batch->tx_msg_first[m]);
+            m += n;
+        }
+        return batch->tx_count;
+    }
+
+    // Build the sendmmsg() vector for the packets starting at first_pkt.
+    // With GSO, runs of equal-sized packets to the same destination
+    // (optionally terminated by one shorter packet) are sent as a single
+    // UDP_SEGMENT message, with the packets as scatter/gather segments.
+    size_t batch_build_msgs(const size_t first_pkt)
+    {
+        size_t nmsg = 0;
+        size_t i = first_pkt;
+        while (i < batch->tx_count)
+        {
+            const size_t seg_size = batch->tx[i].size();
+            size_t bytes = seg_size;
+            size_t j = i + 1;
+            if (batch->gso)
+            {
+                while (j < batch->tx_count
+                       && j - i < GSO_MAX_SEGMENTS
+                       && batch->tx[j].size() <= seg_size
+                       && bytes + batch->tx[j].size() <= GSO_MAX_BYTES
+                       && batch->tx_same_dest(i, j))
+                {
+                    const size_t len = batch->tx[j++].size();
+                    bytes += len;
+                    if (len < seg_size)
+                        break;
+                }
+            }
+
+            struct msghdr &mh = batch->tx_msg[nmsg].msg_hdr;
+            std::memset(&mh, 0, sizeof(mh));
+            if (batch->tx_has_endpoint[i])
+            {
+                mh.msg_name = batch->tx_endpoint[i].data();
+                mh.msg_namelen = static_cast<socklen_t>(batch->tx_endpoint[i].size());
+            }
+            mh.msg_iov = &batch->tx_iov[i];
+            mh.msg_iovlen = j - i;
+            if (j - i > 1)
+            {
+                mh.msg_control = batch->tx_cmsg[nmsg].buf;
+                mh.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                const uint16_t gso_size = static_cast<uint16_t>(seg_size);
+                std::memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+            }
+            batch->tx_msg_first[nmsg] = i;
+            batch->tx_msg_bytes[nmsg] = bytes;
+            ++nmsg;
+            i = j;
+        }
+        batch->tx_msg_first[nmsg] = batch->tx_count;
+        return nmsg;
+    }
+#endif
+
+#ifdef OPENVPN_IO_URING
+    struct UringRecv : public IOUring::Op
+    {
+        typedef RCPtr<UringRecv> Ptr;
+
+        UringRecv(const bool multishot_arg)
+            : multishot(multishot_arg)
+        {
+        }
+
+        void complete(const int res, const unsigned int flags) override
+        {
+            parent->uring_recv_done(*this, res, flags);
+        }
+
+        const bool multishot;
+        UDPLink::Ptr parent; // set while in flight
+        struct msghdr mh;
+        struct iovec iov;
+        PacketFrom::SPtr pf; // single-shot only
+    };
+
+    struct UringSend : public IOUring::Op
+    {
+        typedef RCPtr<UringSend> Ptr;
+
+        void complete(const int res, const unsigned int flags) override
+        {
+            parent->uring_send_done(*this, res);
+        }
+
+        UDPLink::Ptr parent; // set while in flight
+        BufferAllocated buf;
+        AsioEndpoint endpoint;
+        struct msghdr mh;
+        struct iovec iov;
+    };
+
+    struct Uring
+    {
+        enum
+        {
+            BUF_RING_ENTRIES = 256,
+            NAME_SPACE = 32,    // >= sizeof(sockaddr_in6), keeps the payload aligned
+            MAX_SEND_IN_FLIGHT = 1024,
+        };
+
+        Uring(IOUring::Service *svc_arg)
+            : svc(svc_arg)
+        {
+        }
+
+        IOUring::Service *svc;
+        IOUring::BufRing *buf_ring = nullptr;
+        int n_parallel = 1;
+        std::vector<typename UringRecv::Ptr> recv;
+        std::vector<typename UringSend::Ptr> send_free;
+        size_t send_in_flight = 0;
+        PacketFrom::SPtr rx; // reused for multishot receives
+    };
+
+    void uring_start_single()
+    {
+        for (int i = 0; i < uring->n_parallel; ++i)
+        {
+            uring->recv.emplace_back(new UringRecv(false));
+            uring_queue_recv(uring->recv.back().get());
+        }
+    }
+
+    void uring_queue_recv(UringRecv *op)
+    {
+        std::memset(&op->mh, 0, sizeof(op->mh));
+        struct io_uring_sqe *sqe = uring->svc->get_sqe();
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = socket.native_handle();
+        sqe->addr = (std::uint64_t)&op->mh;
+        sqe->len = 1;
+        if (op->multishot)
+        {
+            // the kernel lays out each buffer as io_uring_recvmsg_out,
+            // then NAME_SPACE bytes of address, then the payload
+            op->mh.msg_namelen = Uring::NAME_SPACE;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = uring->buf_ring->group();
+        }
+        else
+        {
+            if (!op->pf)
+                op->pf.reset(new PacketFrom());
+            frame_context.prepare(op->pf->buf);
+            const openvpn_io::mutable_buffer mb = frame_context.mutable_buffer(op->pf->buf);
+            op->iov.iov_base = mb.data();
+            op->iov.iov_len = mb.size();
+            op->mh.msg_name = op->pf->sender_endpoint.data();
+            op->mh.msg_namelen = static_cast<socklen_t>(op->pf->sender_endpoint.capacity());
+            op->mh.msg_iov = &op->iov;
+            op->mh.msg_iovlen = 1;
+        }
+        op->parent.reset(this);
+        uring->svc->submit(sqe, op);
+    }
+
+    void uring_recv_done(UringRecv &op, const int res, const unsigned int flags)
+    {
+        const Ptr self(this); // op.parent may be released below
+
+        if (op.multishot && (flags & IORING_CQE_F_BUFFER))
+        {
+            const unsigned short bid = static_cast<unsigned short>(flags >> IORING_CQE_BUFFER_SHIFT);
+            if (res >= 0 && !halt)
+                uring_recv_multishot(uring->buf_ring->buffer(bid), static_cast<size_t>(res));
+            uring->buf_ring->recycle(bid);
+        }
+        else if (res > 0 && !op.multishot)
+        {
+            if (op.mh.msg_flags & MSG_TRUNC)
+            {
+                OPENVPN_LOG_UDPLINK_ERROR("UDP recv error: truncated datagram");
+                stats->error(Error::NETWORK_RECV_ERROR);
+            }
+            else if (!halt)
+            {
+                op.pf->sender_endpoint.resize(op.mh.msg_namelen);
+                op.pf->buf.set_size(res);
+                stats->inc_stat(SessionStats::BYTES_IN, res);
+                stats->inc_stat(SessionStats::PACKETS_IN, 1);
+                read_dispatch(op.pf);
+            }
+        }
+        else if (res < 0 && res != -ECANCELED && res != -ENOBUFS)
+        {
+            OPENVPN_LOG_UDPLINK_ERROR("UDP io_uring recv error: " << std::strerror(-res));
+            if (op.multishot && res == -EINVAL)
+            {
+                // no multishot recvmsg in this kernel
+                op.parent.reset();
+                uring->recv.clear();
+                if (!halt)
+                    uring_start_single();
+                return;
+            }
+            stats->error(Error::NETWORK_RECV_ERROR);
+        }
+
+        if (!(flags & IORING_CQE_F_MORE))
+        {
+            op.parent.reset();
+            if (!halt)
+                uring_queue_recv(&op); // multishot ends when we run out of buffers
+        }
+    }
+
+    void uring_recv_multishot(const unsigned char *data, const size_t len)
+    {
+        const size_t hdr = sizeof(struct io_uring_recvmsg_out) + Uring::NAME_SPACE;
+        struct io_uring_recvmsg_out out;
+        if (len < hdr)
+            return;
+        std::memcpy(&out, data, sizeof(out));
+        if ((out.flags & MSG_TRUNC) || out.namelen > Uring::NAME_SPACE || out.payloadlen > len - hdr)
+        {
+            OPENVPN_LOG_UDPLINK_ERROR("UDP recv error: truncated datagram");
+            stats->error(Error::NETWORK_RECV_ERROR);
+            return;
+        }
+
+        PacketFrom::SPtr &pf = uring->rx;
+        if (!pf)
+            pf.reset(new PacketFrom());
+        const size_t payload = frame_context.prepare(pf->buf);
+        if (out.payloadlen > payload)
+        {
+            stats->error(Error::NETWORK_RECV_ERROR);
+            return;
+        }
+        pf->buf.write(data + hdr, out.payloadlen);
+        std::memcpy(pf->sender_endpoint.data(), data + sizeof(out), out.namelen);
+        pf->sender_endpoint.resize(out.namelen);
+        stats->inc_stat(SessionStats::BYTES_IN, out.payloadlen);
+        stats->inc_stat(SessionStats::PACKETS_IN, 1);
+        OPENVPN_LOG_UDPLINK_VERBOSE("UDP[" << out.payloadlen << "] from " << pf->sender_endpoint);
+        read_dispatch(pf);
+    }
+
+    int uring_send(const Buffer &buf, const AsioEndpoint *endpoint)
+    {
+        if (halt)
+            return SEND_SOCKET_HALTED;
+        if (uring->send_in_flight >= Uring::MAX_SEND_IN_FLIGHT)
+        {
+            // socket buffer is full, drop as a blocking send would have
+            stats->error(Error::NETWORK_SEND_ERROR);
+            return ENOBUFS;
+        }
+
+        typename UringSend::Ptr op;
+        if (!uring->send_free.empty())
+        {
+            op = std::move(uring->send_free.back());
+            uring->send_free.pop_back();
+        }
+        else
+            op.reset(new UringSend());
+
+        op->buf.reset(0, buf.size(), 0);
+        op->buf.write(buf.c_data(), buf.size());
+        op->iov.iov_base = op->buf.data();
+        op->iov.iov_len = op->buf.size();
+        std::memset(&op->mh, 0, sizeof(op->mh));
+        op->mh.msg_iov = &op->iov;
+        op->mh.msg_iovlen = 1;
+        if (endpoint)
+        {
+            op->endpoint = *endpoint;
+            op->mh.msg_name = op->endpoint.data();
+            op->mh.msg_namelen = static_cast<socklen_t>(op->endpoint.size());
+        }
+
+        struct io_uring_sqe *sqe = uring->svc->get_sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = socket.native_handle();
+        sqe->addr = (std::uint64_t)&op->mh;
+        sqe->len = 1;
+        op->parent.reset(this);
+        ++uring->send_in_flight;
+        uring->svc->submit(sqe, op.get());
+        return 0;
+    }
+
+    void uring_send_done(UringSend &op, const int res)
+    {
+        const Ptr self(std::move(op.parent));
+        --uring->send_in_flight;
+        if (res < 0)
+        {
+            OPENVPN_LOG_UDPLINK_ERROR("UDP io_uring send error: " << std::strerror(-res));
+            stats->error(Error::NETWORK_SEND_ERROR);
+        }
+        else
+        {
+            stats->inc_stat(SessionStats::BYTES_OUT, res);
+            stats->inc_stat(SessionStats::PACKETS_OUT, 1);
+            if (static_cast<size_t>(res) != op.buf.size())
+            {
+                OPENVPN_LOG_UDPLINK_ERROR("UDP partial send error");
+                stats->error(Error::NETWORK_SEND_ERROR);
+            }
+        }
+        uring->send_free.emplace_back(&op);
+    }
+#endif
+
 #ifdef OPENVPN_GREMLIN
     void gremlin_send(const Buffer &buf, const AsioEndpoint *endpoint)
     {
@@ -233,6 +1035,14 @@ class UDPLink : public RC<thread_unsafe_refcount>
 #ifdef OPENVPN_GREMLIN
     std::unique_ptr<Gremlin::SendRecvQueue> gremlin;
 #endif
+
+#ifdef OPENVPN_UDPLINK_BATCH
+    std::unique_ptr<Batch> batch;
+#endif
+
+#ifdef OPENVPN_IO_URING
+    std::unique_ptr<Uring> uring;
+#endif
 };
 } // namespace openvpn::UDPTransport
 
@@ -18,9 +18,13 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 
+#include <string>
+#include <vector>
+
 #include <openvpn/common/numeric_util.hpp>
 #include <openvpn/addr/ip.hpp>
 #include <openvpn/addr/ipv4.hpp>
@@ -842,10 +846,17 @@ class SITNL
                               IP::Addr::from_zero(local.version()));
     }
 
+    /**
+     * Build a route request, without sending it
+     *
+     * @param ifindex   output interface index, or 0 for none
+     * @return 0 on success, negative value if the request could not be built
+     */
     static int
-    sitnl_route_set(const unsigned short cmd,
+    sitnl_route_msg(struct sitnl_route_req &req,
+                    const unsigned short cmd,
                     const unsigned short flags,
-                    const std::string &iface,
+                    const int ifindex,
                     const IP::Route &route,
                     const IP::Addr &gw,
                     const enum rt_class_t table,
@@ -854,8 +865,7 @@ class SITNL
                     const unsigned char protocol,
                     const unsigned char type)
     {
-        struct sitnl_route_req req = {};
-        int ret = -1;
+        req = {};
 
         req.n.nlmsg_len = NLMSG_LENGTH(sizeof(req.r));
         req.n.nlmsg_type = cmd;
@@ -898,22 +908,51 @@ class SITNL
             }
         }
 
+        if (ifindex)
+        {
+            SITNL_ADDATTR(&req.n, sizeof(req), RTA_OIF, &ifindex, 4);
+        }
+
+        if (metric > 0)
+        {
+            SITNL_ADDATTR(&req.n, sizeof(req), RTA_PRIORITY, &metric, 4);
+        }
+
+        return 0;
+
+        /* for SITNL_ADDATTR */
+    err:
+        return -1;
+    }
+
+    static int
+    sitnl_route_set(const unsigned short cmd,
+                    const unsigned short flags,
+                    const std::string &iface,
+                    const IP::Route &route,
+                    const IP::Addr &gw,
+                    const enum rt_class_t table,
+                    const int metric,
+                    const enum rt_scope_t scope,
+                    const unsigned char protocol,
+                    const unsigned char type)
+    {
+        struct sitnl_route_req req;
+        int ifindex = 0;
+
         if (!iface.empty())
         {
-            int ifindex = if_nametoindex(iface.c_str());
+            ifindex = if_nametoindex(iface.c_str());
             if (ifindex == 0)
             {
                 OPENVPN_LOG(__func__ << ": rtnl: cannot get ifindex for " << iface);
                 return -ENOENT;
             }
-
-            SITNL_ADDATTR(&req.n, sizeof(req), RTA_OIF, &ifindex, 4);
         }
 
-        if (metric > 0)
-        {
-            SITNL_ADDATTR(&req.n, sizeof(req), RTA_PRIORITY, &metric, 4);
-        }
+        int ret = sitnl_route_msg(req, cmd, flags, ifindex, route, gw, table, metric, scope, protocol, type);
+        if (ret < 0)
+            return ret;
 
         ret = sitnl_send(&req.n, 0, 0, NULL, NULL);
         if ((ret < 0) && (errno == EEXIST))
@@ -921,8 +960,6 @@ class SITNL
             ret = 0;
         }
 
-        /* for SITNL_ADDATTR */
-    err:
         return ret;
     }
 
@@ -992,6 +1029,279 @@ class SITNL
     }
 
   public:
+    /**
+     * Add or delete many routes over a single netlink socket
+     *
+     * Requests are queued by route_add() and route_del(), and sent by
+     * commit() with up to BATCH_MAX messages per sendmsg().  Every message
+     * requests an ACK, which is matched to it by its sequence number, so
+     * the outcome of each request is known.  The socket stays open for the
+     * lifetime of the object and can be used for several commits.
+     */
+    class RouteBatch
+    {
+      public:
+        enum
+        {
+            BATCH_MAX = 128,
+            BATCH_RCVBUF_SIZE = 1024 * 256,
+        };
+
+        RouteBatch() = default;
+
+        RouteBatch(const RouteBatch &) = delete;
+        RouteBatch &operator=(const RouteBatch &) = delete;
+
+        ~RouteBatch()
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+
+        int route_add(const IP::Route &route,
+                      const IP::Addr &gw,
+                      const std::string &iface,
+                      const uint32_t table,
+                      const int metric)
+        {
+            return queue(RTM_NEWROUTE,
+                         NLM_F_CREATE,
+                         iface,
+                         route,
+                         gw,
+                         (enum rt_class_t)(!table ? RT_TABLE_MAIN : table),
+                         metric,
+                         RT_SCOPE_UNIVERSE,
+                         RTPROT_BOOT,
+                         RTN_UNICAST);
+        }
+
+        int route_del(const IP::Route &route,
+                      const IP::Addr &gw,
+                      const std::string &iface,
+                      const uint32_t table,
+                      const int metric)
+        {
+            return queue(RTM_DELROUTE,
+                         0,
+                         iface,
+                         route,
+                         gw,
+                         (enum rt_class_t)(!table ? RT_TABLE_MAIN : table),
+                         metric,
+                         RT_SCOPE_NOWHERE,
+                         0,
+                         0);
+        }
+
+        // number of queued requests
+        size_t size() const
+        {
+            return reqs.size();
+        }
+
+        /**
+         * Send all queued requests and wait for their ACKs
+         *
+         * @return 0 if all requests succeeded, otherwise the first error
+         *         (negative errno).  results() has the status of each request,
+         *         in the order they were queued, or -EIO if it got no ACK.
+         */
+        int commit()
+        {
+            results_.assign(reqs.size(), -EIO);
+
+            int ret = 0;
+            if (!reqs.empty())
+            {
+                ret = sock();
+                for (size_t i = 0; ret == 0 && i < reqs.size(); i += BATCH_MAX)
+                    ret = send_batch(i, std::min(reqs.size(), i + BATCH_MAX));
+            }
+            reqs.clear();
+
+            if (ret == 0)
+            {
+                for (const int r : results_)
+                {
+                    if (r)
+                        return r;
+                }
+            }
+            return ret;
+        }
+
+        const std::vector<int> &results() const
+        {
+            return results_;
+        }
+
+      private:
+        int queue(const unsigned short cmd,
+                  const unsigned short flags,
+                  const std::string &iface,
+                  const IP::Route &route,
+                  const IP::Addr &gw,
+                  const enum rt_class_t table,
+                  const int metric,
+                  const enum rt_scope_t scope,
+                  const unsigned char protocol,
+                  const unsigned char type)
+        {
+            // routes of a batch usually share their interface
+            if (iface != ifname)
+            {
+                int index = 0;
+                if (!iface.empty())
+                {
+                    index = if_nametoindex(iface.c_str());
+                    if (index == 0)
+                    {
+                        OPENVPN_LOG(__func__ << ": rtnl: cannot get ifindex for " << iface);
+                        return -ENOENT;
+                    }
+                }
+                ifname = iface;
+                ifindex = index;
+            }
+
+            reqs.emplace_back();
+            const int ret = sitnl_route_msg(reqs.back(), cmd, flags | NLM_F_ACK, ifindex, route, gw, table, metric, scope, protocol, type);
+            if (ret < 0)
+                reqs.pop_back();
+            return ret;
+        }
+
+        // open and bind the socket on first use
+        int sock()
+        {
+            if (fd >= 0)
+                return 0;
+
+            fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+            if (fd < 0)
+            {
+                OPENVPN_LOG(__func__ << ": cannot open netlink socket");
+                return -errno;
+            }
+
+            // must hold the ACKs of a whole batch
+            int rcvbuf = BATCH_RCVBUF_SIZE;
+            if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0)
+            {
+                OPENVPN_LOG(__func__ << ": SO_RCVBUF");
+                const int ret = -errno;
+                close(fd);
+                fd = -1;
+                return ret;
+            }
+
+            const int ret = sitnl_bind(fd, 0);
+            if (ret < 0)
+            {
+                close(fd);
+                fd = -1;
+            }
+            return ret;
+        }
+
+        // send requests [begin, end) and collect their ACKs
+        int send_batch(const size_t begin, const size_t end)
+        {
+            struct sockaddr_nl nladdr = {};
+            nladdr.nl_family = AF_NETLINK;
+
+            struct iovec iov[BATCH_MAX];
+            const uint32_t seq_base = seq;
+            for (size_t i = begin; i < end; ++i)
+            {
+                struct nlmsghdr &n = reqs[i].n;
+                n.nlmsg_seq = seq++;
+                iov[i - begin].iov_base = &n;
+                iov[i - begin].iov_len = NLMSG_ALIGN(n.nlmsg_len);
+            }
+
+            struct msghdr nlmsg = {};
+            nlmsg.msg_name = &nladdr;
+            nlmsg.msg_namelen = sizeof(nladdr);
+            nlmsg.msg_iov = iov;
+            nlmsg.msg_iovlen = end - begin;
+
+            if (sendmsg(fd, &nlmsg, 0) < 0)
+            {
+                OPENVPN_LOG(__func__ << ": rtnl: error on sendmsg()");
+                return -errno;
+            }
+
+            std::vector<unsigned char> buf(16 * 1024);
+            struct iovec riov = {};
+            riov.iov_base = buf.data();
+            nlmsg.msg_iov = &riov;
+            nlmsg.msg_iovlen = 1;
+
+            size_t pending = end - begin;
+            while (pending)
+            {
+                riov.iov_len = buf.size();
+                nlmsg.msg_namelen = sizeof(nladdr);
+                ssize_t rcv_len = recvmsg(fd, &nlmsg, 0);
+                if (rcv_len < 0)
+                {
+                    if (errno == EINTR || errno == EAGAIN)
+                        continue;
+                    OPENVPN_LOG(__func__ << ": rtnl: error on recvmsg()");
+                    return -errno;
+                }
+                if (rcv_len == 0)
+                {
+                    OPENVPN_LOG(__func__ << ": rtnl: socket reached unexpected EOF");
+                    return -EIO;
+                }
+
+                for (struct nlmsghdr *h = (struct nlmsghdr *)buf.data();
+                     NLMSG_OK(h, rcv_len);
+                     h = NLMSG_NEXT(h, rcv_len))
+                {
+                    if (h->nlmsg_type != NLMSG_ERROR)
+                        continue;
+                    if (h->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr)))
+                    {
+                        OPENVPN_LOG(__func__ << ": ERROR truncated");
+                        return -EIO;
+                    }
+
+                    // ACK for a request of this batch?
+                    const uint32_t index = h->nlmsg_seq - seq_base;
+                    if (index >= end - begin)
+                        continue;
+                    int &result = results_[begin + index];
+                    if (result != -EIO)
+                        continue;
+
+                    const struct nlmsgerr *err = (const struct nlmsgerr *)NLMSG_DATA(h);
+                    result = err->error;
+
+                    // like sitnl_route_set(), adding an existing route succeeds
+                    if (result == -EEXIST && reqs[begin + index].n.nlmsg_type == RTM_NEWROUTE)
+                        result = 0;
+                    if (result)
+                        OPENVPN_LOG(__func__ << ": rtnl: generic error: "
+                                             << strerror(-result)
+                                             << " (" << result << ")");
+                    --pending;
+                }
+            }
+            return 0;
+        }
+
+        std::vector<struct sitnl_route_req> reqs;
+        std::vector<int> results_;
+        std::string ifname;
+        int ifindex = 0;
+        int fd = -1;
+        uint32_t seq = static_cast<uint32_t>(time(NULL));
+    };
+
     static int
     net_route_best_gw(const IP::Route6 &route,
                       IPv6::Addr &best_gw6,
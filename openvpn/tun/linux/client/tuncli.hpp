@@ -21,6 +21,8 @@
 #include <openvpn/tun/tunio.hpp>
 #include <openvpn/tun/persist/tunpersist.hpp>
 #include <openvpn/tun/linux/client/tunmethods.hpp>
+#include <openvpn/tun/linux/vnethdr.hpp>
+#include <openvpn/io/uring.hpp>
 
 namespace openvpn::TunLinux {
 
@@ -56,6 +58,319 @@ class Tun : public TunIO<ReadHandler, PacketFrom, openvpn_io::posix::stream_desc
     {
         Base::stop();
     }
+
+    // IFF_VNET_HDR mode: each read may return a TSO/USO super-packet
+    // which is segmented here, so that the rest of the data path
+    // only ever sees MTU-sized packets.
+    void start_vnet(const int n_parallel)
+    {
+        if (!Base::halt)
+        {
+            for (int i = 0; i < n_parallel; i++)
+                queue_read_vnet(nullptr);
+        }
+    }
+
+    bool write_vnet(Buffer &buf)
+    {
+        static const VirtioNet::Header vh = {};
+
+        if (!Base::halt)
+        {
+            try
+            {
+                const std::array<openvpn_io::const_buffer, 2> bufs = {openvpn_io::buffer(&vh, sizeof(vh)),
+                                                                      buf.const_buffer()};
+                const size_t wrote = Base::stream->write_some(bufs);
+                if (Base::stats)
+                {
+                    Base::stats->inc_stat(SessionStats::TUN_BYTES_OUT, wrote - std::min(wrote, sizeof(vh)));
+                    Base::stats->inc_stat(SessionStats::TUN_PACKETS_OUT, 1);
+                }
+                if (wrote == sizeof(vh) + buf.size())
+                    return true;
+                else
+                {
+                    OPENVPN_LOG_TUN_ERROR("TUN partial write error");
+                    Base::tun_error(Error::TUN_WRITE_ERROR, nullptr);
+                    return false;
+                }
+            }
+            catch (openvpn_io::system_error &e)
+            {
+                OPENVPN_LOG_TUN_ERROR("TUN write exception: " << e.what());
+                const openvpn_io::error_code code(e.code());
+                Base::tun_error(Error::TUN_WRITE_ERROR, &code);
+                return false;
+            }
+        }
+        else
+            return false;
+    }
+
+#ifdef OPENVPN_IO_URING
+    // io_uring mode: n_parallel reads and all writes are submitted
+    // through the IOUring::Service of the io_context, so that a busy
+    // tunnel costs one io_uring_enter() per event loop turn rather
+    // than a system call per packet.  Returns false if io_uring is
+    // unavailable, in which case the caller should use start().
+    bool start_uring(const int n_parallel)
+    {
+        if (Base::halt || uring)
+            return false;
+        IOUring::Service *svc = IOUring::Service::get(static_cast<openvpn_io::io_context &>(Base::stream->get_executor().context()));
+        if (!svc)
+            return false;
+        uring.reset(new Uring(svc));
+        for (int i = 0; i < std::max(n_parallel, 1); ++i)
+        {
+            uring->read.emplace_back(new UringRead());
+            uring_queue_read(*uring->read.back());
+        }
+        return true;
+    }
+
+    bool uring_mode() const
+    {
+        return bool(uring);
+    }
+
+    // Like write(), but the packet is copied and the write completes
+    // asynchronously, so errors are reported via tun_error_handler.
+    bool write_uring(Buffer &buf)
+    {
+        if (Base::halt)
+            return false;
+        if (uring->write_in_flight >= Uring::MAX_WRITE_IN_FLIGHT)
+        {
+            Base::tun_error(Error::TUN_WRITE_ERROR, nullptr);
+            return false;
+        }
+
+        typename UringWrite::Ptr op;
+        if (!uring->write_free.empty())
+        {
+            op = std::move(uring->write_free.back());
+            uring->write_free.pop_back();
+        }
+        else
+            op.reset(new UringWrite());
+        op->buf.reset(0, buf.size(), 0);
+        op->buf.write(buf.c_data(), buf.size());
+
+        struct io_uring_sqe *sqe = uring->svc->get_sqe();
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = Base::stream->native_handle();
+        sqe->addr = (std::uint64_t)op->buf.data();
+        sqe->len = static_cast<std::uint32_t>(op->buf.size());
+        sqe->off = (std::uint64_t)-1; // no file position
+        op->parent.reset(this);
+        ++uring->write_in_flight;
+        uring->svc->submit(sqe, op.get());
+        return true;
+    }
+#endif
+
+    void stop()
+    {
+#ifdef OPENVPN_IO_URING
+        // pending reads must not outlive the stream, which may be
+        // handed to a new Tun if persisted
+        if (uring && !Base::halt)
+        {
+            for (auto &op : uring->read)
+                uring->svc->cancel(op.get());
+        }
+#endif
+        Base::stop();
+    }
+
+  private:
+    struct VnetPacketFrom
+    {
+        typedef std::unique_ptr<VnetPacketFrom> SPtr;
+        VirtioNet::Header vh;
+        BufferAllocated buf{VirtioNet::Segmenter::MAX_PACKET, 0};
+    };
+
+    void queue_read_vnet(VnetPacketFrom *tunfrom)
+    {
+        if (!tunfrom)
+            tunfrom = new VnetPacketFrom();
+        tunfrom->buf.reset_size();
+
+        const std::array<openvpn_io::mutable_buffer, 2> bufs = {openvpn_io::buffer(&tunfrom->vh, sizeof(tunfrom->vh)),
+                                                                openvpn_io::buffer(tunfrom->buf.data(), tunfrom->buf.capacity())};
+        Base::stream->async_read_some(bufs,
+                                      [self = Ptr(this), tunfrom = typename VnetPacketFrom::SPtr(tunfrom)](const openvpn_io::error_code &error, const size_t bytes_recvd) mutable
+                                      {
+            OPENVPN_ASYNC_HANDLER;
+            self->handle_read_vnet(std::move(tunfrom), error, bytes_recvd);
+        });
+    }
+
+    void handle_read_vnet(typename VnetPacketFrom::SPtr pfp, const openvpn_io::error_code &error, const size_t bytes_recvd)
+    {
+        if (!Base::halt)
+        {
+            if (!error)
+            {
+                VirtioNet::Segmenter seg;
+                if (bytes_recvd > sizeof(pfp->vh)
+                    && seg.init(pfp->vh, pfp->buf.data(), bytes_recvd - sizeof(pfp->vh)))
+                {
+                    if (!segment)
+                        segment.reset(new PacketFrom());
+                    while (!seg.done() && !Base::halt)
+                    {
+                        Base::frame_context.prepare(segment->buf);
+                        if (!seg.next(segment->buf))
+                        {
+                            OPENVPN_LOG_TUN_ERROR("TUN Read Error: segment exceeds buffer");
+                            Base::tun_error(Error::TUN_FRAMING_ERROR, nullptr);
+                            break;
+                        }
+                        if (Base::stats)
+                        {
+                            Base::stats->inc_stat(SessionStats::TUN_BYTES_IN, segment->buf.size());
+                            Base::stats->inc_stat(SessionStats::TUN_PACKETS_IN, 1);
+                        }
+                        Base::read_handler->tun_read_handler(segment);
+                    }
+                }
+                else
+                {
+                    OPENVPN_LOG_TUN_ERROR("TUN Read Error: bad vnet header");
+                    Base::tun_error(Error::TUN_FRAMING_ERROR, nullptr);
+                }
+            }
+            else
+            {
+                OPENVPN_LOG_TUN_ERROR("TUN Read Error: " << error.message());
+                Base::tun_error(Error::TUN_READ_ERROR, &error);
+            }
+            if (!Base::halt)
+                queue_read_vnet(pfp.release()); // reuse buffer if still available
+        }
+    }
+
+#ifdef OPENVPN_IO_URING
+    struct UringRead : public IOUring::Op
+    {
+        typedef RCPtr<UringRead> Ptr;
+
+        void complete(const int res, const unsigned int flags) override
+        {
+            const typename Tun::Ptr self(std::move(parent));
+            self->uring_read_done(*this, res);
+        }
+
+        typename Tun::Ptr parent; // set while in flight
+        PacketFrom::SPtr pf;
+    };
+
+    struct UringWrite : public IOUring::Op
+    {
+        typedef RCPtr<UringWrite> Ptr;
+
+        void complete(const int res, const unsigned int flags) override
+        {
+            const typename Tun::Ptr self(std::move(parent));
+            self->uring_write_done(*this, res);
+        }
+
+        typename Tun::Ptr parent; // set while in flight
+        BufferAllocated buf;
+    };
+
+    struct Uring
+    {
+        enum
+        {
+            MAX_WRITE_IN_FLIGHT = 1024,
+        };
+
+        Uring(IOUring::Service *svc_arg)
+            : svc(svc_arg)
+        {
+        }
+
+        IOUring::Service *svc;
+        std::vector<typename UringRead::Ptr> read;
+        std::vector<typename UringWrite::Ptr> write_free;
+        size_t write_in_flight = 0;
+    };
+
+    void uring_queue_read(UringRead &op)
+    {
+        if (!op.pf)
+            op.pf.reset(new PacketFrom());
+        Base::frame_context.prepare(op.pf->buf);
+        const openvpn_io::mutable_buffer mb = Base::frame_context.mutable_buffer(op.pf->buf);
+
+        struct io_uring_sqe *sqe = uring->svc->get_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = Base::stream->native_handle();
+        sqe->addr = (std::uint64_t)mb.data();
+        sqe->len = static_cast<std::uint32_t>(mb.size());
+        sqe->off = (std::uint64_t)-1;
+        op.parent.reset(this);
+        uring->svc->submit(sqe, &op);
+    }
+
+    void uring_read_done(UringRead &op, const int res)
+    {
+        if (Base::halt)
+            return;
+        if (res > 0)
+        {
+            op.pf->buf.set_size(res);
+            if (Base::stats)
+            {
+                Base::stats->inc_stat(SessionStats::TUN_BYTES_IN, res);
+                Base::stats->inc_stat(SessionStats::TUN_PACKETS_IN, 1);
+            }
+            Base::read_handler->tun_read_handler(op.pf);
+        }
+        else if (res != -ECANCELED)
+        {
+            const openvpn_io::error_code error(res ? -res : EIO, openvpn_io::system_category());
+            OPENVPN_LOG_TUN_ERROR("TUN Read Error: " << error.message());
+            Base::tun_error(Error::TUN_READ_ERROR, &error);
+        }
+        if (!Base::halt)
+            uring_queue_read(op);
+    }
+
+    void uring_write_done(UringWrite &op, const int res)
+    {
+        --uring->write_in_flight;
+        if (res >= 0)
+        {
+            if (Base::stats)
+            {
+                Base::stats->inc_stat(SessionStats::TUN_BYTES_OUT, res);
+                Base::stats->inc_stat(SessionStats::TUN_PACKETS_OUT, 1);
+            }
+            if (static_cast<size_t>(res) != op.buf.size())
+            {
+                OPENVPN_LOG_TUN_ERROR("TUN partial write error");
+                Base::tun_error(Error::TUN_WRITE_ERROR, nullptr);
+            }
+        }
+        else if (!Base::halt)
+        {
+            const openvpn_io::error_code error(-res, openvpn_io::system_category());
+            OPENVPN_LOG_TUN_ERROR("TUN write error: " << error.message());
+            Base::tun_error(Error::TUN_WRITE_ERROR, &error);
+        }
+        uring->write_free.emplace_back(&op);
+    }
+
+    std::unique_ptr<Uring> uring;
+#endif
+
+    PacketFrom::SPtr segment; // reused for segments handed to read_handler
 };
 
 typedef TunPersistTemplate<ScopedFD> TunPersist;
@@ -73,6 +388,9 @@ class ClientConfig : public TunClientFactory
     bool generate_tun_builder_capture_event = false;
 
     int n_parallel = 8;
+    int n_queues = 1;      // if > 1, open a multi-queue tun device, see start_queues()
+    bool vnet_hdr = false; // use IFF_VNET_HDR with TSO/USO offloads (layer 3 only)
+    bool io_uring = false; // use io_uring for tun I/O if available, ignored with vnet_hdr
     Frame::Ptr frame;
     SessionStats::Ptr stats;
 
@@ -127,6 +445,7 @@ class Client : public TunClient
 {
     friend class ClientConfig;                                                      // calls constructor
     friend class TunIO<Client *, PacketFrom, openvpn_io::posix::stream_descriptor>; // calls tun_read_handler
+    friend class Tun<Client *>;                                                     // calls tun_read_handler
 
     typedef Tun<Client *> TunImpl;
 
@@ -192,6 +511,8 @@ class Client : public TunClient
                     tsconf.layer = config->tun_prop.layer;
                     tsconf.dev_name = config->dev_name;
                     tsconf.txqueuelen = config->txqueuelen;
+                    tsconf.n_queues = config->n_queues;
+                    tsconf.vnet_hdr = config->vnet_hdr;
                     tsconf.add_bypass_routes_on_establish = true;
 
                     // open/config tun
@@ -225,7 +546,9 @@ class Client : public TunClient
                                        config->stats,
                                        sd,
                                        state->iface_name));
-                impl->start(config->n_parallel);
+                vnet_hdr = TunLinuxSetup::Setup<TUN_LINUX>::vnet_hdr_enabled(sd);
+                start_impl(*impl);
+                start_queues();
 
                 // signal that we are connected
                 parent.tun_connected();
@@ -336,7 +659,15 @@ class Client : public TunClient
     bool send(Buffer &buf)
     {
         if (impl)
+        {
+            if (vnet_hdr)
+                return impl->write_vnet(buf);
+#ifdef OPENVPN_IO_URING
+            if (impl->uring_mode())
+                return impl->write_uring(buf);
+#endif
             return impl->write(buf);
+        }
         else
             return false;
     }
@@ -351,6 +682,42 @@ class Client : public TunClient
     {
     }
 
+    // Attach and start reading from the additional queues of a
+    // multi-queue device.  The kernel spreads flows from the tun
+    // across queues, while writes all go through the primary queue.
+    // All queues share the session's io_context, so this doesn't yet
+    // add parallelism: that needs a thread per queue, which the data
+    // channel crypto, being single-threaded per key, doesn't support.
+    void start_queues()
+    {
+        for (int i = 1; i < config->n_queues; ++i)
+        {
+            ScopedFD fd(TunLinuxSetup::Setup<TUN_LINUX>::open_queue(state->iface_name, config->tun_prop.layer, vnet_hdr));
+            TunImpl::Ptr q(new TunImpl(io_context,
+                                       this,
+                                       config->frame,
+                                       config->stats,
+                                       fd(),
+                                       state->iface_name));
+            queue_fds.push_back(std::move(fd));
+            start_impl(*q);
+            queues.push_back(std::move(q));
+        }
+    }
+
+    void start_impl(TunImpl &ti)
+    {
+        if (vnet_hdr)
+            ti.start_vnet(config->n_parallel);
+#ifdef OPENVPN_IO_URING
+        else if (!config->io_uring || !ti.start_uring(config->n_parallel))
+            ti.start(config->n_parallel);
+#else
+        else
+            ti.start(config->n_parallel);
+#endif
+    }
+
     void stop_()
     {
         if (!halt)
@@ -360,6 +727,10 @@ class Client : public TunClient
             // stop tun
             if (impl)
                 impl->stop();
+            for (auto &q : queues)
+                q->stop();
+            queues.clear();
+            queue_fds.clear();
 
             tun_persist.reset();
         }
@@ -370,8 +741,11 @@ class Client : public TunClient
     ClientConfig::Ptr config;
     TunClientParent &parent;
     TunImpl::Ptr impl;
+    std::vector<TunImpl::Ptr> queues;
+    std::vector<ScopedFD> queue_fds;
     TunProp::State::Ptr state;
     TunBuilderSetup::Base::Ptr tun_setup;
+    bool vnet_hdr = false;
     bool halt;
 };
 
@@ -296,7 +296,18 @@ struct NetlinkAddr4PtP : public Action
     bool add = true;
 };
 
-struct NetlinkRoute4 : public Action
+struct NetlinkRoute : public Action
+{
+    typedef RCPtr<NetlinkRoute> Ptr;
+
+    // queue this route on a batch, instead of executing it
+    virtual bool queue(SITNL::RouteBatch &batch, std::ostream &os) const = 0;
+
+    // report the error status of a queued route
+    virtual void error(std::ostream &os, const int ret) const = 0;
+};
+
+struct NetlinkRoute4 : public NetlinkRoute
 {
     typedef RCPtr<NetlinkRoute4> Ptr;
 
@@ -347,10 +358,40 @@ struct NetlinkRoute4 : public Action
         }
 
         if (ret)
+            error(os, ret);
+    }
+
+    virtual bool queue(SITNL::RouteBatch &batch, std::ostream &os) const override
+    {
+        if (dev.empty())
         {
-            os << "Error while executing NetlinkRoute4(add: " << add << ") "
-               << dev << ": " << ret << std::endl;
+            os << "Error: can't call NetlinkRoute4 with no interface" << std::endl;
+            return false;
+        }
+
+        const IP::Route r(IP::Addr::from_ipv4(route.addr), route.prefix_len);
+        int ret;
+        if (add)
+        {
+            ret = batch.route_add(r, IP::Addr::from_ipv4(gw), dev, 0, metric);
+        }
+        else
+        {
+            ret = batch.route_del(r, IP::Addr::from_ipv4(gw), dev, 0, metric);
+        }
+
+        if (ret)
+        {
+            error(os, ret);
+            return false;
         }
+        return true;
+    }
+
+    virtual void error(std::ostream &os, const int ret) const override
+    {
+        os << "Error while executing NetlinkRoute4(add: " << add << ") "
+           << dev << ": " << ret << std::endl;
     }
 
     virtual std::string to_string() const override
@@ -368,7 +409,7 @@ struct NetlinkRoute4 : public Action
     bool add = true;
 };
 
-struct NetlinkRoute6 : public Action
+struct NetlinkRoute6 : public NetlinkRoute
 {
     typedef RCPtr<NetlinkRoute6> Ptr;
 
@@ -419,10 +460,40 @@ struct NetlinkRoute6 : public Action
         }
 
         if (ret)
+            error(os, ret);
+    }
+
+    virtual bool queue(SITNL::RouteBatch &batch, std::ostream &os) const override
+    {
+        if (dev.empty())
         {
-            os << "Error while executing NetlinkRoute6(add: " << add << ") "
-               << dev << ": " << ret << std::endl;
+            os << "Error: can't call NetlinkRoute6 with no interface" << std::endl;
+            return false;
         }
+
+        const IP::Route r(IP::Addr::from_ipv6(route.addr), route.prefix_len);
+        int ret;
+        if (add)
+        {
+            ret = batch.route_add(r, IP::Addr::from_ipv6(gw), dev, 0, metric);
+        }
+        else
+        {
+            ret = batch.route_del(r, IP::Addr::from_ipv6(gw), dev, 0, metric);
+        }
+
+        if (ret)
+        {
+            error(os, ret);
+            return false;
+        }
+        return true;
+    }
+
+    virtual void error(std::ostream &os, const int ret) const override
+    {
+        os << "Error while executing NetlinkRoute6(add: " << add << ") "
+           << dev << ": " << ret << std::endl;
     }
 
     virtual std::string to_string() const override
@@ -440,6 +511,64 @@ struct NetlinkRoute6 : public Action
     bool add = true;
 };
 
+/**
+ * Add or delete a list of routes over a single netlink socket.
+ *
+ * Pushed configs may contain thousands of routes, and executing them as
+ * separate NetlinkRoute4/6 actions costs a socket and a round trip each.
+ */
+struct NetlinkRouteBatch : public Action
+{
+    typedef RCPtr<NetlinkRouteBatch> Ptr;
+
+    void add(const NetlinkRoute::Ptr &route)
+    {
+        if (route)
+            routes.push_back(route);
+    }
+
+    bool empty() const
+    {
+        return routes.empty();
+    }
+
+    virtual void execute(std::ostream &os) override
+    {
+        SITNL::RouteBatch batch;
+        std::vector<const NetlinkRoute *> queued;
+        queued.reserve(routes.size());
+        for (const auto &route : routes)
+        {
+            if (route->queue(batch, os))
+                queued.push_back(route.get());
+        }
+
+        OPENVPN_LOG("NetlinkRouteBatch: " << queued.size() << " routes");
+
+        batch.commit();
+        const std::vector<int> &results = batch.results();
+        for (size_t i = 0; i < queued.size(); ++i)
+        {
+            if (results[i])
+                queued[i]->error(os, results[i]);
+        }
+    }
+
+    virtual std::string to_string() const override
+    {
+        std::string ret;
+        for (const auto &route : routes)
+        {
+            if (!ret.empty())
+                ret += '\n';
+            ret += route->to_string();
+        }
+        return ret;
+    }
+
+    std::vector<NetlinkRoute::Ptr> routes;
+};
+
 enum
 { // add_del_route flags
     R_IPv6 = (1 << 0),
@@ -517,8 +646,8 @@ inline void add_del_route(const std::string &addr_str,
                           const int metric,
                           const unsigned int flags,
                           std::vector<IP::Route> *rtvec,
-                          Action::Ptr &create,
-                          Action::Ptr &destroy)
+                          NetlinkRoute::Ptr &create,
+                          NetlinkRoute::Ptr &destroy)
 {
     if (flags & R_IPv6)
     {
@@ -586,12 +715,40 @@ inline void add_del_route(const std::string &addr_str,
                           ActionList &create,
                           ActionList &destroy)
 {
-    Action::Ptr c, d;
+    NetlinkRoute::Ptr c, d;
+    add_del_route(addr_str, prefix_len, gateway_str, dev, metric, flags, rtvec, c, d);
+    create.add(c.get());
+    destroy.add(d.get());
+}
+
+inline void add_del_route(const std::string &addr_str,
+                          const int prefix_len,
+                          const std::string &gateway_str,
+                          const std::string &dev,
+                          const int metric,
+                          const unsigned int flags, // add interface route to rtvec if defined
+                          std::vector<IP::Route> *rtvec,
+                          NetlinkRouteBatch &create,
+                          NetlinkRouteBatch &destroy)
+{
+    NetlinkRoute::Ptr c, d;
     add_del_route(addr_str, prefix_len, gateway_str, dev, metric, flags, rtvec, c, d);
     create.add(c);
     destroy.add(d);
 }
 
+// add route batches to the action lists, unless empty
+inline void add_route_batch(const NetlinkRouteBatch::Ptr &create_batch,
+                            const NetlinkRouteBatch::Ptr &destroy_batch,
+                            ActionList &create,
+                            ActionList &destroy)
+{
+    if (!create_batch->empty())
+        create.add(create_batch.get());
+    if (!destroy_batch->empty())
+        destroy.add(destroy_batch.get());
+}
+
 inline void iface_up(const std::string &iface_name,
                      const int mtu,
                      ActionList &create,
@@ -705,6 +862,8 @@ struct TunMethods
 
         // Process Routes
         {
+            NetlinkRouteBatch::Ptr add_routes(new NetlinkRouteBatch);
+            NetlinkRouteBatch::Ptr del_routes(new NetlinkRouteBatch);
             for (const auto &route : pull.add_routes)
             {
                 if (route.ipv6)
@@ -717,8 +876,8 @@ struct TunMethods
                                       route.metric,
                                       R_ADD_ALL | R_IPv6,
                                       rtvec,
-                                      create,
-                                      destroy);
+                                      *add_routes,
+                                      *del_routes);
                 }
                 else
                 {
@@ -730,18 +889,21 @@ struct TunMethods
                                       route.metric,
                                       R_ADD_ALL,
                                       rtvec,
-                                      create,
-                                      destroy);
+                                      *add_routes,
+                                      *del_routes);
                     else
                         OPENVPN_LOG("ERROR: IPv4 route pushed without IPv4 ifconfig and/or route-gateway");
                 }
             }
+            add_route_batch(add_routes, del_routes, create, destroy);
         }
 
         // Process exclude routes
         if (!pull.exclude_routes.empty())
         {
             LinuxGW46Netlink gw(iface_name);
+            NetlinkRouteBatch::Ptr add_routes(new NetlinkRouteBatch);
+            NetlinkRouteBatch::Ptr del_routes(new NetlinkRouteBatch);
 
             for (const auto &route : pull.exclude_routes)
             {
@@ -759,12 +921,13 @@ struct TunMethods
                                       route.metric,
                                       R_ADD_SYS,
                                       rtvec,
-                                      create,
-                                      destroy);
+                                      *add_routes,
+                                      *del_routes);
                     else
                         OPENVPN_LOG("NOTE: cannot determine gateway for exclude IPv4 routes");
                 }
             }
+            add_route_batch(add_routes, del_routes, create, destroy);
         }
 
         // Process IPv4 redirect-gateway
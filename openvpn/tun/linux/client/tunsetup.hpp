@@ -36,6 +36,7 @@
 #include <openvpn/tun/client/tunprop.hpp>
 #include <openvpn/tun/client/tunconfigflags.hpp>
 #include <openvpn/netconf/linux/gw.hpp>
+#include <openvpn/tun/linux/vnethdr.hpp>
 
 namespace openvpn::TunLinuxSetup {
 
@@ -48,6 +49,13 @@ OPENVPN_EXCEPTION(tun_name_error);
 OPENVPN_EXCEPTION(tun_tx_queue_len_error);
 OPENVPN_EXCEPTION(tun_ifconfig_error);
 
+#ifndef TUN_F_USO4
+#define TUN_F_USO4 0x20
+#endif
+#ifndef TUN_F_USO6
+#define TUN_F_USO6 0x40
+#endif
+
 template <class TUNMETHODS>
 class Setup : public TunBuilderSetup::Base
 {
@@ -71,6 +79,8 @@ class Setup : public TunBuilderSetup::Base
         int txqueuelen = 0;
         bool add_bypass_routes_on_establish = false; // required when not using tunbuilder
         bool dco = false;
+        int n_queues = 1;      // if > 1, create the device with IFF_MULTI_QUEUE
+        bool vnet_hdr = false; // layer 3 only: IFF_VNET_HDR with TSO/USO offloads
 
 #ifdef HAVE_JSON
         virtual Json::Value to_json() override
@@ -81,6 +91,8 @@ class Setup : public TunBuilderSetup::Base
             root["dev_name"] = Json::Value(dev_name);
             root["txqueuelen"] = Json::Value(txqueuelen);
             root["dco"] = Json::Value(dco);
+            root["n_queues"] = Json::Value(n_queues);
+            root["vnet_hdr"] = Json::Value(vnet_hdr);
             return root;
         };
 
@@ -92,6 +104,8 @@ class Setup : public TunBuilderSetup::Base
             json::to_string(root, dev_name, "dev_name", title);
             json::to_int(root, txqueuelen, "txqueuelen", title);
             json::to_bool(root, dco, "dco", title);
+            n_queues = json::get_int_optional(root, "n_queues", 1, title);
+            vnet_hdr = json::get_bool_optional(root, "vnet_hdr", false, title);
         }
 #endif
     };
@@ -169,27 +183,82 @@ class Setup : public TunBuilderSetup::Base
         return fd;
     }
 
+    // Attach an additional queue to an existing multi-queue device
+    // (created with Config::n_queues > 1).  Returns a non-blocking fd
+    // owned by the caller.
+    // The queue must be opened with the same vnet_hdr setting as
+    // the device, otherwise the kernel changes it device-wide.
+    static int open_queue(const std::string &iface_name, const Layer &layer, const bool vnet_hdr)
+    {
+        ScopedFD fd(open_node());
+
+        struct ifreq ifr;
+        std::memset(&ifr, 0, sizeof(ifr));
+        ifr.ifr_flags = tun_flags(layer, true, vnet_hdr);
+        if (iface_name.length() >= IFNAMSIZ)
+            throw tun_name_error();
+        ::strcpy(ifr.ifr_name, iface_name.c_str());
+        if (ioctl(fd(), TUNSETIFF, (void *)&ifr) < 0)
+        {
+            const int eno = errno;
+            OPENVPN_THROW(tun_ioctl_error, "failed to attach queue to tun device '" << iface_name << "' : " << errinfo(eno));
+        }
+
+        if (fcntl(fd(), F_SETFL, O_NONBLOCK) < 0)
+            throw tun_fcntl_error(errinfo(errno));
+        return fd.release();
+    }
+
+    // Return true if fd is a tun device opened with IFF_VNET_HDR,
+    // i.e. every packet read or written is preceded by a VirtioNet::Header.
+    static bool vnet_hdr_enabled(const int fd)
+    {
+        struct ifreq ifr;
+        std::memset(&ifr, 0, sizeof(ifr));
+        if (ioctl(fd, TUNGETIFF, (void *)&ifr) < 0)
+            return false;
+        return (ifr.ifr_flags & IFF_VNET_HDR) != 0;
+    }
+
   private:
-    int open_tun(Config *conf)
+    static int open_node()
     {
         static const char node[] = "/dev/net/tun";
-        ScopedFD fd(open(node, O_RDWR));
-        if (!fd.defined())
+        const int fd = open(node, O_RDWR);
+        if (fd < 0)
             OPENVPN_THROW(tun_open_error, "error opening tun device " << node << ": " << errinfo(errno));
+        return fd;
+    }
 
-        struct ifreq ifr;
-        std::memset(&ifr, 0, sizeof(ifr));
-        ifr.ifr_flags = IFF_ONE_QUEUE;
-        ifr.ifr_flags |= IFF_NO_PI;
-        if (conf->layer() == Layer::OSI_LAYER_3)
-            ifr.ifr_flags |= IFF_TUN;
-        else if (conf->layer() == Layer::OSI_LAYER_2)
-            ifr.ifr_flags |= IFF_TAP;
+    static short tun_flags(const Layer &layer, const bool multi_queue, const bool vnet_hdr)
+    {
+        // IFF_ONE_QUEUE is obsolete and doesn't combine with IFF_MULTI_QUEUE
+        short flags = multi_queue ? IFF_MULTI_QUEUE : IFF_ONE_QUEUE;
+        flags |= IFF_NO_PI;
+        if (vnet_hdr && layer() == Layer::OSI_LAYER_3)
+            flags |= IFF_VNET_HDR;
+        if (layer() == Layer::OSI_LAYER_3)
+            flags |= IFF_TUN;
+        else if (layer() == Layer::OSI_LAYER_2)
+            flags |= IFF_TAP;
         else
             throw tun_layer_error("unknown OSI layer");
+        return flags;
+    }
+
+    int open_tun(Config *conf)
+    {
+        ScopedFD fd(open_node());
+
+        struct ifreq ifr;
+        std::memset(&ifr, 0, sizeof(ifr));
+        ifr.ifr_flags = tun_flags(conf->layer, conf->n_queues > 1, conf->vnet_hdr);
 
         open_unit(conf->dev_name, ifr, fd);
 
+        if (ifr.ifr_flags & IFF_VNET_HDR)
+            set_offload(fd());
+
         if (fcntl(fd(), F_SETFL, O_NONBLOCK) < 0)
             throw tun_fcntl_error(errinfo(errno));
 
@@ -216,6 +285,27 @@ class Setup : public TunBuilderSetup::Base
         return fd.release();
     }
 
+    // Let the kernel pass us unchecksummed packets and TCP/UDP
+    // super-packets, falling back to older offload sets if the
+    // kernel doesn't know about USO.
+    static void set_offload(const int fd)
+    {
+        const int hdr_size = sizeof(VirtioNet::Header);
+        if (ioctl(fd, TUNSETVNETHDRSZ, (void *)&hdr_size) < 0)
+            throw tun_ioctl_error("TUNSETVNETHDRSZ: " + errinfo(errno));
+
+        static const unsigned int offloads[] = {
+            TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6 | TUN_F_USO4 | TUN_F_USO6,
+            TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6,
+            0,
+        };
+        for (const unsigned int off : offloads)
+        {
+            if (ioctl(fd, TUNSETOFFLOAD, off) == 0)
+                return;
+        }
+    }
+
     void open_unit(const std::string &name, struct ifreq &ifr, ScopedFD &fd)
     {
         if (!name.empty())
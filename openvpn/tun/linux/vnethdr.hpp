@@ -0,0 +1,250 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Segmentation of packets read from a Linux tun device opened
+// with IFF_VNET_HDR and TSO/USO offloads enabled.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <openvpn/common/socktypes.hpp>
+#include <openvpn/buffer/buffer.hpp>
+#include <openvpn/ip/csum.hpp>
+#include <openvpn/ip/ip4.hpp>
+#include <openvpn/ip/ip6.hpp>
+#include <openvpn/ip/tcp.hpp>
+#include <openvpn/ip/udp.hpp>
+
+namespace openvpn::VirtioNet {
+
+// struct virtio_net_hdr from <linux/virtio_net.h>, which can't be
+// included from C++.  Fields are in host byte order.
+struct Header
+{
+    enum
+    {
+        F_NEEDS_CSUM = 1,
+    };
+
+    enum
+    {
+        GSO_NONE = 0,
+        GSO_TCPV4 = 1,
+        GSO_UDP = 3,
+        GSO_TCPV6 = 4,
+        GSO_UDP_L4 = 5,
+        GSO_ECN = 0x80,
+    };
+
+    std::uint8_t flags;
+    std::uint8_t gso_type;
+    std::uint16_t hdr_len;
+    std::uint16_t gso_size;
+    std::uint16_t csum_start;
+    std::uint16_t csum_offset;
+};
+
+// The kernel may hand us a single "super-packet" of up to 64 KB
+// together with a Header describing how to cut it into
+// MTU-sized TCP or UDP segments.  Segmenter produces those
+// segments one at a time, fixing up IP lengths and ids, TCP
+// sequence numbers and flags, and L4 checksums.  Packets without
+// GSO are passed through, completing a pending checksum if the
+// kernel asked for it (TUN_F_CSUM).
+class Segmenter
+{
+  public:
+    enum
+    {
+        MAX_PACKET = 65535,
+    };
+
+    // pkt must remain valid until done() returns true.
+    // Returns false if the packet/header is malformed.
+    bool init(const Header &vh, std::uint8_t *pkt, const size_t len)
+    {
+        pkt_ = pkt;
+        len_ = len;
+        offset_ = 0;
+        index_ = 0;
+        proto_ = 0;
+
+        const unsigned int gso_type = vh.gso_type & ~Header::GSO_ECN;
+        if (gso_type == Header::GSO_NONE)
+        {
+            if (vh.flags & Header::F_NEEDS_CSUM)
+            {
+                // the checksum field already contains the pseudo-header sum
+                const size_t start = vh.csum_start;
+                const size_t pos = start + vh.csum_offset;
+                if (pos + 2 > len)
+                    return false;
+                const std::uint16_t sum = IPChecksum::cfold(IPChecksum::compute(pkt + start, len - start));
+                std::memcpy(pkt + pos, &sum, sizeof(sum));
+            }
+            hdr_len_ = 0;
+            seg_size_ = len;
+            return len > 0;
+        }
+
+        if (gso_type == Header::GSO_TCPV4 || gso_type == Header::GSO_TCPV6)
+            proto_ = IPCommon::TCP;
+        else if (gso_type == Header::GSO_UDP_L4)
+            proto_ = IPCommon::UDP;
+        else
+            return false;
+
+        // the kernel always requests L4 checksum offload for GSO
+        // packets, so csum_start tells us where the L4 header is
+        l4_off_ = vh.csum_start;
+        seg_size_ = vh.gso_size;
+        if (!seg_size_ || len < sizeof(IPv4Header))
+            return false;
+
+        version_ = IPCommon::version(pkt[0]);
+        if (version_ == IPCommon::IPv4)
+        {
+            const IPv4Header *ip = (const IPv4Header *)pkt;
+            if (ip->protocol != proto_ || l4_off_ != IPv4Header::length(ip->version_len))
+                return false;
+        }
+        else if (version_ == IPCommon::IPv6)
+        {
+            if (l4_off_ < sizeof(IPv6Header))
+                return false;
+        }
+        else
+            return false;
+
+        if (proto_ == IPCommon::TCP)
+        {
+            if (l4_off_ + sizeof(TCPHeader) > len)
+                return false;
+            const TCPHeader *tcp = (const TCPHeader *)(pkt + l4_off_);
+            const unsigned int tcp_len = TCPHeader::length(tcp->doff_res);
+            if (tcp_len < sizeof(TCPHeader))
+                return false;
+            hdr_len_ = l4_off_ + tcp_len;
+        }
+        else
+            hdr_len_ = l4_off_ + sizeof(UDPHeader);
+
+        return hdr_len_ < len;
+    }
+
+    bool done() const
+    {
+        return hdr_len_ + offset_ >= len_;
+    }
+
+    // Size of the next segment, or 0 if done.
+    size_t next_size() const
+    {
+        if (done())
+            return 0;
+        return hdr_len_ + std::min(seg_size_, len_ - hdr_len_ - offset_);
+    }
+
+    // Append the next segment to out.  Returns false if done
+    // or if out lacks room for the segment.
+    bool next(Buffer &out)
+    {
+        const size_t size = next_size();
+        if (!size || out.remaining() < size)
+            return false;
+
+        std::uint8_t *seg = out.data_end();
+        out.write(pkt_, hdr_len_);
+        out.write(pkt_ + hdr_len_ + offset_, size - hdr_len_);
+        if (proto_)
+            fixup(seg, size);
+
+        offset_ += size - hdr_len_;
+        ++index_;
+        return true;
+    }
+
+  private:
+    void fixup(std::uint8_t *seg, const size_t size) const
+    {
+        const size_t l4_len = size - l4_off_;
+        const bool last = hdr_len_ + offset_ + (size - hdr_len_) >= len_;
+
+        // IP header and pseudo-header sum
+        std::uint32_t sum;
+        if (version_ == IPCommon::IPv4)
+        {
+            IPv4Header *ip = (IPv4Header *)seg;
+            ip->tot_len = htons(static_cast<std::uint16_t>(size));
+            ip->id = htons(static_cast<std::uint16_t>(ntohs(ip->id) + index_));
+            ip->check = 0;
+            ip->check = IPChecksum::checksum(ip, l4_off_);
+
+            const std::uint8_t pseudo[4] = {0, proto_, std::uint8_t(l4_len >> 8), std::uint8_t(l4_len)};
+            sum = IPChecksum::compute(&ip->saddr, 8);
+            sum = IPChecksum::partial(pseudo, sizeof(pseudo), sum);
+        }
+        else
+        {
+            IPv6Header *ip = (IPv6Header *)seg;
+            ip->payload_len = htons(static_cast<std::uint16_t>(size - sizeof(IPv6Header)));
+
+            const std::uint8_t pseudo[8] = {0, 0, std::uint8_t(l4_len >> 8), std::uint8_t(l4_len), 0, 0, 0, proto_};
+            sum = IPChecksum::compute(&ip->saddr, 32);
+            sum = IPChecksum::partial(pseudo, sizeof(pseudo), sum);
+        }
+
+        // L4 header and checksum
+        std::uint8_t *l4 = seg + l4_off_;
+        if (proto_ == IPCommon::TCP)
+        {
+            TCPHeader *tcp = (TCPHeader *)l4;
+            tcp->seq = htonl(ntohl(tcp->seq) + static_cast<std::uint32_t>(offset_));
+            if (!last)
+                tcp->flags &= ~(TCP_FIN | TCP_PSH);
+            if (index_)
+                tcp->flags &= ~TCP_CWR;
+            tcp->check = 0;
+            tcp->check = IPChecksum::cfold(IPChecksum::partial(l4, l4_len, sum));
+        }
+        else
+        {
+            UDPHeader *udp = (UDPHeader *)l4;
+            udp->len = htons(static_cast<std::uint16_t>(l4_len));
+            udp->check = 0;
+            udp->check = IPChecksum::cfold(IPChecksum::partial(l4, l4_len, sum));
+            if (!udp->check)
+                udp->check = 0xFFFF;
+        }
+    }
+
+    enum
+    {
+        TCP_FIN = 0x01,
+        TCP_PSH = 0x08,
+        TCP_CWR = 0x80,
+    };
+
+    std::uint8_t *pkt_ = nullptr;
+    size_t len_ = 0;
+    size_t hdr_len_ = 0;
+    size_t l4_off_ = 0;
+    size_t seg_size_ = 0;
+    size_t offset_ = 0;
+    unsigned int index_ = 0;
+    unsigned int version_ = 0;
+    std::uint8_t proto_ = 0;
+};
+
+} // namespace openvpn::VirtioNet
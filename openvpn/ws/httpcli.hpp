@@ -36,6 +36,7 @@
 #include <cstdint>
 #include <utility>
 #include <memory>
+#include <deque>
 #include <algorithm> // for std::min, std::max
 
 #ifdef USE_ASYNC_RESOLVE
@@ -451,6 +452,7 @@ class HTTPCore : public Base, public TransportClientParent
             halt = true;
             ready = false;
             alive = false;
+            pipeline.clear();
             if (transcli)
                 transcli->stop();
             if (link)
@@ -621,6 +623,16 @@ class HTTPCore : public Base, public TransportClientParent
     {
     }
 
+    // HTTP/1.1 pipelining: return true after filling in req and ci to send
+    // another request right behind the current one, where index is 1 for
+    // the first pipelined request.  Pipelined requests must be keepalive
+    // requests without content.  Their replies are delivered in order
+    // through the usual callbacks, without further start_request() calls.
+    virtual bool http_pipeline_request(const size_t index, Request &req, ContentInfo &ci)
+    {
+        return false;
+    }
+
   private:
     typedef TCPTransport::TCPLink<AsioProtocol, HTTPCore *, false> LinkImpl;
     friend LinkImpl::Base; // calls tcp_* handlers
@@ -1081,6 +1093,7 @@ class HTTPCore : public Base, public TransportClientParent
     {
         rr_reset();
         http_out_begin();
+        pipeline.clear();
 
         const Request req = http_request();
         content_info = http_content_info();
@@ -1097,37 +1110,51 @@ class HTTPCore : public Base, public TransportClientParent
         {
             // non-websocket allows immediate content-out
             content_out_hold = false;
-            generate_request_http(os, req);
+            generate_request_http(os, req, content_info);
+
+            // pipelining is only possible if nothing follows the headers
+            if (content_info.keepalive && !content_info.length)
+            {
+                Request preq;
+                ContentInfo pci;
+                while (http_pipeline_request(pipeline.size() + 1, preq, pci))
+                {
+                    if (!pci.keepalive || pci.length || pci.websocket)
+                        throw http_client_exception("pipelined request must be keepalive and without content");
+                    generate_request_http(os, preq, pci);
+                    pipeline.push_back(std::move(pci));
+                }
+            }
         }
 
         http_headers_sent(*outbuf);
         http_out();
     }
 
-    void generate_request_http(std::ostream &os, const Request &req)
+    void generate_request_http(std::ostream &os, const Request &req, const ContentInfo &ci)
     {
         os << req.method << ' ' << req.uri << " HTTP/1.1\r\n";
-        if (!content_info.lean_headers)
+        if (!ci.lean_headers)
         {
             os << "Host: " << host.host_head() << "\r\n";
             if (!config->user_agent.empty())
                 os << "User-Agent: " << config->user_agent << "\r\n";
         }
         generate_basic_auth_headers(os, req);
-        if (content_info.length)
-            os << "Content-Type: " << content_info.type << "\r\n";
-        if (content_info.length > 0)
-            os << "Content-Length: " << content_info.length << "\r\n";
-        else if (content_info.length == ContentInfo::CHUNKED)
+        if (ci.length)
+            os << "Content-Type: " << ci.type << "\r\n";
+        if (ci.length > 0)
+            os << "Content-Length: " << ci.length << "\r\n";
+        else if (ci.length == ContentInfo::CHUNKED)
             os << "Transfer-Encoding: chunked"
                << "\r\n";
-        for (auto &h : content_info.extra_headers)
+        for (auto &h : ci.extra_headers)
             os << h << "\r\n";
-        if (!content_info.content_encoding.empty())
-            os << "Content-Encoding: " << content_info.content_encoding << "\r\n";
-        if (content_info.keepalive)
+        if (!ci.content_encoding.empty())
+            os << "Content-Encoding: " << ci.content_encoding << "\r\n";
+        if (ci.keepalive)
             os << "Connection: keep-alive\r\n";
-        if (!content_info.lean_headers)
+        if (!ci.lean_headers)
             os << "Accept: */*\r\n";
         os << "\r\n";
     }
@@ -1316,6 +1343,18 @@ class HTTPCore : public Base, public TransportClientParent
     {
         if (halt)
             return;
+        if (!pipeline.empty() && !parent_handoff && !websocket)
+        {
+            // the reply to the next pipelined request follows
+            http_done(Status::E_SUCCESS, "Succeeded");
+            if (!halt)
+            {
+                content_info = std::move(pipeline.front());
+                pipeline.pop_front();
+                rr_pipeline_next(residual);
+            }
+            return;
+        }
         if ((content_info.keepalive || parent_handoff) && !websocket)
         {
             general_timer.cancel();
@@ -1426,6 +1465,9 @@ class HTTPCore : public Base, public TransportClientParent
     bool content_out_hold = true;
     bool alive = false;
 
+    // content info of pipelined requests still awaiting a reply
+    std::deque<ContentInfo> pipeline;
+
 #ifdef SIMULATE_HTTPCLI_FAILURES // debugging -- simulate network failures
     PeriodicFail periodic_fail;
 #endif
@@ -1549,7 +1591,29 @@ class HTTPDelegate : public HTTPCore
             parent_->http_post_connect(*this, sock);
     }
 
+    bool http_pipeline_request(const size_t index, Request &req, ContentInfo &ci) override
+    {
+        if (parent_)
+            return pipeline_request(parent_, index, req, ci, 0);
+        else
+            return false;
+    }
+
   private:
+    // Pipelining is only used by parents that define http_pipeline_request()
+    template <typename P>
+    auto pipeline_request(P *parent, const size_t index, Request &req, ContentInfo &ci, int)
+        -> decltype(parent->http_pipeline_request(*this, index, req, ci))
+    {
+        return parent->http_pipeline_request(*this, index, req, ci);
+    }
+
+    template <typename P>
+    bool pipeline_request(P *, const size_t, Request &, ContentInfo &, long)
+    {
+        return false;
+    }
+
     PARENT *parent_;
 };
 } // namespace openvpn::WS::Client
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <limits>
 #include <map>
+#include <deque>
 
 #include <openvpn/asio/asiostop.hpp>
 #include <openvpn/common/cleanup.hpp>
@@ -182,6 +183,7 @@ class ClientSet : public RC<thread_unsafe_refcount>
 
     class TransactionSet;
     struct Transaction;
+    class ConnectionPool;
 
     struct ErrorRecovery : public RC<thread_unsafe_refcount>
     {
@@ -367,6 +369,15 @@ class ClientSet : public RC<thread_unsafe_refcount>
         // such as the hostname.
         ErrorRecovery::Ptr error_recovery;
 
+        // Optional connection pool shared with other transaction sets.
+        // Takes precedence over assign_http_state().
+        RCPtr<ConnectionPool> pool;
+
+        // Send keepalive requests without content right behind each
+        // other, without waiting for the previous reply (HTTP/1.1
+        // pipelining).  Only enable for servers known to support it.
+        bool pipeline = false;
+
         void assign_http_state(HTTPStateContainer &http_state)
         {
             http_state.create_container();
@@ -485,6 +496,233 @@ class ClientSet : public RC<thread_unsafe_refcount>
         size_t index = 0;
     };
 
+    // Keepalive connections shared by the transaction sets of any number
+    // of ClientSets running on the same io_context, to avoid a new TCP
+    // connection and TLS handshake per transaction set.  Connections are
+    // keyed by scheme, host and port.  At most max_per_host transaction
+    // sets use connections to the same host at a time, the others wait
+    // until one of them completes.  Idle connections are closed after
+    // idle_timeout.
+    class ConnectionPool : public RC<thread_unsafe_refcount>
+    {
+      public:
+        typedef RCPtr<ConnectionPool> Ptr;
+
+        struct Config
+        {
+            unsigned int max_per_host = 4; // 0 for no limit
+            unsigned int max_idle_per_host = 4;
+            Time::Duration idle_timeout = Time::Duration::seconds(30);
+        };
+
+        ConnectionPool(openvpn_io::io_context &io_context_arg,
+                       const Config &config_arg)
+            : io_context(io_context_arg),
+              config(config_arg),
+              reap_timer(io_context_arg)
+        {
+        }
+
+        // close all idle connections
+        void stop()
+        {
+            reap_timer.cancel();
+            reap_pending = false;
+            for (auto &h : hosts)
+            {
+                for (auto &e : h.second.idle)
+                    e.hsc.stop(false);
+                h.second.idle.clear();
+            }
+        }
+
+        size_t n_idle() const
+        {
+            size_t ret = 0;
+            for (const auto &h : hosts)
+                ret += h.second.idle.size();
+            return ret;
+        }
+
+        size_t n_active() const
+        {
+            size_t ret = 0;
+            for (const auto &h : hosts)
+                ret += h.second.active;
+            return ret;
+        }
+
+      private:
+        friend Client;
+
+        struct Idle
+        {
+            HTTPStateContainer hsc;
+            Time since;
+        };
+
+        struct Host
+        {
+            unsigned int active = 0;
+            std::deque<Idle> idle; // most recently used at back
+            std::deque<RCPtr<Client>> waiting;
+        };
+
+        // Connections are only shared by transaction sets with the same
+        // http_config and the same Host settings for the transport.
+        // Pooled connections hold a reference to their http_config, so
+        // its address can't be reused by another config while in the pool.
+        static std::string key(const TransactionSet &ts)
+        {
+            const WS::Client::Config &hc = *ts.http_config;
+            const WS::Client::Host &host = ts.host;
+            std::ostringstream os;
+            os << (hc.ssl_factory ? "https " : "http ") << host.host_port_str()
+               << " config=" << &hc << '/' << hc.ssl_factory.get() << '/' << hc.transcli.get()
+               << " cn=" << host.cn
+               << " key=" << host.key
+               << " local=" << host.local_addr << '/' << host.local_addr_alt << '/' << host.local_port;
+#ifdef VPN_BINDING_PROFILES
+            os << " via_vpn=" << host.via_vpn.get();
+#endif
+            return os.str();
+        }
+
+        // Return true if cli may proceed, otherwise cli is
+        // started by release() when a slot becomes available.
+        bool acquire(Client &cli)
+        {
+            if (&io_context != &cli.parent->io_context)
+                throw Exception("ClientSet::ConnectionPool: transaction set runs on a different io_context");
+            cli.pool_key = key(*cli.ts);
+            Host &h = hosts[cli.pool_key];
+            if (config.max_per_host && h.active >= config.max_per_host)
+            {
+                h.waiting.emplace_back(&cli);
+                return false;
+            }
+            assign(h, cli);
+            return true;
+        }
+
+        // called when cli stops, keepalive indicates that
+        // its connection may be reused
+        void release(Client &cli, const bool keepalive)
+        {
+            const auto i = hosts.find(cli.pool_key);
+            if (i == hosts.end())
+                return;
+            Host &h = i->second;
+
+            if (cli.pool_assigned)
+            {
+                cli.pool_assigned = false;
+                --h.active;
+
+                HTTPStateContainer hsc = cli.ts->hsc;
+                cli.ts->hsc = HTTPStateContainer();
+                if (keepalive && hsc.alive() && h.idle.size() < config.max_idle_per_host)
+                {
+                    h.idle.push_back(Idle{std::move(hsc), Time::now()});
+                    schedule_reap();
+                }
+                else
+                    hsc.stop(false);
+            }
+            else
+            {
+                // still waiting
+                h.waiting.erase(std::remove(h.waiting.begin(), h.waiting.end(), RCPtr<Client>(&cli)),
+                                h.waiting.end());
+            }
+
+            while (!h.waiting.empty() && (!config.max_per_host || h.active < config.max_per_host))
+            {
+                RCPtr<Client> next = std::move(h.waiting.front());
+                h.waiting.pop_front();
+                assign(h, *next);
+                openvpn_io::post(io_context, [next = std::move(next)]()
+                                 { next->start_transactions(); });
+            }
+
+            if (!h.active && h.idle.empty() && h.waiting.empty())
+                hosts.erase(i);
+        }
+
+        // give cli the most recently used idle connection to its
+        // host, or an empty container for a new connection
+        void assign(Host &h, Client &cli)
+        {
+            ++h.active;
+            cli.pool_assigned = true;
+            TransactionSet &ts = *cli.ts;
+            ts.hsc = HTTPStateContainer();
+            ts.preserve_http_state = true;
+            while (!h.idle.empty())
+            {
+                HTTPStateContainer hsc = std::move(h.idle.back().hsc);
+                h.idle.pop_back();
+                if (hsc.alive(ts.host.host))
+                {
+                    ts.hsc = std::move(hsc);
+                    return;
+                }
+                hsc.stop(false);
+            }
+            ts.hsc.create_container();
+        }
+
+        // wake up when the oldest idle connection expires
+        void schedule_reap()
+        {
+            if (reap_pending)
+                return;
+            Time oldest;
+            for (const auto &h : hosts)
+            {
+                if (!h.second.idle.empty() && (!oldest.defined() || h.second.idle.front().since < oldest))
+                    oldest = h.second.idle.front().since;
+            }
+            if (!oldest.defined())
+                return;
+            reap_pending = true;
+            reap_timer.expires_at(oldest + config.idle_timeout);
+            reap_timer.async_wait([self = Ptr(this)](const openvpn_io::error_code &error)
+                                  {
+                if (!error)
+                {
+                    self->reap_pending = false;
+                    self->reap();
+                } });
+        }
+
+        // close connections idle for longer than idle_timeout
+        void reap()
+        {
+            const Time now = Time::now();
+            for (auto i = hosts.begin(); i != hosts.end();)
+            {
+                Host &h = i->second;
+                while (!h.idle.empty() && h.idle.front().since + config.idle_timeout <= now)
+                {
+                    h.idle.front().hsc.stop(false);
+                    h.idle.pop_front();
+                }
+                if (!h.active && h.idle.empty() && h.waiting.empty())
+                    i = hosts.erase(i);
+                else
+                    ++i;
+            }
+            schedule_reap();
+        }
+
+        openvpn_io::io_context &io_context;
+        const Config config;
+        AsioTimerSafe reap_timer;
+        bool reap_pending = false;
+        std::map<std::string, Host> hosts;
+    };
+
     ClientSet(openvpn_io::io_context &io_context_arg)
         : io_context(io_context_arg),
           halt(false),
@@ -650,6 +888,16 @@ class ClientSet : public RC<thread_unsafe_refcount>
             started = true;
             ts->status = false;
             ts_iter = ts->transactions.begin();
+            if (ts->pool && !ts->pool->acquire(*this))
+                return true; // pool calls start_transactions() later
+            start_transactions();
+            return true;
+        }
+
+        void start_transactions()
+        {
+            if (halt)
+                return;
             if (ts->delayed_start.defined())
             {
                 retry_duration = ts->delayed_start;
@@ -659,7 +907,6 @@ class ClientSet : public RC<thread_unsafe_refcount>
             {
                 next_request(false);
             }
-            return true;
         }
 
         void stop(const bool keepalive, const bool shutdown)
@@ -669,6 +916,8 @@ class ClientSet : public RC<thread_unsafe_refcount>
             halt = true;
             reconnect_timer.cancel();
             close_http(keepalive, shutdown);
+            if (ts->pool)
+                ts->pool->release(*this, keepalive);
         }
 
         void reset_callbacks()
@@ -684,6 +933,8 @@ class ClientSet : public RC<thread_unsafe_refcount>
         }
 
       private:
+        friend ConnectionPool;
+
         void close_http(const bool keepalive, const bool shutdown)
         {
             ts->hsc.close(keepalive, shutdown);
@@ -743,6 +994,7 @@ class ClientSet : public RC<thread_unsafe_refcount>
                 return;
 
             retry_duration = ts->retry_duration;
+            n_pipelined = 0;
 
             // get current transaction
             Transaction &t = trans();
@@ -790,7 +1042,24 @@ class ClientSet : public RC<thread_unsafe_refcount>
 
         WS::Client::ContentInfo http_content_info(HTTPDelegate &hd) const
         {
-            const Transaction &t = trans();
+            return content_info(trans());
+        }
+
+        bool http_pipeline_request(HTTPDelegate &hd, const size_t index, WS::Client::Request &req, WS::Client::ContentInfo &ci)
+        {
+            if (!ts->pipeline || size_t(ts->transactions.end() - ts_iter) <= index)
+                return false;
+            const Transaction &t = *ts_iter[index];
+            if (!t.content_out.empty() || t.ci.length || !t.ci.keepalive || t.ci.websocket)
+                return false;
+            req = t.req;
+            ci = content_info(t);
+            n_pipelined = static_cast<unsigned int>(index);
+            return true;
+        }
+
+        static WS::Client::ContentInfo content_info(const Transaction &t)
+        {
             WS::Client::ContentInfo ci = t.ci;
             if (!ci.length)
                 ci.length = t.content_out.join_size();
@@ -920,14 +1189,26 @@ class ClientSet : public RC<thread_unsafe_refcount>
                     // do next request
                     ++ts_iter;
 
-                    // Post a call to next_request() under a fresh stack.
-                    // Currently we may actually be under tcp_read_handler() and
-                    // next_request() can trigger destructors.
-                    post_next_request();
+                    if (n_pipelined)
+                    {
+                        // request was already sent, its reply follows
+                        --n_pipelined;
+                        Transaction &next = trans();
+                        out_iter = next.content_out.begin();
+                        next.content_in.clear();
+                    }
+                    else
+                    {
+                        // Post a call to next_request() under a fresh stack.
+                        // Currently we may actually be under tcp_read_handler() and
+                        // next_request() can trigger destructors.
+                        post_next_request();
+                    }
                 }
                 else
                 {
                     // failed
+                    n_pipelined = 0;
                     ++n_retries;
                     if (ts->max_retries && n_retries >= ts->max_retries)
                     {
@@ -986,12 +1267,15 @@ class ClientSet : public RC<thread_unsafe_refcount>
         BufferList content_out;
         BufferList::const_iterator out_iter;
         unsigned int n_retries;
+        unsigned int n_pipelined = 0;
         size_t buf_tailroom;
         Time::Duration retry_duration;
         AsioTimerSafe reconnect_timer;
         client_t client_id;
         bool halt;
         bool started;
+        std::string pool_key;
+        bool pool_assigned = false;
     };
 
     void remove_client_id(const client_t client_id)
@@ -55,6 +55,13 @@ class HTTPBase : public REFCOUNT_BASE
 
   public:
     void rr_reset()
+    {
+        rr_reset_in();
+        out_state = S_PRE;
+    }
+
+    // reset the incoming request/reply state only
+    void rr_reset_in()
     {
         rr_obj.reset();
         rr_status = REQUEST_REPLY::Parser::pending;
@@ -65,7 +72,15 @@ class HTTPBase : public REFCOUNT_BASE
         rr_limit_bytes = 0;
         rr_chunked.reset();
         max_content_bytes = config->max_content_bytes;
-        out_state = S_PRE;
+    }
+
+    // start receiving the next pipelined request/reply,
+    // beginning with the residual data of the previous one
+    void rr_pipeline_next(BufferAllocated &residual)
+    {
+        rr_reset_in();
+        if (!residual.empty())
+            http_in(residual);
     }
 
     void reset()
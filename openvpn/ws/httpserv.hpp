@@ -20,6 +20,7 @@
 #include <memory>
 #include <unordered_map>
 #include <deque>
+#include <atomic>
 
 #include <openvpn/io/io.hpp>
 
@@ -29,9 +30,11 @@
 #include <openvpn/common/arraysize.hpp>
 #include <openvpn/common/function.hpp>
 #include <openvpn/common/sockopt.hpp>
+#include <openvpn/common/strerror.hpp>
 #include <openvpn/asio/asiopolysock.hpp>
 #include <openvpn/common/core.hpp>
 #include <openvpn/buffer/bufstream.hpp>
+#include <openvpn/buffer/buflist.hpp>
 #include <openvpn/time/timestr.hpp>
 #include <openvpn/time/asiotimersafe.hpp>
 #include <openvpn/time/coarsetime.hpp>
@@ -51,6 +54,17 @@
 #include <openvpn/ws/httpvpn.hpp>
 #endif
 
+#if !defined(OPENVPN_PLATFORM_WIN)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <openvpn/common/scoped_fd.hpp>
+#endif
+
+#if defined(OPENVPN_PLATFORM_LINUX)
+#include <sys/sendfile.h>
+#endif
+
 #ifdef OPENVPN_POLYSOCK_SUPPORTS_ALT_ROUTING
 #include <openvpn/kovpn/sock_mark.hpp>
 #endif
@@ -322,6 +336,36 @@ class Listener : public ProxyListener
             http_out();
         }
 
+        // Send a reply whose content is a chain of buffers.  The buffers
+        // are handed to the link one at a time as the send queue drains,
+        // rather than being joined into a single allocation.
+        void generate_reply_buffers(ContentInfo ci, BufferList buffers)
+        {
+            reply_buffers = std::move(buffers);
+            reply_source = REPLY_BUFFERS;
+            generate_reply_headers(std::move(ci));
+        }
+
+#if !defined(OPENVPN_PLATFORM_WIN)
+        // Send length bytes of fd, starting at offset, as the reply content.
+        // Takes ownership of fd.  Plain HTTP replies with a Content-Length
+        // are sent with sendfile() on Linux, otherwise the file is read one
+        // frame at a time as the send queue drains.
+        void generate_reply_file(ContentInfo ci, ScopedFD &&fd, const off_t offset, const content_len_t length)
+        {
+            if (ci.length != ContentInfo::CHUNKED)
+                ci.length = length;
+            reply_fd = std::move(fd);
+            reply_offset = offset;
+            reply_remaining = length;
+#if defined(OPENVPN_PLATFORM_LINUX)
+            reply_zero_copy = !ssl_sess && ci.length != ContentInfo::CHUNKED && sock->native_handle() >= 0;
+#endif
+            reply_source = REPLY_FILE;
+            generate_reply_headers(std::move(ci));
+        }
+#endif
+
         // return true if client asked for keepalive
         bool keepalive_request()
         {
@@ -501,6 +545,7 @@ class Listener : public ProxyListener
             if (!http_stop_called)
                 http_stop(Status::E_SUCCESS, "stop");
             http_destroy();
+            reply_reset();
             timeout_timer.cancel();
             if (link)
                 link->stop();
@@ -540,7 +585,9 @@ class Listener : public ProxyListener
             error_handler(Status::E_GENERAL_TIMEOUT, "General timeout");
         }
 
-        void add_to_pipeline(BufferAllocated &buf)
+        // residual data of the last request goes in front of
+        // data that was received but not yet consumed
+        void add_to_pipeline(BufferAllocated &buf, const bool residual = false)
         {
             if (!buf.empty())
                 http_pipeline_peek(buf);
@@ -550,7 +597,10 @@ class Listener : public ProxyListener
                 return;
             if (pipeline.size() >= parent->config->pipeline_max_size)
                 error_handler(Status::E_PIPELINE_OVERFLOW, "Pipeline overflow");
-            pipeline.push_back(std::move(buf));
+            if (residual)
+                pipeline.push_front(std::move(buf));
+            else
+                pipeline.push_back(std::move(buf));
         }
 
         void consume_pipeline()
@@ -635,12 +685,17 @@ class Listener : public ProxyListener
 
         BufferPtr base_http_content_out()
         {
+            if (reply_source != REPLY_NONE)
+                return reply_content_out();
             return http_content_out();
         }
 
         void base_http_content_out_needed()
         {
-            http_content_out_needed();
+            if (reply_source != REPLY_NONE)
+                http_content_out_finish(reply_content_out());
+            else
+                http_content_out_needed();
         }
 
         void base_http_out_eof()
@@ -682,7 +737,7 @@ class Listener : public ProxyListener
                 return;
             ready = true;
             handoff = parent_handoff;
-            add_to_pipeline(residual);
+            add_to_pipeline(residual, true);
             http_request_received();
         }
 
@@ -691,6 +746,119 @@ class Listener : public ProxyListener
             error_handler(errcode, err);
         }
 
+        // Next piece of content for generate_reply_buffers() or
+        // generate_reply_file(), or a null buffer at EOF.  Never returns
+        // an empty buffer, which HTTPBase would also take as EOF.
+        BufferPtr reply_content_out()
+        {
+            BufferPtr buf;
+            switch (reply_source)
+            {
+            case REPLY_BUFFERS:
+                while (!reply_buffers.empty() && !buf)
+                {
+                    buf = std::move(reply_buffers.front());
+                    reply_buffers.pop_front();
+                    if (buf && buf->empty())
+                        buf.reset(); // an empty chunk would terminate chunked encoding
+                }
+                break;
+#if !defined(OPENVPN_PLATFORM_WIN)
+            case REPLY_FILE:
+                buf = reply_file_out();
+                break;
+#endif
+            default:
+                break;
+            }
+            if (!buf)
+                reply_reset();
+            return buf;
+        }
+
+#if !defined(OPENVPN_PLATFORM_WIN)
+        BufferPtr reply_file_out()
+        {
+            if (reply_remaining <= 0)
+                return BufferPtr();
+
+#if defined(OPENVPN_PLATFORM_LINUX)
+            // sendfile() bypasses the link, so it may only be used once the
+            // link has flushed whatever it has queued, otherwise the next
+            // frame is read into a buffer like below
+            if (reply_zero_copy && link->send_queue_empty())
+            {
+                const int sd = sock->native_handle();
+                while (reply_remaining > 0)
+                {
+                    const ssize_t status = ::sendfile(sd, reply_fd(), &reply_offset, size_t(reply_remaining));
+                    if (status > 0)
+                    {
+                        reply_remaining -= status;
+                        stats->inc_stat(SessionStats::BYTES_OUT, status);
+                        activity();
+                    }
+                    else if (status == 0)
+                        throw http_server_exception("sendfile: unexpected end of file");
+                    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        // socket buffer is full: send the next frame through
+                        // the link, which polls us again once it is writable
+                        break;
+                    }
+                    else if (errno == EINTR)
+                        continue;
+                    else if (errno == EINVAL || errno == ENOSYS)
+                    {
+                        // not supported for this file or socket
+                        reply_zero_copy = false;
+                        break;
+                    }
+                    else
+                    {
+                        const int eno = errno;
+                        throw http_server_exception("sendfile: " + strerror_str(eno));
+                    }
+                }
+                if (reply_remaining <= 0)
+                    return BufferPtr();
+            }
+#endif
+
+            BufferPtr buf = BufferAllocatedRc::Create();
+            frame->prepare(Frame::WRITE_HTTP, *buf);
+            const size_t size = std::min((*frame)[Frame::WRITE_HTTP].payload(), size_t(reply_remaining));
+            ssize_t status;
+            do
+            {
+                status = ::pread(reply_fd(), buf->data(), size, reply_offset);
+            } while (status < 0 && errno == EINTR);
+            if (status < 0)
+            {
+                const int eno = errno;
+                throw http_server_exception("read reply file: " + strerror_str(eno));
+            }
+            if (status == 0)
+                throw http_server_exception("read reply file: unexpected end of file");
+            buf->set_size(status);
+            reply_offset += status;
+            reply_remaining -= status;
+            return buf;
+        }
+#endif
+
+        void reply_reset()
+        {
+            reply_source = REPLY_NONE;
+            reply_buffers.clear();
+#if !defined(OPENVPN_PLATFORM_WIN)
+            reply_fd.close();
+            reply_offset = 0;
+            reply_remaining = 0;
+            reply_zero_copy = false;
+#endif
+        }
+
         // error handlers
 
         void asio_error_handler(int errcode, const char *func_name, const openvpn_io::error_code &error)
@@ -765,6 +933,22 @@ class Listener : public ProxyListener
         bool handoff = false;
         bool http_stop_called = false;
 
+        // streamed reply content
+        enum ReplySource
+        {
+            REPLY_NONE,
+            REPLY_BUFFERS,
+            REPLY_FILE,
+        };
+        ReplySource reply_source = REPLY_NONE;
+        BufferList reply_buffers;
+#if !defined(OPENVPN_PLATFORM_WIN)
+        ScopedFD reply_fd;
+        off_t reply_offset = 0;
+        content_len_t reply_remaining = 0;
+        bool reply_zero_copy = false;
+#endif
+
 #ifdef OPENVPN_POLYSOCK_SUPPORTS_ALT_ROUTING
         bool is_alt_routing_ = false;
 #endif
@@ -773,6 +957,24 @@ class Listener : public ProxyListener
   public:
     typedef RCPtr<Listener> Ptr;
 
+    // Listener counters, may be read from any thread
+    struct Stats
+    {
+        std::uint64_t accepted = 0;  // connections handed to a client object
+        std::uint64_t rejected = 0;  // connections refused or failed on accept
+        std::uint64_t throttled = 0; // accepts deferred by throttling
+        std::uint64_t clients = 0;   // currently active clients
+
+        Stats &operator+=(const Stats &other)
+        {
+            accepted += other.accepted;
+            rejected += other.rejected;
+            throttled += other.throttled;
+            clients += other.clients;
+            return *this;
+        }
+    };
+
     template <typename L> // L is a Listen::Item or Listen::List
     Listener(openvpn_io::io_context &io_context_arg,
              const Config::Ptr &config_arg,
@@ -925,6 +1127,7 @@ class Listener : public ProxyListener
         for (auto &c : clients)
             c.second->stop(false, false);
         clients.clear();
+        n_clients.store(0, std::memory_order_relaxed);
 
         // stop client factory
         if (client_factory)
@@ -938,6 +1141,16 @@ class Listener : public ProxyListener
             func(*static_cast<CLIENT_INSTANCE *>(c.second.get()));
     }
 
+    Stats stats() const
+    {
+        Stats ret;
+        ret.accepted = n_accepted.load(std::memory_order_relaxed);
+        ret.rejected = n_rejected.load(std::memory_order_relaxed);
+        ret.throttled = n_throttled.load(std::memory_order_relaxed);
+        ret.clients = n_clients.load(std::memory_order_relaxed);
+        return ret;
+    }
+
   private:
     typedef std::unordered_map<client_t, Client::Ptr> ClientMap;
 
@@ -964,11 +1177,15 @@ class Listener : public ProxyListener
                 {
                     // throttle it
                     throttle_acceptor_indices.push_back(acceptor_index);
+                    n_throttled.fetch_add(1, std::memory_order_relaxed);
                     throttle_timer_wait();
                 }
             }
             else
+            {
                 throttle_acceptor_indices.push_back(acceptor_index);
+                n_throttled.fetch_add(1, std::memory_order_relaxed);
+            }
         }
         else
             queue_accept(acceptor_index);
@@ -1045,6 +1262,8 @@ class Listener : public ProxyListener
                 Client::Initializer ci(io_context, this, std::move(sock), client_id);
                 Client::Ptr cli = client_factory->new_client(ci);
                 clients[client_id] = cli;
+                n_clients.store(clients.size(), std::memory_order_relaxed);
+                n_accepted.fetch_add(1, std::memory_order_relaxed);
 
                 cli->start(ssl_mode);
             }
@@ -1053,6 +1272,7 @@ class Listener : public ProxyListener
         }
         catch (const std::exception &e)
         {
+            n_rejected.fetch_add(1, std::memory_order_relaxed);
             OPENVPN_LOG("exception in handle_accept: " << e.what());
         }
 
@@ -1079,7 +1299,10 @@ class Listener : public ProxyListener
     {
         ClientMap::const_iterator e = clients.find(client_id);
         if (e != clients.end())
+        {
             clients.erase(e);
+            n_clients.store(clients.size(), std::memory_order_relaxed);
+        }
     }
 
     virtual bool allow_client(AsioPolySock::Base &sock)
@@ -1117,6 +1340,11 @@ class Listener : public ProxyListener
 
     client_t next_id = 0;
     ClientMap clients;
+
+    std::atomic<std::uint64_t> n_accepted{0};
+    std::atomic<std::uint64_t> n_rejected{0};
+    std::atomic<std::uint64_t> n_throttled{0};
+    std::atomic<std::uint64_t> n_clients{0};
 };
 
 } // namespace openvpn::WS::Server
@@ -0,0 +1,242 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Run an HTTP server Listener on each of N threads.
+//
+// Every shard has its own io_context, thread, acceptors, client map and
+// accept throttle.  TCP listen items are bound by all shards with
+// SO_REUSEPORT, so the kernel spreads incoming connections over them.
+// Other listen items (unix sockets, named pipes) can't be shared, and are
+// only served by shard 0.
+//
+// Since the objects referenced by Config and the client factory are not
+// thread-safe, the ShardFactory creates them separately for each shard.
+// Each shard should count into its own SessionStats, session_stats()
+// snapshots them in their shard's thread and sums them.
+//
+// If a shard's thread exits with an exception, all shards are stopped,
+// since the port would otherwise only be served partially.  failed()
+// reports this; stop() must still be called to join the threads.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <openvpn/ws/httpserv.hpp>
+
+namespace openvpn::WS::Server {
+
+class ShardedListener : public RC<thread_safe_refcount>
+{
+  public:
+    typedef RCPtr<ShardedListener> Ptr;
+
+    struct ShardFactory
+    {
+        virtual ~ShardFactory() = default;
+
+        // called for each shard by start(), in the calling thread
+        virtual Config::Ptr new_config(const unsigned int shard) = 0;
+        virtual Listener::Client::Factory::Ptr new_client_factory(const unsigned int shard) = 0;
+    };
+
+    ShardedListener(const Listen::List &listen_list_arg,
+                    const unsigned int n_shards_arg,
+                    ShardFactory &factory_arg)
+        : listen_list(listen_list_arg),
+          n_shards(std::max(n_shards_arg, 1u)),
+          factory(factory_arg)
+    {
+    }
+
+    ~ShardedListener()
+    {
+        stop();
+    }
+
+    // Bind all shards, then start their threads.  Errors such as
+    // a failed bind are thrown here, before any thread is started.
+    void start()
+    {
+        if (!shards.empty())
+            return;
+
+        // TCP items only, for shards > 0
+        Listen::List tcp_list;
+        for (const auto &item : listen_list)
+        {
+            if (item.proto.is_tcp())
+                tcp_list.push_back(item);
+        }
+
+        try
+        {
+            for (unsigned int i = 0; i < n_shards; ++i)
+            {
+                std::unique_ptr<Shard> shard(new Shard());
+                Config::Ptr config = factory.new_config(i);
+                config->sockopt_flags |= Acceptor::TCP::REUSE_PORT;
+                shard->stats = config->stats;
+                shard->listener.reset(new Listener(shard->io_context,
+                                                   config,
+                                                   i ? tcp_list : listen_list,
+                                                   factory.new_client_factory(i)));
+                shard->listener->start();
+                shards.push_back(std::move(shard));
+            }
+        }
+        catch (...)
+        {
+            for (auto &shard : shards)
+                shard->listener->stop();
+            shards.clear();
+            throw;
+        }
+
+        for (unsigned int i = 0; i < shards.size(); ++i)
+        {
+            Shard *shard = shards[i].get();
+            shard->running = true;
+            shard->thread = std::thread([this, shard, i]()
+                                        {
+                try
+                {
+                    shard->io_context.run();
+                }
+                catch (const std::exception &e)
+                {
+                    OPENVPN_LOG("HTTP shard " << i << " exception: " << e.what() << ", stopping all shards");
+                    shard_failed(*shard);
+                }
+                shard->running.store(false, std::memory_order_release); });
+        }
+    }
+
+    // stop all shards and wait for their threads to exit
+    void stop()
+    {
+        for (auto &shard : shards)
+        {
+            openvpn_io::post(shard->io_context, [shard = shard.get()]()
+                             {
+                shard->listener->stop();
+                shard->io_context.stop(); });
+        }
+        for (auto &shard : shards)
+        {
+            if (shard->thread.joinable())
+                shard->thread.join();
+        }
+        shards.clear();
+    }
+
+    size_t size() const
+    {
+        return shards.size();
+    }
+
+    // true if a shard's thread exited with an exception, see above
+    bool failed() const
+    {
+        return failed_;
+    }
+
+    Listener::Stats shard_stats(const unsigned int shard) const
+    {
+        return shards.at(shard)->listener->stats();
+    }
+
+    // sum over all shards
+    Listener::Stats stats() const
+    {
+        Listener::Stats ret;
+        for (const auto &shard : shards)
+            ret += shard->listener->stats();
+        return ret;
+    }
+
+    // SessionStats counters are not atomic, so the snapshot is taken
+    // in the shard's thread while the caller waits, or directly once
+    // the thread has exited.  Don't call it concurrently with stop().
+    SessionStats::Snapshot session_stats(const unsigned int shard) const
+    {
+        Shard &s = *shards.at(shard);
+        if (!s.stats)
+            return SessionStats::Snapshot{};
+
+        // the shard's thread may exit before it runs the snapshot
+        auto promise = std::make_shared<std::promise<SessionStats::Snapshot>>();
+        std::future<SessionStats::Snapshot> future = promise->get_future();
+        openvpn_io::dispatch(s.io_context, [promise, stats = s.stats]()
+                             { promise->set_value(stats->snapshot()); });
+        while (future.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready)
+        {
+            if (!s.running.load(std::memory_order_acquire))
+                return s.stats->snapshot();
+        }
+        return future.get();
+    }
+
+    // sum over all shards
+    SessionStats::Snapshot session_stats() const
+    {
+        SessionStats::Snapshot ret{};
+        for (unsigned int i = 0; i < shards.size(); ++i)
+        {
+            const SessionStats::Snapshot ss = session_stats(i);
+            for (size_t j = 0; j < ret.size(); ++j)
+                ret[j] += ss[j];
+        }
+        return ret;
+    }
+
+  private:
+    struct Shard
+    {
+        openvpn_io::io_context io_context{1};
+        Listener::Ptr listener;
+        SessionStats::Ptr stats;
+        std::thread thread;
+        std::atomic<bool> running{false}; // false once thread has exited
+    };
+
+    // called in the thread of a shard whose io_context threw
+    void shard_failed(Shard &failed_shard)
+    {
+        failed_ = true;
+        failed_shard.listener->stop();
+        for (auto &shard : shards)
+        {
+            if (shard.get() == &failed_shard)
+                continue;
+            openvpn_io::post(shard->io_context, [shard = shard.get()]()
+                             {
+                shard->listener->stop();
+                shard->io_context.stop(); });
+        }
+    }
+
+    const Listen::List listen_list;
+    const unsigned int n_shards;
+    ShardFactory &factory;
+#ifdef UNIT_TEST
+  public:
+#endif
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> failed_{false};
+};
+
+} // namespace openvpn::WS::Server
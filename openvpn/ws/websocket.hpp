@@ -13,6 +13,8 @@
 
 #include <string>
 #include <cstdint>
+#include <algorithm>
+#include <cstring>
 #include <ostream>
 #include <tuple>
 #include <utility>
@@ -83,10 +85,34 @@ class Protocol
 
         void xor_buf(Buffer &buf) const
         {
-            const size_t size = buf.size();
-            std::uint8_t *data = buf.data();
+            xor_data(buf.data(), buf.size(), 0);
+        }
+
+        // XOR size bytes at data, where data is at byte offset pos
+        // within the payload, so that a payload may be (un)masked
+        // in several pieces.
+        void xor_data(std::uint8_t *data, size_t size, const std::uint64_t pos) const
+        {
+            const size_t phase = static_cast<size_t>(pos & 0x3);
+
+            // mask rotated to the current phase, repeated over 64 bits
+            std::uint8_t m[8];
+            for (size_t i = 0; i < sizeof(m); ++i)
+                m[i] = mask8[(phase + i) & 0x3];
+            std::uint64_t mask64;
+            std::memcpy(&mask64, m, sizeof(mask64));
+
+            // data may be unaligned, memcpy compiles to plain word moves
+            for (; size >= sizeof(mask64); data += sizeof(mask64), size -= sizeof(mask64))
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data, sizeof(word));
+                word ^= mask64;
+                std::memcpy(data, &word, sizeof(word));
+            }
+
             for (size_t i = 0; i < size; ++i)
-                data[i] ^= mask8[i & 0x3];
+                data[i] ^= m[i];
         }
 
         void prepend_mask(Buffer &buf) const
@@ -366,6 +392,7 @@ class Receiver
         message_complete = false;
         mask = 0;
         size = 0;
+        unmasked = 0;
     }
 
     void verify_message_complete() const
@@ -379,16 +406,15 @@ class Receiver
         if (message_complete)
             return true;
 
-        if (header_complete && size <= buf.size())
-        {
-            // un-xor the data on the server side only
-            if (!is_client)
-            {
-                Buffer b(buf.data(), static_cast<size_t>(size), true);
-                const Protocol::MaskingKey mk(mask);
-                mk.xor_buf(b);
-            }
+        if (!header_complete)
+            return false;
 
+        // un-xor the data on the server side only, as it arrives
+        if (!is_client)
+            unmask();
+
+        if (size <= buf.size())
+        {
             // get close status code
             if (s.opcode_ == Protocol::Close && size >= 2)
             {
@@ -404,11 +430,24 @@ class Receiver
         return false;
     }
 
+    // unmask the part of the payload received since the last call
+    void unmask()
+    {
+        const std::uint64_t avail = std::min(size, static_cast<std::uint64_t>(buf.size()));
+        if (avail > unmasked)
+        {
+            const Protocol::MaskingKey mk(mask);
+            mk.xor_data(buf.data() + unmasked, static_cast<size_t>(avail - unmasked), unmasked);
+            unmasked = avail;
+        }
+    }
+
     const bool is_client;
     bool header_complete;
     bool message_complete;
     std::uint32_t mask;
     std::uint64_t size;
+    std::uint64_t unmasked; // payload bytes already unmasked
     Status s;
     BufferAllocated buf;
 };
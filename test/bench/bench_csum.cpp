@@ -0,0 +1,74 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Internet checksum microbenchmark.
+//
+// Times IPChecksum::compute with each kernel available on this CPU over a
+// range of buffer sizes, and prints CSV to stdout:
+//
+//   kernel,size,calls,ns_per_call,bytes_per_sec
+//
+// usage: bench_csum [seconds_per_case]
+
+#include <cstdlib>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <openvpn/ip/csum.hpp>
+
+using namespace openvpn;
+
+int main(int argc, char *argv[])
+{
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 0.2;
+    const size_t sizes[] = {20, 40, 64, 128, 256, 576, 1500, 9000, 65535};
+    const IPChecksum::Kernel kernels[] = {
+        IPChecksum::Kernel::SCALAR,
+        IPChecksum::Kernel::SSE2,
+        IPChecksum::Kernel::AVX2,
+        IPChecksum::Kernel::NEON,
+    };
+
+    std::vector<std::uint8_t> data(65536 + 2);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = std::uint8_t(i * 2654435761u >> 24);
+
+    std::cout << "kernel,size,calls,ns_per_call,bytes_per_sec" << std::endl;
+    for (const auto kernel : kernels)
+    {
+        if (!IPChecksum::kernel_available(kernel))
+            continue;
+        for (const size_t size : sizes)
+        {
+            // keep the compiler from hoisting the call out of the loop
+            volatile std::uint32_t sink = 0;
+            size_t calls = 0;
+            double elapsed = 0;
+            const auto t0 = std::chrono::steady_clock::now();
+            do
+            {
+                for (int i = 0; i < 1024; ++i)
+                    sink = sink + IPChecksum::compute(data.data() + (i & 1), size, kernel);
+                calls += 1024;
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            } while (elapsed < seconds);
+
+            std::cout << IPChecksum::kernel_name(kernel) << ',' << size << ',' << calls << ','
+                      << std::fixed << std::setprecision(2)
+                      << elapsed * 1e9 / calls << ','
+                      << std::setprecision(0) << calls * size / elapsed
+                      << std::defaultfloat << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,415 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Data channel microbenchmark.
+//
+// Runs an in-memory client/server handshake through ProtoContext and then
+// times ProtoContext::data_encrypt on the client and data_decrypt on the
+// server (replay window, decompression and mssfix included) for every
+// combination of cipher, compression method, mssfix on/off and packet size.
+//
+// Results are written to stdout as CSV, one line per case:
+//
+//   backend,cipher,comp,mssfix,size,op,packets,pkts_per_sec,bytes_per_sec,ns_per_pkt,cycles_per_pkt
+//
+// cycles_per_pkt is measured with the TSC on x86 and left empty elsewhere.
+// The SSL/crypto backend is the one the binary was built with (USE_MBEDTLS
+// selects mbed TLS, OpenSSL otherwise).
+//
+// usage: bench_dc [seconds_per_case]
+
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC
+#endif
+
+#define OPENVPN_LOG_STREAM std::cerr
+#include <openvpn/log/logsimple.hpp>
+
+#include <openvpn/common/platform.hpp>
+#include <openvpn/init/initprocess.hpp>
+#include <openvpn/common/file.hpp>
+#include <openvpn/common/exception.hpp>
+#include <openvpn/frame/frame_init.hpp>
+#include <openvpn/ip/ip4.hpp>
+#include <openvpn/ip/tcp.hpp>
+#include <openvpn/random/mtrandapi.hpp>
+#include <openvpn/ssl/proto.hpp>
+#include <openvpn/crypto/cryptodcsel.hpp>
+
+#if defined(USE_MBEDTLS)
+#include <openvpn/mbedtls/crypto/api.hpp>
+#include <openvpn/mbedtls/ssl/sslctx.hpp>
+#include <openvpn/mbedtls/util/rand.hpp>
+#elif defined(USE_OPENSSL)
+#include <openvpn/openssl/crypto/api.hpp>
+#include <openvpn/openssl/ssl/sslctx.hpp>
+#include <openvpn/openssl/util/rand.hpp>
+#else
+#error no SSL backend defined
+#endif
+
+#ifndef TEST_KEYCERT_DIR
+#define TEST_KEYCERT_DIR "../ssl/"
+#endif
+
+using namespace openvpn;
+
+#if defined(USE_MBEDTLS)
+typedef MbedTLSCryptoAPI BenchCryptoAPI;
+typedef MbedTLSContext BenchSSLAPI;
+typedef MbedTLSRandom BenchRandomAPI;
+static const char backend_name[] = "mbedtls";
+#else
+typedef OpenSSLCryptoAPI BenchCryptoAPI;
+typedef OpenSSLContext BenchSSLAPI;
+typedef OpenSSLRandom BenchRandomAPI;
+static const char backend_name[] = "openssl";
+#endif
+
+OPENVPN_EXCEPTION(bench_error);
+
+// ProtoContext endpoint that queues control channel packets in memory
+class BenchProto : public ProtoContextCallbackInterface
+{
+  public:
+    BenchProto(const ProtoContext::ProtoConfig::Ptr &config,
+               const SessionStats::Ptr &stats)
+        : proto_context(this, config, stats)
+    {
+    }
+
+    ProtoContext proto_context;
+    std::deque<BufferPtr> net_out;
+
+  private:
+    void control_net_send(const Buffer &net_buf) override
+    {
+        net_out.push_back(BufferAllocatedRc::Create(net_buf, 0));
+    }
+
+    void control_recv(BufferPtr &&app_bp) override
+    {
+    }
+
+    bool supports_proto_v3() override
+    {
+        return true;
+    }
+
+    void active(bool primary) override
+    {
+    }
+};
+
+// move control channel packets from a to b
+static void xfer(BenchProto &a, BenchProto &b)
+{
+    if (a.proto_context.invalidated())
+        throw bench_error(std::string("handshake failed: ") + Error::name(a.proto_context.invalidation_reason()));
+    if (a.proto_context.now() >= a.proto_context.next_housekeeping())
+        a.proto_context.housekeeping();
+    while (!a.net_out.empty())
+    {
+        BufferPtr bp = std::move(a.net_out.front());
+        a.net_out.pop_front();
+        const ProtoContext::PacketType pt = b.proto_context.packet_type(*bp);
+        if (pt.is_control())
+            b.proto_context.control_net_recv(pt, std::move(bp));
+    }
+    b.proto_context.flush(true);
+}
+
+struct Case
+{
+    std::string cipher;
+    std::string digest;
+    CompressContext::Type comp;
+};
+
+struct Result
+{
+    size_t packets = 0;
+    double seconds = 0;
+    std::uint64_t cycles = 0;
+};
+
+class Session
+{
+  public:
+    Session(const Case &c, const Frame::Ptr &frame_arg)
+        : frame(frame_arg),
+          rng(new BenchRandomAPI()),
+          prng(new BenchRandomAPI())
+    {
+        const std::string ca_crt = read_text(TEST_KEYCERT_DIR "ca.crt");
+        const std::string dh_pem = read_text(TEST_KEYCERT_DIR "dh.pem");
+
+        // the test certificates are only used to set up the session, so
+        // peer verification is disabled to keep the benchmark independent
+        // of their validity period
+        BenchSSLAPI::Config::Ptr cc(new BenchSSLAPI::Config());
+        cc->set_mode(Mode(Mode::CLIENT));
+        cc->set_frame(frame);
+        cc->set_rng(rng);
+        cc->set_flags(SSLConst::NO_VERIFY_PEER);
+        cc->load_ca(ca_crt, true);
+        cc->load_cert(read_text(TEST_KEYCERT_DIR "client.crt"));
+        cc->load_private_key(read_text(TEST_KEYCERT_DIR "client.key"));
+
+        BenchSSLAPI::Config::Ptr sc(new BenchSSLAPI::Config());
+        sc->set_mode(Mode(Mode::SERVER));
+        sc->set_frame(frame);
+        sc->set_rng(rng);
+        sc->set_flags(SSLConst::NO_VERIFY_PEER);
+        sc->load_ca(ca_crt, true);
+        sc->load_cert(read_text(TEST_KEYCERT_DIR "server.crt"));
+        sc->load_private_key(read_text(TEST_KEYCERT_DIR "server.key"));
+        sc->load_dh(dh_pem);
+
+        cli.reset(new BenchProto(proto_config(c, cc), new SessionStats()));
+        serv.reset(new BenchProto(proto_config(c, sc), new SessionStats()));
+    }
+
+    void handshake()
+    {
+        cli->proto_context.reset();
+        serv->proto_context.reset();
+        cli->proto_context.start();
+        serv->proto_context.start();
+        cli->proto_context.flush(true);
+        for (int i = 0; i < 1000; ++i)
+        {
+            xfer(*cli, *serv);
+            xfer(*serv, *cli);
+            if (cli->proto_context.data_channel_ready() && serv->proto_context.data_channel_ready())
+                return;
+            now += Time::Duration::binary_ms(100);
+        }
+        throw bench_error("handshake did not complete");
+    }
+
+    // mssfix is applied by the receiving side on decrypt
+    void set_mss_fix(const unsigned int mss_fix)
+    {
+        serv->proto_context.conf().mss_fix = mss_fix;
+    }
+
+    // time encryption of n copies of payload into bufs, then decryption of bufs
+    void run(const Buffer &payload, std::vector<BufferAllocated> &bufs, Result &enc, Result &dec)
+    {
+        for (auto &b : bufs)
+        {
+            frame->prepare(Frame::READ_TUN, b);
+            b.write(payload.c_data(), payload.size());
+        }
+
+        time_loop(enc, [&]()
+                  {
+            for (auto &b : bufs)
+                cli->proto_context.data_encrypt(b); });
+
+        time_loop(dec, [&]()
+                  {
+            for (auto &b : bufs)
+            {
+                const ProtoContext::PacketType pt = serv->proto_context.packet_type(b);
+                serv->proto_context.data_decrypt(pt, b);
+                if (b.size() != payload.size())
+                    throw bench_error("decrypt failed");
+            } });
+
+        enc.packets += bufs.size();
+        dec.packets += bufs.size();
+    }
+
+  private:
+    ProtoContext::ProtoConfig::Ptr proto_config(const Case &c, const BenchSSLAPI::Config::Ptr &ssl)
+    {
+        ProtoContext::ProtoConfig::Ptr cp(new ProtoContext::ProtoConfig);
+        cp->ssl_factory = ssl->new_factory();
+        CryptoAlgs::allow_default_dc_algs<BenchCryptoAPI>(cp->ssl_factory->libctx(), false, false);
+        cp->dc.set_factory(new CryptoDCSelect<BenchCryptoAPI>(cp->ssl_factory->libctx(), frame, new SessionStats(), prng));
+        cp->tlsprf_factory.reset(new CryptoTLSPRFFactory<BenchCryptoAPI>());
+        cp->frame = frame;
+        cp->now = &now;
+        cp->rng = rng;
+        cp->prng = prng;
+        cp->protocol = Protocol(Protocol::UDPv4);
+        cp->layer = Layer(Layer::OSI_LAYER_3);
+        cp->enable_op32 = true;
+        cp->remote_peer_id = 100;
+        cp->comp_ctx = CompressContext(c.comp, false);
+        cp->dc.set_cipher(CryptoAlgs::lookup(c.cipher));
+        cp->dc.set_digest(CryptoAlgs::lookup(c.digest));
+        cp->handshake_window = Time::Duration::seconds(60);
+        cp->become_primary = cp->handshake_window;
+        cp->tls_timeout = Time::Duration::milliseconds(1000);
+        cp->renegotiate = Time::Duration::infinite();
+        cp->expire = Time::Duration::infinite();
+        cp->keepalive_ping = Time::Duration::seconds(10);
+        cp->keepalive_timeout = Time::Duration::seconds(60);
+        cp->keepalive_timeout_early = cp->keepalive_timeout;
+        return cp;
+    }
+
+    template <typename F>
+    static void time_loop(Result &r, F func)
+    {
+#ifdef BENCH_HAVE_TSC
+        const std::uint64_t c0 = __rdtsc();
+#endif
+        const auto t0 = std::chrono::steady_clock::now();
+        func();
+        const auto t1 = std::chrono::steady_clock::now();
+#ifdef BENCH_HAVE_TSC
+        r.cycles += __rdtsc() - c0;
+#endif
+        r.seconds += std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    Frame::Ptr frame;
+    StrongRandomAPI::Ptr rng;
+    StrongRandomAPI::Ptr prng;
+    Time now;
+    std::unique_ptr<BenchProto> cli;
+    std::unique_ptr<BenchProto> serv;
+};
+
+// IPv4 TCP SYN carrying an MSS option, so that mssfix has work to do,
+// followed by a payload that is half random and half repetitive
+static BufferAllocated make_packet(const size_t size, MTRand &rand)
+{
+    BufferAllocated buf(size, BufAllocFlags::ARRAY);
+    std::uint8_t *p = buf.data();
+    for (size_t i = 0; i < size; ++i)
+        p[i] = i < size / 2 ? std::uint8_t(rand.rand_get<std::uint8_t>()) : std::uint8_t("The quick brown fox "[i % 20]);
+
+    const size_t hlen = sizeof(IPv4Header) + sizeof(TCPHeader) + TCPHeader::OPTLEN_MAXSEG;
+    if (size >= hlen)
+    {
+        IPv4Header *ip = reinterpret_cast<IPv4Header *>(p);
+        std::memset(ip, 0, sizeof(IPv4Header));
+        ip->version_len = IPv4Header::ver_len(4, sizeof(IPv4Header));
+        ip->tot_len = htons(std::uint16_t(size));
+        ip->ttl = 64;
+        ip->protocol = IPCommon::TCP;
+
+        TCPHeader *tcp = reinterpret_cast<TCPHeader *>(p + sizeof(IPv4Header));
+        std::memset(tcp, 0, sizeof(TCPHeader));
+        tcp->doff_res = std::uint8_t(((sizeof(TCPHeader) + TCPHeader::OPTLEN_MAXSEG) / 4) << 4);
+        tcp->flags = TCPHeader::FLAG_SYN;
+
+        std::uint8_t *opt = reinterpret_cast<std::uint8_t *>(tcp + 1);
+        opt[0] = TCPHeader::OPT_MAXSEG;
+        opt[1] = TCPHeader::OPTLEN_MAXSEG;
+        opt[2] = 1460 >> 8;
+        opt[3] = 1460 & 0xFF;
+    }
+    return buf;
+}
+
+static const char *comp_name(const CompressContext::Type t)
+{
+    switch (t)
+    {
+    case CompressContext::NONE:
+        return "none";
+    case CompressContext::COMP_STUBv2:
+        return "stub-v2";
+    case CompressContext::LZ4v2:
+        return "lz4-v2";
+    default:
+        return "other";
+    }
+}
+
+static void report(const Case &c, const bool mss_fix, const size_t size, const char *op, const Result &r)
+{
+    const double pps = r.packets / r.seconds;
+    std::cout << backend_name << ',' << c.cipher << ',' << comp_name(c.comp) << ','
+              << (mss_fix ? "on" : "off") << ',' << size << ',' << op << ','
+              << r.packets << ',' << std::fixed << std::setprecision(1)
+              << pps << ',' << pps * size << ','
+              << r.seconds * 1e9 / r.packets << ',';
+#ifdef BENCH_HAVE_TSC
+    std::cout << double(r.cycles) / r.packets;
+#endif
+    std::cout << std::defaultfloat << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        InitProcess::Init init;
+        const double seconds = argc > 1 ? std::atof(argv[1]) : 0.25;
+        const size_t batch = 256;
+
+        const std::vector<Case> cases = {
+            {"AES-256-GCM", "none", CompressContext::NONE},
+            {"AES-256-GCM", "none", CompressContext::COMP_STUBv2},
+            {"AES-256-GCM", "none", CompressContext::LZ4v2},
+            {"CHACHA20-POLY1305", "none", CompressContext::NONE},
+            {"CHACHA20-POLY1305", "none", CompressContext::COMP_STUBv2},
+            {"CHACHA20-POLY1305", "none", CompressContext::LZ4v2},
+            {"AES-256-CBC", "SHA256", CompressContext::NONE},
+            {"AES-256-CBC", "SHA256", CompressContext::COMP_STUBv2},
+            {"AES-256-CBC", "SHA256", CompressContext::LZ4v2},
+        };
+        const size_t sizes[] = {64, 128, 256, 512, 1024, 1400};
+
+        Frame::Ptr frame = frame_init(true, 0, 1250, false);
+        MTRand rand;
+
+        std::cout << "backend,cipher,comp,mssfix,size,op,packets,pkts_per_sec,bytes_per_sec,ns_per_pkt,cycles_per_pkt" << std::endl;
+        for (const auto &c : cases)
+        {
+            Session session(c, frame);
+            session.handshake();
+
+            for (const bool mss_fix : {false, true})
+            {
+                session.set_mss_fix(mss_fix ? 1200 : 0);
+                for (const size_t size : sizes)
+                {
+                    const BufferAllocated payload = make_packet(size, rand);
+                    std::vector<BufferAllocated> bufs(batch);
+                    Result enc, dec;
+
+                    // warm up, then run batches until the time budget is spent
+                    session.run(payload, bufs, enc, dec);
+                    enc = dec = Result();
+                    while (enc.seconds + dec.seconds < seconds)
+                        session.run(payload, bufs, enc, dec);
+
+                    report(c, mss_fix, size, "encrypt", enc);
+                    report(c, mss_fix, size, "decrypt", dec);
+                }
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "bench_dc: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
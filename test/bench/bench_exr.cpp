@@ -0,0 +1,104 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Exclude route emulation benchmark.
+//
+// Emulates split-tunnel configs with redirect-gateway, a number of include
+// routes and an increasing number of exclude routes, as used on platforms
+// without native exclude routes.  Prints CSV to stdout:
+//
+//   family,include,exclude,installed,ms
+//
+// usage: bench_exr [max_exclude_routes]
+
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+
+#include <openvpn/log/logsimple.hpp>
+#include <openvpn/client/cliemuexr.hpp>
+#include <openvpn/random/mtrandapi.hpp>
+
+using namespace openvpn;
+
+namespace {
+// counts installed routes
+struct TunBuilderCount : public TunBuilderBase
+{
+    bool tun_builder_add_route(const std::string &address,
+                               int prefix_length,
+                               int metric,
+                               bool ipv6) override
+    {
+        ++routes;
+        return true;
+    }
+
+    size_t routes = 0;
+};
+
+void add_random_routes(EmulateExcludeRoute &emu,
+                       RandomAPI &prng,
+                       const bool add,
+                       const IP::Addr::Version ver,
+                       const size_t n,
+                       const unsigned int min_len,
+                       const unsigned int max_len)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char bytes[16];
+        prng.rand_bytes(bytes, sizeof(bytes));
+        const IP::Addr addr = ver == IP::Addr::V4
+                                  ? IP::Addr::from_ipv4(IPv4::Addr::from_bytes(bytes))
+                                  : IP::Addr::from_ipv6(IPv6::Addr::from_byte_string(bytes));
+        const unsigned int prefix_len = min_len + prng.randrange32(max_len - min_len + 1);
+        emu.add_route(add, addr & IP::Addr::netmask_from_prefix_len(ver, prefix_len), prefix_len);
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const size_t max_exclude = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const EmulateExcludeRouteFactory::Ptr factory(new EmulateExcludeRouteFactoryImpl(true));
+    const OptionList rg = OptionList::parse_from_csv_static("redirect-gateway def1 ipv6", nullptr);
+
+    std::cout << "family,include,exclude,installed,ms" << std::endl;
+    for (const auto ver : {IP::Addr::V4, IP::Addr::V6})
+    {
+        const bool v6 = ver == IP::Addr::V6;
+        for (size_t n_exclude = 10; n_exclude <= max_exclude; n_exclude *= 10)
+        {
+            for (const size_t n : {n_exclude, n_exclude * 2, n_exclude * 5})
+            {
+                if (n > max_exclude)
+                    break;
+
+                MTRand prng(n);
+                const EmulateExcludeRoute::Ptr emu = factory->new_obj();
+                emu->add_default_routes(!v6, v6);
+                add_random_routes(*emu, prng, true, ver, n / 10, 8, v6 ? 64 : 24);
+                add_random_routes(*emu, prng, false, ver, n, 8, v6 ? 128 : 32);
+
+                IPVerFlags ipv(rg, v6 ? IP::Addr::V6_MASK : IP::Addr::V4_MASK);
+                TunBuilderCount tb;
+                const auto t0 = std::chrono::steady_clock::now();
+                emu->emulate(&tb, ipv, v6 ? IP::Addr("2001:db8::1") : IP::Addr("192.0.2.1"));
+                const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+                std::cout << (v6 ? "ipv6" : "ipv4") << ',' << n / 10 << ',' << n << ','
+                          << tb.routes << ',' << ms << std::endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+// Data channel replay window microbenchmark.
+//
+// Times PacketIDDataReceiveType's word bitmap against the old byte-wise
+// window over generated packet ID streams, and prints CSV to stdout:
+//
+//   order,stream,words_ns_per_pkt,bytewise_ns_per_pkt
+//
+// usage: bench_pktid_data [packets_per_case]
+
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <openvpn/log/logsimple.hpp>
+#include <openvpn/crypto/packet_id_data.hpp>
+
+#include "../unittests/pktid_data_ref.hpp"
+
+using namespace openvpn;
+
+namespace {
+template <typename PIDRecv>
+double run(PIDRecv &pr, const std::vector<PacketIDData::data_id_t> &ids, size_t &accepted)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ids.size(); ++i)
+        accepted += pr.do_test_add(PacketIDDataConstruct(ids[i], true), 0) == Error::SUCCESS;
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / double(ids.size());
+}
+
+// returns false if the two windows disagree
+template <unsigned int ORDER>
+bool bench(const size_t n, const char *label, const std::uint32_t max_delay, const std::uint32_t jump)
+{
+    const std::vector<PacketIDData::data_id_t> ids = reordered_ids(n, max_delay, jump);
+
+    PacketIDDataReceiveType<ORDER, 5> pr;
+    pr.init("bench", 0, true, SessionStats::Ptr(new SessionStats()));
+    auto ref = std::make_unique<PacketIDDataReceiveBytewise<ORDER, 5>>();
+
+    size_t acc_words = 0, acc_bytes = 0;
+    const double words = run(pr, ids, acc_words);
+    const double bytes = run(*ref, ids, acc_bytes);
+    std::cout << ORDER << ',' << label << ',' << words << ',' << bytes << std::endl;
+    if (acc_words != acc_bytes)
+    {
+        std::cerr << "order=" << ORDER << ' ' << label << ": accepted " << acc_words
+                  << " packets, bytewise accepted " << acc_bytes << std::endl;
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+
+    std::cout << "order,stream,words_ns_per_pkt,bytewise_ns_per_pkt" << std::endl;
+    bool ok = bench<8>(n, "in-order", 0, 0);
+    ok &= bench<8>(n, "reordered", 64, 0);
+    ok &= bench<8>(n, "reordered+jumps", 64, 1500);
+    ok &= bench<12>(n, "reordered+jumps", 1024, 30000);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <openvpn/crypto/packet_id_data.hpp>
+#include <openvpn/random/mtrandapi.hpp>
+
+namespace openvpn {
+
+struct PacketIDDataConstruct : public PacketIDData
+{
+    explicit PacketIDDataConstruct(const PacketIDData::data_id_t v_id = PacketIDData::data_id_t{0}, bool wide = false)
+        : PacketIDData(wide)
+    {
+        id = v_id;
+    }
+};
+
+// The byte-wise replay window that PacketIDDataReceiveType used before
+// it switched to a word bitmap, kept as a reference for
+// test_pktid_data and bench_pktid_data.
+template <unsigned int REPLAY_WINDOW_ORDER,
+          unsigned int PKTID_RECV_EXPIRE>
+class PacketIDDataReceiveBytewise
+{
+  public:
+    static constexpr unsigned int REPLAY_WINDOW_BYTES = 1u << REPLAY_WINDOW_ORDER;
+    static constexpr unsigned int REPLAY_WINDOW_SIZE = REPLAY_WINDOW_BYTES * 8;
+
+    Error::Type do_test_add(const PacketIDData &pin, const Time::base_type now)
+    {
+        if (now >= expire)
+            id_floor = id_high;
+        expire = now + PKTID_RECV_EXPIRE;
+
+        if (!pin.is_valid())
+            return Error::PKTID_INVALID;
+
+        if (pin.id == id_high + 1)
+        {
+            base = replay_index(-1);
+            history[base / 8] |= static_cast<uint8_t>(1 << (base % 8));
+            if (extent < REPLAY_WINDOW_SIZE)
+                ++extent;
+            id_high = pin.id;
+        }
+        else if (pin.id > id_high)
+        {
+            const auto delta = pin.id - id_high;
+            if (delta < REPLAY_WINDOW_SIZE)
+            {
+                base = replay_index(-delta);
+                history[base / 8] |= static_cast<uint8_t>(1u << (base % 8));
+                extent += static_cast<std::size_t>(delta);
+                if (extent > REPLAY_WINDOW_SIZE)
+                    extent = REPLAY_WINDOW_SIZE;
+                for (unsigned i = 1; i < delta; ++i)
+                {
+                    const auto newbase = replay_index(i);
+                    history[newbase / 8] &= static_cast<uint8_t>(~(1u << (newbase % 8)));
+                }
+            }
+            else
+            {
+                base = 0;
+                extent = REPLAY_WINDOW_SIZE;
+                std::memset(history, 0, sizeof(history));
+                history[0] = 1;
+            }
+            id_high = pin.id;
+        }
+        else
+        {
+            const auto delta = id_high - pin.id;
+            if (delta < extent)
+            {
+                if (pin.id > id_floor)
+                {
+                    const auto ri = replay_index(delta);
+                    std::uint8_t *p = &history[ri / 8];
+                    const std::uint8_t mask = static_cast<uint8_t>(1u << (ri % 8));
+                    if (*p & mask)
+                        return Error::PKTID_REPLAY;
+                    *p |= mask;
+                }
+                else
+                    return Error::PKTID_EXPIRE;
+            }
+            else
+                return Error::PKTID_BACKTRACK;
+        }
+        return Error::SUCCESS;
+    }
+
+  private:
+    std::size_t replay_index(PacketIDData::data_id_t i) const
+    {
+        return (base + i) & (REPLAY_WINDOW_SIZE - 1);
+    }
+
+    std::size_t base = 0;
+    std::size_t extent = 0;
+    Time::base_type expire = 0;
+    PacketIDData::data_id_t id_high = 0;
+    PacketIDData::data_id_t id_floor = 0;
+    std::uint8_t history[REPLAY_WINDOW_BYTES] = {};
+};
+
+// Generate a reordered packet ID stream: mostly sequential, with
+// packets delayed by up to max_delay, occasional duplicates and
+// rare jumps forward
+inline std::vector<PacketIDData::data_id_t> reordered_ids(const size_t n, const std::uint32_t max_delay, const std::uint32_t jump)
+{
+    MTRand urand;
+    std::vector<PacketIDData::data_id_t> ids;
+    ids.reserve(n);
+    PacketIDData::data_id_t next = 1;
+    while (ids.size() < n)
+    {
+        const std::uint32_t r = urand.randrange32(1000);
+        if (r < 5 && !ids.empty())
+            ids.push_back(ids[urand.randrange32(static_cast<std::uint32_t>(ids.size()))]); // duplicate
+        else if (r < 6 && jump)
+            next += urand.randrange32(jump); // jump forward
+        else
+        {
+            const PacketIDData::data_id_t delay = urand.randrange32(max_delay + 1);
+            ids.push_back(next > delay ? next - delay : next);
+            ++next;
+        }
+    }
+    return ids;
+}
+
+} // namespace openvpn
@@ -343,3 +343,58 @@ TEST(buffer, alloc_buffer_read1)
 
     EXPECT_EQ(memcmp(raw, data, sizeof(raw)), 0);
 }
+
+// Test that BufAllocFlags::POOL recycles storage on the same thread
+TEST(buffer, alloc_buffer_pool)
+{
+    const size_t cap = 1234;
+    BufferPool<unsigned char>::drain();
+
+    const unsigned char *data;
+    {
+        BufferAllocated buf(cap, BufAllocFlags::POOL);
+        data = buf.c_data_raw();
+        buf_append_string(buf, "hello");
+    }
+    EXPECT_EQ(BufferPool<unsigned char>::cached(cap), 1u);
+
+    // same capacity reuses the block, a different one doesn't
+    BufferAllocated other(cap + 1, BufAllocFlags::POOL);
+    EXPECT_NE(other.c_data_raw(), data);
+    BufferAllocated buf(cap, BufAllocFlags::POOL | BufAllocFlags::CONSTRUCT_ZERO);
+    EXPECT_EQ(buf.c_data_raw(), data);
+    EXPECT_EQ(buf.c_data_raw()[0], 0);
+    EXPECT_EQ(BufferPool<unsigned char>::cached(cap), 0u);
+
+    // moving keeps ownership with the pool flag
+    BufferAllocated moved(std::move(buf));
+    moved.clear();
+    EXPECT_EQ(BufferPool<unsigned char>::cached(cap), 1u);
+
+    // unpooled buffers don't go back to the pool
+    {
+        BufferAllocated plain(cap, 0);
+    }
+    EXPECT_EQ(BufferPool<unsigned char>::cached(cap), 1u);
+
+    BufferPool<unsigned char>::drain();
+    EXPECT_EQ(BufferPool<unsigned char>::cached(cap), 0u);
+}
+
+// Test that the pool is bounded
+TEST(buffer, alloc_buffer_pool_limit)
+{
+    typedef BufferPool<unsigned char> Pool;
+    Pool::drain();
+    {
+        std::vector<BufferAllocated> bufs;
+        for (size_t i = 0; i < Pool::MAX_FREE + 10; ++i)
+            bufs.emplace_back(100, BufAllocFlags::POOL);
+        for (size_t i = 0; i < Pool::MAX_CLASSES + 2; ++i)
+            bufs.emplace_back(200 + i, BufAllocFlags::POOL);
+    }
+    EXPECT_EQ(Pool::cached(100), size_t(Pool::MAX_FREE));
+    EXPECT_EQ(Pool::cached(200), 1u);
+    EXPECT_EQ(Pool::cached(200 + Pool::MAX_CLASSES), 0u);
+    Pool::drain();
+}
@@ -40,6 +40,8 @@
 #include <openvpn/buffer/buffer.hpp>
 #include <openvpn/compress/compress.hpp>
 #include <openvpn/compress/lzoasym.hpp>
+#include <openvpn/compress/adaptive.hpp>
+#include <openvpn/random/mtrandapi.hpp>
 #include <openvpn/frame/frame.hpp>
 
 using namespace openvpn;
@@ -257,5 +259,105 @@ TEST(Compression, lz4)
 {
     runTest(comppair::lz4);
 }
+
+TEST(Compression, lz4_adaptive)
+{
+    MySessionStats::Ptr stats(new MySessionStats);
+    Frame::Ptr frame = frame_init(BLOCK_SIZE);
+    CompressLZ4v2 comp(frame, stats, false, true);
+    MTRand rng;
+
+    // returns true if the packet went out compressed, and checks the round trip
+    auto xmit = [&](const bool random)
+    {
+        BufferAllocated data;
+        frame->prepare(Frame::DECRYPT_WORK, data);
+        for (size_t i = 0; i < 1024; ++i)
+            data.push_back(random ? rng.randbyte() : static_cast<unsigned char>("abcdefgh"[i % 8]));
+        BufferAllocated pkt(data);
+        comp.compress(pkt, true);
+        const bool compressed = pkt.size() < data.size();
+        comp.decompress(pkt);
+        EXPECT_EQ(data, pkt);
+        return compressed;
+    };
+
+    // incompressible traffic turns compression off after a few packets
+    for (int i = 0; i < CompressAdaptive::FAIL_THRESHOLD; ++i)
+        EXPECT_FALSE(xmit(true));
+
+    // compressible packets are sent uncompressed during the bypass period,
+    // then the probe finds them compressible again
+    int bypassed = 0;
+    while (!xmit(false))
+        ++bypassed;
+    EXPECT_EQ(bypassed, CompressAdaptive::MIN_SKIP);
+    EXPECT_TRUE(xmit(false));
+    EXPECT_EQ(stats->get_error_count(Error::COMPRESS_ERROR), 0u);
+}
+
+TEST(Compression, lz4_adaptive_off_by_default)
+{
+    MySessionStats::Ptr stats(new MySessionStats);
+    Frame::Ptr frame = frame_init(BLOCK_SIZE);
+    MTRand rng;
+    for (const bool adaptive : {false, true})
+    {
+        Compress::Ptr comp = CompressContext(CompressContext::LZ4v2, false, adaptive).new_compressor(frame, stats);
+        for (int i = 0; i < CompressAdaptive::FAIL_THRESHOLD; ++i)
+        {
+            BufferAllocated pkt;
+            frame->prepare(Frame::DECRYPT_WORK, pkt);
+            for (size_t j = 0; j < 1024; ++j)
+                pkt.push_back(rng.randbyte());
+            comp->compress(pkt, true);
+        }
+
+        // a compressible packet is only skipped in adaptive mode
+        BufferAllocated pkt;
+        frame->prepare(Frame::DECRYPT_WORK, pkt);
+        for (size_t j = 0; j < 1024; ++j)
+            pkt.push_back('a');
+        comp->compress(pkt, true);
+        EXPECT_EQ(pkt.size() < 1024, !adaptive) << adaptive;
+    }
+}
 #endif
+
+TEST(Compression, adaptive_backoff)
+{
+    CompressAdaptive ad;
+    for (int i = 0; i < CompressAdaptive::FAIL_THRESHOLD; ++i)
+    {
+        ASSERT_TRUE(ad.attempt());
+        ad.result(1000, 1000);
+    }
+
+    // each failed probe doubles the bypass period
+    size_t expect_skip = CompressAdaptive::MIN_SKIP;
+    for (int round = 0; round < 10; ++round)
+    {
+        ASSERT_TRUE(ad.bypassing());
+        size_t skipped = 0;
+        while (!ad.attempt())
+            ++skipped;
+        EXPECT_EQ(skipped, expect_skip);
+        expect_skip = std::min(expect_skip * 2, size_t(CompressAdaptive::MAX_SKIP));
+        ad.result(1000, 990); // marginal gain counts as failure
+    }
+
+    // a successful probe resets the state
+    while (!ad.attempt())
+        ;
+    ad.result(1000, 500);
+    for (int i = 0; i < CompressAdaptive::FAIL_THRESHOLD - 1; ++i)
+    {
+        ASSERT_TRUE(ad.attempt());
+        ad.result(1000, 1000);
+    }
+    EXPECT_FALSE(ad.bypassing());
+    ASSERT_TRUE(ad.attempt());
+    ad.result(1000, 1000);
+    EXPECT_TRUE(ad.bypassing());
+}
 } // namespace unittests
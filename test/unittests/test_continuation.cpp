@@ -21,6 +21,7 @@
 
 #include <openvpn/options/continuation_fragment.hpp>
 #include <openvpn/options/continuation.hpp>
+#include <openvpn/options/sanitize.hpp>
 
 using namespace openvpn;
 
@@ -300,3 +301,109 @@ TEST(continuation, push_update_add_multiple)
 
     ASSERT_EQ(cc.size(), 10);
 }
+
+TEST(continuation, move_add_index)
+{
+    OptionListContinuation cc;
+
+    cc.add(OptionList::parse_from_csv_static("route 0,ifconfig 10.0.0.2 255.255.255.0,push-continuation 2", nullptr), nullptr);
+    ASSERT_FALSE(cc.complete());
+
+    cc.add(OptionList::parse_from_csv_static("route 1,route 2,push-continuation 1", nullptr), nullptr);
+    ASSERT_TRUE(cc.complete());
+
+    // options from every fragment must be indexed exactly once
+    ASSERT_EQ(cc.size(), 6);
+    ASSERT_EQ(cc.get_index_ptr("route")->size(), 3);
+    ASSERT_EQ(cc.get_index_ptr("push-continuation")->size(), 2);
+    ASSERT_EQ(cc.get("ifconfig", 1, 16), "10.0.0.2");
+}
+
+namespace {
+// rejects options named "reject-me", like a pull-filter reject
+struct RejectFilter : public OptionList::FilterBase
+{
+    bool filter(const Option &opt) override
+    {
+        if (opt.get_optional(0, 0) == "reject-me")
+            throw Option::RejectedException(opt.escape(false));
+        return true;
+    }
+};
+
+// Adds the PUSH_REPLY fragments in msgs to cc, and renders the options
+// of each fragment as it arrives, as ClientProto::Session::recv_push_reply()
+// does.  Returns the log of the rendered options.
+std::string render_push_reply(OptionListContinuation &cc,
+                              OptionList::FilterBase *filt,
+                              const std::vector<std::string> &msgs,
+                              bool &rejected)
+{
+    const unsigned int flags = Option::RENDER_PASS_FMT | Option::RENDER_NUMBER | Option::RENDER_BRACKET;
+    std::string log;
+    size_t logged = 0;
+    rejected = false;
+    for (const auto &msg : msgs)
+    {
+        try
+        {
+            cc.add(OptionList::parse_from_csv_static(msg.substr(11), nullptr), filt);
+            log += render_options_sanitized(cc, flags, logged);
+            logged = cc.size();
+        }
+        catch (const Option::RejectedException &)
+        {
+            log.clear();
+            logged = 0;
+            rejected = true;
+        }
+    }
+    return log;
+}
+} // namespace
+
+TEST(continuation, render_fragments)
+{
+    const unsigned int flags = Option::RENDER_PASS_FMT | Option::RENDER_NUMBER | Option::RENDER_BRACKET;
+    PushOptionsBase::Ptr push_base(new PushOptionsBase());
+    push_base->multi = OptionList::parse_from_csv_static("route 192.168.0.0 255.255.0.0", nullptr);
+    push_base->singleton = OptionList::parse_from_csv_static("ping 10,ping-restart 60", nullptr);
+    RejectFilter filt;
+    bool rejected;
+
+    // rendering each fragment gives the same log as rendering the
+    // completed list, including the multi options from push_base at the
+    // start and the singletons appended by the last fragment
+    {
+        OptionListContinuation cc(push_base);
+        const std::string log = render_push_reply(cc,
+                                                  &filt,
+                                                  {"PUSH_REPLY,route-gateway 10.0.0.1,ifconfig 10.0.0.2 255.255.255.0,auth-token SECRET,push-continuation 2",
+                                                   "PUSH_REPLY,route 10.1.0.0 255.255.0.0,push-continuation 2",
+                                                   "PUSH_REPLY,ping 1,push-continuation 1"},
+                                                  rejected);
+        ASSERT_FALSE(rejected);
+        ASSERT_TRUE(cc.complete());
+        ASSERT_EQ(log, render_options_sanitized(cc, flags));
+        ASSERT_NE(log.find("0 [route] [192.168.0.0] [255.255.0.0]"), std::string::npos);
+        ASSERT_NE(log.find("[ping-restart] [60]"), std::string::npos);
+        ASSERT_EQ(log.find("[ping] [10]"), std::string::npos);
+        ASSERT_EQ(log.find("SECRET"), std::string::npos);
+    }
+
+    // after a rejected fragment, the list is back to the push_base multi
+    // options, and the log starts over from the first option
+    {
+        OptionListContinuation cc(push_base);
+        const std::string log = render_push_reply(cc,
+                                                  &filt,
+                                                  {"PUSH_REPLY,route-gateway 10.0.0.1,ifconfig 10.0.0.2 255.255.255.0,push-continuation 2",
+                                                   "PUSH_REPLY,route 10.1.0.0 255.255.0.0,reject-me,push-continuation 2",
+                                                   "PUSH_REPLY,route-gateway 10.0.0.1,push-continuation 1"},
+                                                  rejected);
+        ASSERT_TRUE(rejected);
+        ASSERT_TRUE(cc.complete());
+        ASSERT_EQ(log, render_options_sanitized(cc, flags));
+        ASSERT_EQ(log.find("ifconfig"), std::string::npos);
+    }
+}
@@ -86,21 +86,9 @@ static openvpn::Frame::Context frame_ctx()
 }
 
 
-void test_datachannel_crypto(bool tag_at_the_end, bool longpktcounter = false)
+/* initialise cryptodc with identical encrypt and decrypt keys */
+static void init_loopback_crypto(openvpn::CryptoDCInstance &cryptodc, const openvpn::SessionStats::Ptr &statsptr)
 {
-
-    auto frameptr = openvpn::Frame::Ptr{new openvpn::Frame{frame_ctx()}};
-    auto statsptr = openvpn::SessionStats::Ptr{new openvpn::SessionStats{}};
-
-    openvpn::CryptoDCSettingsData dc;
-    dc.set_cipher(openvpn::CryptoAlgs::AES_256_GCM);
-    dc.set_aead_tag_end(tag_at_the_end);
-    dc.set_64_bit_packet_id(longpktcounter);
-
-    openvpn::AEAD::Crypto<openvpn::SSLLib::CryptoAPI> cryptodc{nullptr, dc, frameptr, statsptr};
-
-    const char *plaintext = "The quick little fox jumps over the bureaucratic hurdles";
-
     const uint8_t key[] = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', '0', '1', '2', '3', '4', '5', '6', '7', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'j', 'k', 'u', 'c', 'h', 'e', 'n', 'l'};
 
     static_assert(sizeof(key) == 32, "Size of key should be 32 bytes");
@@ -129,6 +117,23 @@ void test_datachannel_crypto(bool tag_at_the_end, bool longpktcounter = false)
     cryptodc.init_pid("DATA",
                       0,
                       statsptr);
+}
+
+void test_datachannel_crypto(bool tag_at_the_end, bool longpktcounter = false)
+{
+
+    auto frameptr = openvpn::Frame::Ptr{new openvpn::Frame{frame_ctx()}};
+    auto statsptr = openvpn::SessionStats::Ptr{new openvpn::SessionStats{}};
+
+    openvpn::CryptoDCSettingsData dc;
+    dc.set_cipher(openvpn::CryptoAlgs::AES_256_GCM);
+    dc.set_aead_tag_end(tag_at_the_end);
+    dc.set_64_bit_packet_id(longpktcounter);
+
+    openvpn::AEAD::Crypto<openvpn::SSLLib::CryptoAPI> cryptodc{nullptr, dc, frameptr, statsptr};
+    init_loopback_crypto(cryptodc, statsptr);
+
+    const char *plaintext = "The quick little fox jumps over the bureaucratic hurdles";
 
     openvpn::BufferAllocated work{2048, 0};
 
@@ -228,3 +233,119 @@ TEST(crypto, dcaead_tag_at_the_end_long_pktcntr)
 {
     test_datachannel_crypto(true, true);
 }
+
+void test_datachannel_crypto_batch(openvpn::CryptoAlgs::Type cipher, bool tag_at_the_end = false)
+{
+    auto frameptr = openvpn::Frame::Ptr{new openvpn::Frame{frame_ctx()}};
+    auto statsptr = openvpn::SessionStats::Ptr{new openvpn::SessionStats{}};
+
+    openvpn::CryptoDCSettingsData dc;
+    dc.set_cipher(cipher);
+    dc.set_aead_tag_end(tag_at_the_end);
+
+    /* two instances with the same keys, one used per packet and one batched */
+    openvpn::AEAD::Crypto<openvpn::SSLLib::CryptoAPI> single{nullptr, dc, frameptr, statsptr};
+    openvpn::AEAD::Crypto<openvpn::SSLLib::CryptoAPI> batched{nullptr, dc, frameptr, statsptr};
+    init_loopback_crypto(single, statsptr);
+    init_loopback_crypto(batched, statsptr);
+
+    const unsigned char op32[]{7, 0, 0, 23};
+    const std::time_t now = 42;
+    /* more than one chunk of AEAD::Crypto */
+    constexpr size_t n = 100;
+
+    openvpn::BufferAllocated expected[n];
+    openvpn::BufferAllocated bufs[n];
+    for (size_t i = 0; i < n; ++i)
+    {
+        /* vary the packet size, including an empty packet */
+        const size_t len = (i * 97) % 1500;
+        for (auto *b : {&expected[i], &bufs[i]})
+        {
+            b->reset(128, 2048, 0);
+            for (size_t j = 0; j < len; ++j)
+                b->push_back(static_cast<uint8_t>(i + j));
+        }
+        ASSERT_FALSE(single.encrypt(expected[i], op32));
+    }
+
+    ASSERT_FALSE(batched.encrypt_batch(bufs, n, op32));
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        ASSERT_EQ(bufs[i].size(), expected[i].size());
+        EXPECT_EQ(std::memcmp(bufs[i].c_data(), expected[i].c_data(), bufs[i].size()), 0);
+    }
+
+    openvpn::Error::Type results[n];
+    batched.decrypt_batch(bufs, results, n, now, op32);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const size_t len = (i * 97) % 1500;
+        EXPECT_EQ(results[i], openvpn::Error::SUCCESS);
+        ASSERT_EQ(bufs[i].size(), len);
+        for (size_t j = 0; j < len; ++j)
+            ASSERT_EQ(bufs[i][j], static_cast<uint8_t>(i + j));
+    }
+
+    /* replaying the batch must be rejected */
+    batched.decrypt_batch(expected, results, n, now, op32);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if ((i * 97) % 1500)
+            EXPECT_EQ(results[i], openvpn::Error::REPLAY_ERROR);
+    }
+}
+
+TEST(crypto, dcaead_batch_aes_gcm)
+{
+    test_datachannel_crypto_batch(openvpn::CryptoAlgs::AES_256_GCM);
+}
+
+TEST(crypto, dcaead_batch_tag_at_the_end)
+{
+    test_datachannel_crypto_batch(openvpn::CryptoAlgs::AES_256_GCM, true);
+}
+
+TEST(crypto, dcaead_batch_bad_packets)
+{
+    auto frameptr = openvpn::Frame::Ptr{new openvpn::Frame{frame_ctx()}};
+    auto statsptr = openvpn::SessionStats::Ptr{new openvpn::SessionStats{}};
+
+    openvpn::CryptoDCSettingsData dc;
+    dc.set_cipher(openvpn::CryptoAlgs::AES_256_GCM);
+    openvpn::AEAD::Crypto<openvpn::SSLLib::CryptoAPI> cryptodc{nullptr, dc, frameptr, statsptr};
+    init_loopback_crypto(cryptodc, statsptr);
+
+    constexpr size_t n = 4;
+    openvpn::BufferAllocated bufs[n];
+    for (auto &b : bufs)
+    {
+        b.reset(128, 2048, 0);
+        for (size_t j = 0; j < 100; ++j)
+            b.push_back(static_cast<uint8_t>(j));
+    }
+    ASSERT_FALSE(cryptodc.encrypt_batch(bufs, n, nullptr));
+
+    /* a flipped ciphertext bit, and a packet cut short inside the auth tag */
+    bufs[1][30] ^= 1;
+    bufs[2].set_size(10);
+
+    /* bad packets don't stop the good ones from decrypting */
+    openvpn::Error::Type results[n];
+    cryptodc.decrypt_batch(bufs, results, n, 42, nullptr);
+    EXPECT_EQ(results[0], openvpn::Error::SUCCESS);
+    EXPECT_EQ(results[1], openvpn::Error::DECRYPT_ERROR);
+    EXPECT_EQ(results[2], openvpn::Error::BUFFER_ERROR);
+    EXPECT_EQ(results[3], openvpn::Error::SUCCESS);
+    EXPECT_EQ(bufs[0].size(), 100u);
+    EXPECT_EQ(bufs[1].size(), 0u);
+    EXPECT_EQ(bufs[2].size(), 0u);
+    EXPECT_EQ(bufs[3].size(), 100u);
+}
+
+TEST(crypto, dcaead_batch_chacha20_poly1305)
+{
+    test_datachannel_crypto_batch(openvpn::CryptoAlgs::CHACHA20_POLY1305);
+}
@@ -65,3 +65,71 @@ TEST(misc, stress_csum)
             << std::endl;
     }
 }
+
+static const IPChecksum::Kernel csum_kernels[] = {
+    IPChecksum::Kernel::SCALAR,
+    IPChecksum::Kernel::SSE2,
+    IPChecksum::Kernel::AVX2,
+    IPChecksum::Kernel::NEON,
+};
+
+// every kernel must produce exactly the scalar result for all lengths
+// and alignments, including inputs that maximize carries
+TEST(misc, csum_kernels)
+{
+    MTRand prng;
+    std::vector<std::uint8_t> data(4096 + 64);
+
+    for (const auto kernel : csum_kernels)
+    {
+        if (!IPChecksum::kernel_available(kernel))
+            continue;
+        for (int fill = 0; fill < 3; ++fill)
+        {
+            if (fill == 0)
+                prng.rand_bytes(data.data(), data.size());
+            else
+                std::memset(data.data(), fill == 1 ? 0xFF : 0x00, data.size());
+
+            for (size_t align = 0; align < 32; ++align)
+            {
+                for (size_t len = 0; len <= 1600; ++len)
+                {
+                    const std::uint8_t *p = data.data() + align;
+                    ASSERT_EQ(IPChecksum::compute(p, len, kernel), IPChecksum::compute_scalar(p, len))
+                        << IPChecksum::kernel_name(kernel) << " align=" << align << " len=" << len << " fill=" << fill;
+                }
+            }
+            for (size_t len = 1600; len <= 4096; len += 61)
+            {
+                ASSERT_EQ(IPChecksum::compute(data.data() + 1, len, kernel), IPChecksum::compute_scalar(data.data() + 1, len))
+                    << IPChecksum::kernel_name(kernel) << " len=" << len;
+            }
+        }
+    }
+}
+
+TEST(misc, csum_incremental)
+{
+    MTRand prng;
+    for (int i = 0; i < 100000; ++i)
+    {
+        std::uint8_t pkt[64];
+        prng.rand_bytes(pkt, sizeof(pkt));
+        const std::uint16_t csum = IPChecksum::checksum(pkt, sizeof(pkt));
+
+        std::uint32_t old32, new32;
+        std::memcpy(&old32, pkt + 8, 4);
+        new32 = prng.rand_get<std::uint32_t>();
+        std::memcpy(pkt + 8, &new32, 4);
+        const std::uint16_t csum4 = IPChecksum::cfold(IPChecksum::diff4(old32, new32, IPChecksum::cunfold(csum)));
+        ASSERT_EQ(csum4, IPChecksum::checksum(pkt, sizeof(pkt)));
+
+        std::uint16_t old16, new16;
+        std::memcpy(&old16, pkt + 20, 2);
+        new16 = prng.rand_get<std::uint16_t>();
+        std::memcpy(pkt + 20, &new16, 2);
+        const std::uint16_t csum2 = IPChecksum::cfold(IPChecksum::diff2(old16, new16, IPChecksum::cunfold(csum4)));
+        ASSERT_EQ(csum2, IPChecksum::checksum(pkt, sizeof(pkt)));
+    }
+}
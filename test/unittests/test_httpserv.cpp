@@ -0,0 +1,1065 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+#include "test_common.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <openssl/ssl.h>
+
+#include <openvpn/ssl/sslchoose.hpp>
+#include <openvpn/common/file.hpp>
+#include <openvpn/random/mtrandapi.hpp>
+#include <openvpn/ws/httpserv.hpp>
+#include <openvpn/ws/httpservshard.hpp>
+#include <openvpn/ws/httpcliset.hpp>
+
+using namespace openvpn;
+using namespace openvpn::WS::Server;
+
+namespace {
+
+// how the server sends its reply
+struct ReplyMode
+{
+    bool file = true;       // generate_reply_file(), or generate_reply_buffers()
+    bool chunked = false;   // Transfer-Encoding: chunked
+    bool async_out = false; // content requested with http_content_out_needed()
+    bool ssl = false;
+    int sndbuf = 0;        // shrink the server socket buffer to fill it up
+    int read_delay_ms = 0; // client waits before reading the reply
+};
+
+std::string random_content(const size_t size)
+{
+    MTRand prng(1);
+    std::string ret(size, '\0');
+    prng.rand_bytes(reinterpret_cast<unsigned char *>(&ret[0]), size);
+    return ret;
+}
+
+class ReplyClient : public Listener::Client
+{
+  public:
+    ReplyClient(Initializer &ci, const ReplyMode &mode_arg, const std::string &path_arg, const std::string &content_arg)
+        : Listener::Client(ci),
+          mode(mode_arg),
+          path(path_arg),
+          content(content_arg)
+    {
+        set_async_out(mode.async_out);
+    }
+
+  private:
+    void http_request_received() override
+    {
+        if (mode.sndbuf)
+            ::setsockopt(sock->native_handle(), SOL_SOCKET, SO_SNDBUF, &mode.sndbuf, sizeof(mode.sndbuf));
+
+        ContentInfo ci;
+        ci.http_status = HTTP::Status::OK;
+        ci.type = "application/octet-stream";
+        ci.keepalive = keepalive_request();
+        ci.length = mode.chunked ? ContentInfo::CHUNKED : content_len_t(content.size());
+        if (mode.file)
+        {
+            // skip the first byte, to test the offset
+            ScopedFD fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+            ASSERT_TRUE(fd.defined());
+            generate_reply_file(std::move(ci), std::move(fd), 1, content.size() - 1);
+        }
+        else
+        {
+            // uneven pieces, including an empty one
+            BufferList buffers;
+            for (size_t i = 0, n = 0; i < content.size(); i += n, n = n * 2 + 1)
+                buffers.push_back(BufferAllocatedRc::Create(reinterpret_cast<const unsigned char *>(content.data()) + i,
+                                                            std::min(n, content.size() - i),
+                                                            0));
+            generate_reply_buffers(std::move(ci), std::move(buffers));
+        }
+    }
+
+    const ReplyMode &mode;
+    const std::string &path;
+    const std::string &content;
+};
+
+class ReplyFactory : public Listener::Client::Factory
+{
+  public:
+    ReplyFactory(const ReplyMode &mode_arg, const std::string &path_arg, const std::string &content_arg)
+        : mode(mode_arg),
+          path(path_arg),
+          content(content_arg)
+    {
+    }
+
+    Listener::Client::Ptr new_client(Listener::Client::Initializer &ci) override
+    {
+        return new ReplyClient(ci, mode, path, content);
+    }
+
+  private:
+    const ReplyMode &mode;
+    const std::string &path;
+    const std::string &content;
+};
+
+// a port that was free a moment ago
+unsigned short free_port()
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(sa);
+    ::bind(fd, reinterpret_cast<sockaddr *>(&sa), len);
+    ::getsockname(fd, reinterpret_cast<sockaddr *>(&sa), &len);
+    ::close(fd);
+    return ntohs(sa.sin_port);
+}
+
+SSLFactoryAPI::Ptr server_ssl_factory()
+{
+    SSLLib::SSLAPI::Config::Ptr config(new SSLLib::SSLAPI::Config);
+    config->set_mode(Mode(Mode::SERVER));
+    config->set_frame(frame_init_simple(2048));
+    config->set_rng(new SSLLib::RandomAPI());
+    config->set_flags(SSLConst::NO_VERIFY_PEER);
+    config->load_cert(read_text(TEST_KEYCERT_DIR "server.crt"));
+    config->load_private_key(read_text(TEST_KEYCERT_DIR "server.key"));
+    config->load_dh(read_text(TEST_KEYCERT_DIR "dh.pem"));
+    return config->new_factory();
+}
+
+// Listener on 127.0.0.1 running in its own thread
+class TestServer
+{
+  public:
+    TestServer(const Listener::Client::Factory::Ptr &factory, const bool ssl)
+        : port(free_port())
+    {
+        config.reset(new Config());
+        config->frame = frame_init_simple(2048);
+        config->stats.reset(new SessionStats());
+        if (ssl)
+            config->ssl_factory = server_ssl_factory();
+
+        Listen::Item item;
+        item.directive = "http-listen";
+        item.addr = "127.0.0.1";
+        item.port = std::to_string(port);
+        item.proto = Protocol(Protocol::TCPv4);
+        listener.reset(new Listener(io_context, config, item, factory));
+        listener->start();
+        thread = std::thread([this]()
+                             { io_context.run(); });
+    }
+
+    ~TestServer()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (!thread.joinable())
+            return;
+        openvpn_io::post(io_context, [this]()
+                         { listener->stop(); });
+        thread.join();
+    }
+
+    openvpn_io::io_context io_context{1};
+    Config::Ptr config;
+    Listener::Ptr listener;
+    std::thread thread;
+    const unsigned short port;
+};
+
+// blocking HTTP(S) client connection
+class TestConn
+{
+  public:
+    TestConn(const unsigned short port, const bool ssl)
+    {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        timeval tv = {10, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        sockaddr_in sa = {};
+        sa.sin_family = AF_INET;
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        sa.sin_port = htons(port);
+        connected = ::connect(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa)) == 0;
+        if (connected && ssl)
+        {
+            ctx = SSL_CTX_new(TLS_client_method());
+            ssl_ = SSL_new(ctx);
+            SSL_set_fd(ssl_, fd);
+            connected = SSL_connect(ssl_) == 1;
+        }
+    }
+
+    ~TestConn()
+    {
+        if (ssl_)
+            SSL_free(ssl_);
+        if (ctx)
+            SSL_CTX_free(ctx);
+        ::close(fd);
+    }
+
+    bool send(const std::string &data)
+    {
+        if (ssl_)
+            return SSL_write(ssl_, data.data(), int(data.size())) == int(data.size());
+        return ::send(fd, data.data(), data.size(), 0) == ssize_t(data.size());
+    }
+
+    // read one reply, and return its decoded content
+    bool read_reply(std::string &content)
+    {
+        std::string headers;
+        size_t end;
+        while ((end = pending.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (!fill())
+                return false;
+        }
+        headers = pending.substr(0, end + 2);
+        pending.erase(0, end + 4);
+        if (headers.compare(0, 15, "HTTP/1.1 200 OK") != 0)
+            return false;
+
+        content.clear();
+        const size_t cl = headers.find("Content-Length: ");
+        if (cl != std::string::npos)
+            return read_exact(std::strtoul(headers.c_str() + cl + 16, nullptr, 10), content);
+        if (headers.find("Transfer-Encoding: chunked") == std::string::npos)
+            return false;
+        while (true)
+        {
+            while ((end = pending.find("\r\n")) == std::string::npos)
+            {
+                if (!fill())
+                    return false;
+            }
+            const size_t size = std::strtoul(pending.c_str(), nullptr, 16);
+            pending.erase(0, end + 2);
+            std::string chunk;
+            if (!read_exact(size + 2, chunk))
+                return false;
+            if (size == 0)
+                return true;
+            content.append(chunk, 0, size);
+        }
+    }
+
+    // wait for the server to close the connection
+    bool closed()
+    {
+        while (fill())
+            ;
+        return pending.empty();
+    }
+
+    bool connected = false;
+
+  private:
+    bool fill()
+    {
+        char buf[16384];
+        const int n = ssl_ ? SSL_read(ssl_, buf, sizeof(buf)) : int(::recv(fd, buf, sizeof(buf), 0));
+        if (n <= 0)
+            return false;
+        pending.append(buf, n);
+        return true;
+    }
+
+    bool read_exact(const size_t size, std::string &out)
+    {
+        while (pending.size() < size)
+        {
+            if (!fill())
+                return false;
+        }
+        out.append(pending, 0, size);
+        pending.erase(0, size);
+        return true;
+    }
+
+    int fd = -1;
+    SSL_CTX *ctx = nullptr;
+    SSL *ssl_ = nullptr;
+    std::string pending;
+};
+
+// Send two requests on a keepalive connection, and check that both
+// replies are complete, so that the connection stays in sync.
+// Returns the number of packets the server's link sent.
+count_t run_reply_test(const ReplyMode &mode, const size_t size = 32 * 1024 + 7)
+{
+    const std::string content = random_content(size);
+    char tmpl[] = "/tmp/test_httpserv_XXXXXX";
+    const int tmp = ::mkstemp(tmpl);
+    EXPECT_GE(tmp, 0);
+    ::close(tmp);
+    const std::string path(tmpl);
+    write_string(path, content);
+    const std::string expected = mode.file ? content.substr(1) : content;
+
+    count_t packets = 0;
+    {
+        TestServer server(new ReplyFactory(mode, path, content), mode.ssl);
+        {
+            TestConn conn(server.port, mode.ssl);
+            EXPECT_TRUE(conn.connected);
+            for (int i = 0; i < 2; ++i)
+            {
+                EXPECT_TRUE(conn.send("GET / HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"));
+                if (mode.read_delay_ms)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(mode.read_delay_ms));
+                std::string reply;
+                EXPECT_TRUE(conn.read_reply(reply)) << "request " << i;
+                EXPECT_EQ(reply.size(), expected.size()) << "request " << i;
+                EXPECT_TRUE(reply == expected) << "request " << i;
+            }
+        }
+        server.stop();
+        packets = server.config->stats->get_stat(SessionStats::PACKETS_OUT);
+    }
+    ::unlink(path.c_str());
+    return packets;
+}
+
+// Replies with the request URI as content, after a delay for "/slow"
+class EchoClient : public Listener::Client
+{
+  public:
+    EchoClient(Initializer &ci, std::atomic<int> &requests_arg, std::atomic<int> &clients_arg)
+        : Listener::Client(ci),
+          requests(requests_arg),
+          clients(clients_arg),
+          timer(io_context)
+    {
+        ++clients;
+    }
+
+    ~EchoClient()
+    {
+        --clients;
+    }
+
+  private:
+    void http_request_received() override
+    {
+        ++requests;
+        const std::string uri = request().uri;
+        if (uri == "/slow")
+        {
+            timer.expires_after(std::chrono::milliseconds(300));
+            timer.async_wait([self = RCPtr<EchoClient>(this), uri](const openvpn_io::error_code &error)
+                             {
+                if (!error)
+                    self->reply(uri); });
+        }
+        else
+            reply(uri);
+    }
+
+    void reply(const std::string &content)
+    {
+        ContentInfo ci;
+        ci.http_status = HTTP::Status::OK;
+        ci.type = "text/plain";
+        ci.keepalive = keepalive_request();
+        ci.length = content.size();
+        BufferList buffers;
+        buffers.push_back(BufferAllocatedRc::Create(reinterpret_cast<const unsigned char *>(content.data()), content.size(), 0));
+        generate_reply_buffers(std::move(ci), std::move(buffers));
+    }
+
+    std::atomic<int> &requests;
+    std::atomic<int> &clients;
+    openvpn_io::steady_timer timer;
+};
+
+class EchoFactory : public Listener::Client::Factory
+{
+  public:
+    typedef RCPtr<EchoFactory> Ptr;
+
+    Listener::Client::Ptr new_client(Listener::Client::Initializer &ci) override
+    {
+        return new EchoClient(ci, requests, clients);
+    }
+
+    std::atomic<int> requests{0};
+    std::atomic<int> clients{0}; // client objects alive
+};
+
+WS::Client::Config::Ptr client_config()
+{
+    WS::Client::Config::Ptr config(new WS::Client::Config());
+    config->frame = frame_init_simple(2048);
+    config->stats.reset(new SessionStats());
+    config->connect_timeout = 10;
+    config->general_timeout = 10;
+    return config;
+}
+
+// keepalive GET requests for uris
+WS::ClientSet::TransactionSet::Ptr new_transaction_set(const unsigned short port,
+                                                       const WS::Client::Config::Ptr &config,
+                                                       const std::vector<std::string> &uris)
+{
+    WS::ClientSet::TransactionSet::Ptr ts(new WS::ClientSet::TransactionSet());
+    ts->host.host = "127.0.0.1";
+    ts->host.port = std::to_string(port);
+    ts->http_config = config;
+    ts->debug_level = 0;
+    for (const auto &uri : uris)
+    {
+        std::unique_ptr<WS::ClientSet::Transaction> t(new WS::ClientSet::Transaction());
+        t->req.method = "GET";
+        t->req.uri = uri;
+        t->ci.keepalive = true;
+        ts->transactions.push_back(std::move(t));
+    }
+    return ts;
+}
+
+// true if every reply echoed its request URI
+bool echoed(const WS::ClientSet::TransactionSet &ts)
+{
+    if (!ts.http_status_success())
+        return false;
+    for (const auto &t : ts.transactions)
+    {
+        if (t->content_in_string() != t->req.uri)
+            return false;
+    }
+    return true;
+}
+
+// wait for a value that another thread updates
+template <typename F>
+bool eventually(F pred)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+// Accepts one connection, waits until n_requests requests have arrived
+// before replying to any of them, then sends all replies in small
+// pieces, so that the client reads split replies at random points.
+// Replies to each URI with the URI repeated 50 times.
+class PipelineServer
+{
+  public:
+    PipelineServer(const size_t n_requests)
+    {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        timeval tv = {5, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        sockaddr_in sa = {};
+        sa.sin_family = AF_INET;
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(sa);
+        ::bind(fd, reinterpret_cast<sockaddr *>(&sa), len);
+        ::getsockname(fd, reinterpret_cast<sockaddr *>(&sa), &len);
+        ::listen(fd, 1);
+        port = ntohs(sa.sin_port);
+        thread = std::thread([this, n_requests]()
+                             { run(n_requests); });
+    }
+
+    ~PipelineServer()
+    {
+        thread.join();
+        ::close(fd);
+    }
+
+    static std::string body(const std::string &uri)
+    {
+        std::string ret;
+        for (int i = 0; i < 50; ++i)
+            ret += uri;
+        return ret;
+    }
+
+    unsigned short port;
+    std::vector<std::string> uris; // valid after destruction of the client
+
+  private:
+    void run(const size_t n_requests)
+    {
+        const int conn = ::accept(fd, nullptr, nullptr);
+        if (conn < 0)
+            return;
+        timeval tv = {5, 0};
+        ::setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        const int one = 1;
+        ::setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::string in;
+        size_t end;
+        while (uris.size() < n_requests)
+        {
+            while ((end = in.find("\r\n\r\n")) != std::string::npos)
+            {
+                const size_t sp = in.find(' ');
+                uris.push_back(in.substr(sp + 1, in.find(' ', sp + 1) - sp - 1));
+                in.erase(0, end + 4);
+            }
+            if (uris.size() >= n_requests)
+                break;
+            char buf[4096];
+            const ssize_t n = ::recv(conn, buf, sizeof(buf), 0);
+            if (n <= 0)
+                break;
+            in.append(buf, n);
+        }
+
+        if (uris.size() == n_requests)
+        {
+            std::string out;
+            for (const auto &uri : uris)
+            {
+                const std::string content = body(uri);
+                out += "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(content.size())
+                       + "\r\nConnection: keep-alive\r\n\r\n" + content;
+            }
+            for (size_t i = 0; i < out.size(); i += 7)
+            {
+                ::send(conn, out.data() + i, std::min(size_t(7), out.size() - i), MSG_NOSIGNAL);
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        }
+
+        // wait for the client to close
+        char buf[256];
+        while (::recv(conn, buf, sizeof(buf), 0) > 0)
+            ;
+        ::close(conn);
+    }
+
+    int fd;
+    std::thread thread;
+};
+
+// each shard counts into its own SessionStats
+class ReplyShardFactory : public ShardedListener::ShardFactory
+{
+  public:
+    ReplyShardFactory(const ReplyMode &mode_arg, const std::string &content_arg)
+        : mode(mode_arg),
+          content(content_arg)
+    {
+    }
+
+    Config::Ptr new_config(const unsigned int shard) override
+    {
+        Config::Ptr config(new Config());
+        config->frame = frame_init_simple(2048);
+        config->stats.reset(new SessionStats());
+        return config;
+    }
+
+    Listener::Client::Factory::Ptr new_client_factory(const unsigned int shard) override
+    {
+        return new ReplyFactory(mode, path, content);
+    }
+
+  private:
+    const ReplyMode &mode;
+    const std::string path;
+    const std::string &content;
+};
+
+} // namespace
+
+// with sendfile(), the link only sends the headers of each reply
+#if defined(OPENVPN_PLATFORM_LINUX)
+#define ASSERT_LINK_PACKETS(n) ASSERT_EQ(n, 2u)
+#else
+#define ASSERT_LINK_PACKETS(n) ASSERT_GT(n, 2u)
+#endif
+
+TEST(HTTPServer, ReplyFile)
+{
+    ASSERT_LINK_PACKETS(run_reply_test(ReplyMode()));
+}
+
+TEST(HTTPServer, ReplyFileAsyncOut)
+{
+    ReplyMode mode;
+    mode.async_out = true;
+    ASSERT_LINK_PACKETS(run_reply_test(mode));
+}
+
+TEST(HTTPServer, ReplyFileSocketFull)
+{
+    // sendfile() fills the socket buffer, and the rest is read into
+    // frames that go through the link
+    for (const bool async_out : {false, true})
+    {
+        ReplyMode mode;
+        mode.async_out = async_out;
+        mode.sndbuf = 4096;
+        mode.read_delay_ms = 50;
+        ASSERT_GT(run_reply_test(mode, 4 * 1024 * 1024 + 3), 2u) << async_out;
+    }
+}
+
+TEST(HTTPServer, ReplyFileChunked)
+{
+    for (const bool async_out : {false, true})
+    {
+        ReplyMode mode;
+        mode.chunked = true;
+        mode.async_out = async_out;
+        run_reply_test(mode);
+    }
+}
+
+TEST(HTTPServer, ReplyFileHTTPS)
+{
+    for (const bool chunked : {false, true})
+    {
+        ReplyMode mode;
+        mode.ssl = true;
+        mode.chunked = chunked;
+        run_reply_test(mode);
+    }
+}
+
+TEST(HTTPServer, ReplyBuffers)
+{
+    for (const bool chunked : {false, true})
+    {
+        for (const bool async_out : {false, true})
+        {
+            for (const bool ssl : {false, true})
+            {
+                ReplyMode mode;
+                mode.file = false;
+                mode.chunked = chunked;
+                mode.async_out = async_out;
+                mode.ssl = ssl;
+                run_reply_test(mode);
+            }
+        }
+    }
+}
+
+TEST(HTTPServer, Sharded)
+{
+    const unsigned int n_shards = 3;
+    const int n_conns = 16;
+    const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    const std::string content = random_content(1000);
+    ReplyMode mode;
+    mode.file = false;
+    ReplyShardFactory factory(mode, content);
+
+    Listen::Item item;
+    item.directive = "http-listen";
+    item.addr = "127.0.0.1";
+    const unsigned short port = free_port();
+    item.port = std::to_string(port);
+    item.proto = Protocol(Protocol::TCPv4);
+    Listen::List list;
+    list.push_back(item);
+
+    ShardedListener::Ptr listener(new ShardedListener(list, n_shards, factory));
+    listener->start();
+    ASSERT_EQ(listener->size(), n_shards);
+
+    // all shards accept on the same port
+    for (int i = 0; i < n_conns; ++i)
+    {
+        TestConn conn(port, false);
+        ASSERT_TRUE(conn.connected) << i;
+        ASSERT_TRUE(conn.send(request)) << i;
+        std::string reply;
+        ASSERT_TRUE(conn.read_reply(reply)) << i;
+        ASSERT_TRUE(reply == content) << i;
+
+        // the server counts the reply before it closes the connection
+        ASSERT_TRUE(conn.closed()) << i;
+    }
+
+    const Listener::Stats stats = listener->stats();
+    EXPECT_EQ(stats.accepted, std::uint64_t(n_conns));
+    EXPECT_EQ(stats.rejected, 0u);
+    const SessionStats::Snapshot ss = listener->session_stats();
+    const count_t reply_bytes = ss[SessionStats::BYTES_OUT] / n_conns;
+    EXPECT_GT(reply_bytes, count_t(content.size()));
+    EXPECT_EQ(ss[SessionStats::BYTES_OUT], reply_bytes * n_conns);
+
+    // every reply is the same size, so each shard's bytes match
+    // the connections it accepted
+    Listener::Stats sum;
+    SessionStats::Snapshot ss_sum{};
+    for (unsigned int i = 0; i < n_shards; ++i)
+    {
+        const Listener::Stats shard_stats = listener->shard_stats(i);
+        const SessionStats::Snapshot shard_ss = listener->session_stats(i);
+        EXPECT_EQ(shard_ss[SessionStats::BYTES_OUT], reply_bytes * shard_stats.accepted) << i;
+        sum += shard_stats;
+        for (size_t j = 0; j < ss_sum.size(); ++j)
+            ss_sum[j] += shard_ss[j];
+    }
+    EXPECT_EQ(sum.accepted, stats.accepted);
+    EXPECT_TRUE(ss == ss_sum);
+
+    // stop() joins every shard and closes the port
+    listener->stop();
+    EXPECT_EQ(listener->size(), 0u);
+    TestConn conn(port, false);
+    EXPECT_FALSE(conn.connected);
+}
+
+TEST(HTTPServer, ShardedFailure)
+{
+    // a shard whose thread dies stops all shards, and session_stats()
+    // doesn't wait for the dead threads
+    ReplyMode mode;
+    mode.file = false;
+    ReplyShardFactory factory(mode, "x");
+
+    Listen::Item item;
+    item.directive = "http-listen";
+    item.addr = "127.0.0.1";
+    const unsigned short port = free_port();
+    item.port = std::to_string(port);
+    item.proto = Protocol(Protocol::TCPv4);
+    Listen::List list;
+    list.push_back(item);
+
+    ShardedListener::Ptr listener(new ShardedListener(list, 3, factory));
+    listener->start();
+    EXPECT_FALSE(listener->failed());
+    openvpn_io::post(listener->shards[1]->io_context, []()
+                     { throw Exception("shard test failure"); });
+
+    EXPECT_TRUE(eventually([&]()
+                           {
+        for (const auto &shard : listener->shards)
+        {
+            if (shard->running)
+                return false;
+        }
+        return true; }));
+    EXPECT_TRUE(listener->failed());
+    const SessionStats::Snapshot ss = listener->session_stats();
+    EXPECT_EQ(ss[SessionStats::BYTES_OUT], 0u);
+    TestConn conn(port, false);
+    EXPECT_FALSE(conn.connected);
+
+    listener->stop();
+    EXPECT_EQ(listener->size(), 0u);
+}
+
+TEST(HTTPClientSet, PoolReuse)
+{
+    // two ClientSets share one connection through the pool
+    EchoFactory::Ptr factory(new EchoFactory());
+    TestServer server(factory, false);
+    openvpn_io::io_context io_context(1);
+    WS::ClientSet::ConnectionPool::Ptr pool(new WS::ClientSet::ConnectionPool(io_context, WS::ClientSet::ConnectionPool::Config()));
+    WS::ClientSet::Ptr cs1(new WS::ClientSet(io_context));
+    WS::ClientSet::Ptr cs2(new WS::ClientSet(io_context));
+    const WS::Client::Config::Ptr config = client_config();
+
+    WS::ClientSet::TransactionSet::Ptr ts1 = new_transaction_set(server.port, config, {"/a", "/b"});
+    WS::ClientSet::TransactionSet::Ptr ts2 = new_transaction_set(server.port, config, {"/c", "/d"});
+    ts1->pool = pool;
+    ts2->pool = pool;
+    ts1->completion = [&](WS::ClientSet::TransactionSet &ts)
+    {
+        EXPECT_TRUE(echoed(ts));
+        EXPECT_EQ(pool->n_active(), 0u);
+        EXPECT_EQ(pool->n_idle(), 1u);
+        cs2->new_request(ts2);
+    };
+    ts2->completion = [&](WS::ClientSet::TransactionSet &ts)
+    {
+        EXPECT_TRUE(echoed(ts));
+        EXPECT_EQ(pool->n_idle(), 1u);
+        pool->stop();
+    };
+    cs1->new_request(ts1);
+    io_context.run();
+
+    EXPECT_TRUE(ts1->status);
+    EXPECT_TRUE(ts2->status);
+    EXPECT_EQ(pool->n_idle(), 0u);
+    EXPECT_EQ(factory->requests, 4);
+    EXPECT_EQ(server.listener->stats().accepted, 1u);
+}
+
+TEST(HTTPClientSet, PoolKeyedByConfig)
+{
+    // connections to the same host:port aren't shared between
+    // different http_configs, or Host settings for the transport
+    EchoFactory::Ptr factory(new EchoFactory());
+    TestServer server(factory, false);
+    openvpn_io::io_context io_context(1);
+    WS::ClientSet::ConnectionPool::Ptr pool(new WS::ClientSet::ConnectionPool(io_context, WS::ClientSet::ConnectionPool::Config()));
+    WS::ClientSet::Ptr cs(new WS::ClientSet(io_context));
+
+    WS::ClientSet::TransactionSet::Ptr ts1 = new_transaction_set(server.port, client_config(), {"/a"});
+    WS::ClientSet::TransactionSet::Ptr ts2 = new_transaction_set(server.port, client_config(), {"/b"});
+    WS::ClientSet::TransactionSet::Ptr ts3 = new_transaction_set(server.port, ts1->http_config, {"/c"});
+    ts3->host.cn = "other.example";
+    ts1->pool = pool;
+    ts2->pool = pool;
+    ts3->pool = pool;
+    ts1->completion = [&](WS::ClientSet::TransactionSet &ts)
+    {
+        EXPECT_TRUE(echoed(ts));
+        EXPECT_EQ(pool->n_idle(), 1u);
+        cs->new_request(ts2);
+    };
+    ts2->completion = [&](WS::ClientSet::TransactionSet &ts)
+    {
+        EXPECT_TRUE(echoed(ts));
+        EXPECT_EQ(pool->n_idle(), 2u);
+        cs->new_request(ts3);
+    };
+    ts3->completion = [&](WS::ClientSet::TransactionSet &ts)
+    {
+        EXPECT_TRUE(echoed(ts));
+        EXPECT_EQ(pool->n_idle(), 3u);
+        pool->stop();
+    };
+    cs->new_request(ts1);
+    io_context.run();
+
+    EXPECT_TRUE(ts1->status);
+    EXPECT_TRUE(ts2->status);
+    EXPECT_TRUE(ts3->status);
+    EXPECT_EQ(factory->requests, 3);
+    EXPECT_EQ(server.listener->stats().accepted, 3u);
+}
+
+// the HTTPDelegate parent callbacks other than http_pipeline_request()
+template <typename PARENT>
+struct DelegateParent
+{
+    typedef WS::Client::HTTPDelegate<PARENT> Delegate;
+
+    WS::Client::Host http_host(Delegate &)
+    {
+        return WS::Client::Host();
+    }
+    WS::Client::Request http_request(Delegate &)
+    {
+        return WS::Client::Request();
+    }
+    WS::Client::ContentInfo http_content_info(Delegate &)
+    {
+        return WS::Client::ContentInfo();
+    }
+    BufferPtr http_content_out(Delegate &)
+    {
+        return BufferPtr();
+    }
+    void http_content_out_needed(Delegate &)
+    {
+    }
+    void http_headers_received(Delegate &)
+    {
+    }
+    void http_headers_sent(Delegate &, const Buffer &)
+    {
+    }
+    void http_mutate_resolver_results(Delegate &, openvpn_io::ip::tcp::resolver::results_type &)
+    {
+    }
+    void http_content_in(Delegate &, BufferAllocated &)
+    {
+    }
+    void http_done(Delegate &, const int, const std::string &)
+    {
+    }
+    void http_keepalive_close(Delegate &, const int, const std::string &)
+    {
+    }
+    void http_post_connect(Delegate &, AsioPolySock::Base &)
+    {
+    }
+};
+
+// a parent written before pipelining existed
+struct LegacyDelegateParent : public DelegateParent<LegacyDelegateParent>
+{
+};
+
+struct PipelineDelegateParent : public DelegateParent<PipelineDelegateParent>
+{
+    typedef WS::Client::HTTPDelegate<PipelineDelegateParent> Delegate;
+
+    bool http_pipeline_request(Delegate &, const size_t index, WS::Client::Request &req, WS::Client::ContentInfo &)
+    {
+        req.uri = "/" + std::to_string(index);
+        return index < 2;
+    }
+};
+
+TEST(HTTPClientSet, DelegatePipelineOptional)
+{
+    // parents that don't define http_pipeline_request() still
+    // compile, and don't pipeline
+    openvpn_io::io_context io_context(1);
+    WS::Client::Request req;
+    WS::Client::ContentInfo ci;
+
+    LegacyDelegateParent legacy;
+    LegacyDelegateParent::Delegate::Ptr hd1(new LegacyDelegateParent::Delegate(io_context, client_config(), &legacy));
+    EXPECT_FALSE(hd1->http_pipeline_request(1, req, ci));
+
+    PipelineDelegateParent pipeline;
+    PipelineDelegateParent::Delegate::Ptr hd2(new PipelineDelegateParent::Delegate(io_context, client_config(), &pipeline));
+    EXPECT_TRUE(hd2->http_pipeline_request(1, req, ci));
+    EXPECT_EQ(req.uri, "/1");
+    EXPECT_FALSE(hd2->http_pipeline_request(2, req, ci));
+}
+
+TEST(HTTPClientSet, PoolMaxPerHost)
+{
+    // with one connection per host, the transaction sets wait for
+    // each other and take turns on the same connection
+    EchoFactory::Ptr factory(new EchoFactory());
+    TestServer server(factory, false);
+    openvpn_io::io_context io_context(1);
+    WS::ClientSet::ConnectionPool::Config pool_config;
+    pool_config.max_per_host = 1;
+    WS::ClientSet::ConnectionPool::Ptr pool(new WS::ClientSet::ConnectionPool(io_context, pool_config));
+    WS::ClientSet::Ptr cs(new WS::ClientSet(io_context));
+    const WS::Client::Config::Ptr config = client_config();
+
+    const int n = 3;
+    int completed = 0;
+    std::vector<WS::ClientSet::TransactionSet::Ptr> sets;
+    for (int i = 0; i < n; ++i)
+    {
+        WS::ClientSet::TransactionSet::Ptr ts = new_transaction_set(server.port, config, {"/" + std::to_string(i)});
+        ts->pool = pool;
+        ts->completion = [&](WS::ClientSet::TransactionSet &ts)
+        {
+            EXPECT_TRUE(echoed(ts));
+            EXPECT_EQ(pool->n_active(), ++completed < n ? 1u : 0u);
+            if (completed == n)
+                pool->stop();
+        };
+        sets.push_back(ts);
+        cs->new_request(ts);
+    }
+    EXPECT_EQ(pool->n_active(), 1u);
+    io_context.run();
+
+    EXPECT_EQ(completed, n);
+    EXPECT_EQ(factory->requests, n);
+    EXPECT_EQ(server.listener->stats().accepted, 1u);
+}
+
+TEST(HTTPClientSet, PoolIdleReap)
+{
+    EchoFactory::Ptr factory(new EchoFactory());
+    TestServer server(factory, false);
+    openvpn_io::io_context io_context(1);
+    WS::ClientSet::ConnectionPool::Config pool_config;
+    pool_config.idle_timeout = Time::Duration::milliseconds(200);
+    WS::ClientSet::ConnectionPool::Ptr pool(new WS::ClientSet::ConnectionPool(io_context, pool_config));
+    WS::ClientSet::Ptr cs(new WS::ClientSet(io_context));
+
+    WS::ClientSet::TransactionSet::Ptr ts = new_transaction_set(server.port, client_config(), {"/a"});
+    ts->pool = pool;
+    std::chrono::steady_clock::time_point completed;
+    ts->completion = [&](WS::ClientSet::TransactionSet &ts)
+    {
+        EXPECT_TRUE(echoed(ts));
+        EXPECT_EQ(pool->n_idle(), 1u);
+        completed = std::chrono::steady_clock::now();
+    };
+    cs->new_request(ts);
+
+    // run() returns once the reap timer has closed the idle connection
+    io_context.run();
+    EXPECT_GE(std::chrono::steady_clock::now() - completed, std::chrono::milliseconds(150));
+    EXPECT_EQ(pool->n_idle(), 0u);
+    EXPECT_TRUE(eventually([&]()
+                           { return factory->clients == 0; }));
+}
+
+TEST(HTTPClientSet, Pipeline)
+{
+    // the server only replies once all requests have arrived,
+    // so this only completes if they were pipelined
+    const std::vector<std::string> uris = {"/one", "/two", "/three"};
+    PipelineServer server(uris.size());
+    openvpn_io::io_context io_context(1);
+    WS::ClientSet::Ptr cs(new WS::ClientSet(io_context));
+    WS::ClientSet::TransactionSet::Ptr ts = new_transaction_set(server.port, client_config(), uris);
+    ts->pipeline = true;
+    cs->new_request(ts);
+    io_context.run();
+
+    ASSERT_TRUE(ts->http_status_success());
+    for (size_t i = 0; i < uris.size(); ++i)
+        EXPECT_EQ(ts->transactions[i]->content_in_string(), PipelineServer::body(uris[i])) << i;
+}
+
+TEST(HTTPServer, PipelineResidual)
+{
+    // While the first request is being answered, the rest arrives in
+    // two reads.  The first read holds the second request and the start
+    // of the third.  Its residual must be parsed before the second read.
+    EchoFactory::Ptr factory(new EchoFactory());
+    TestServer server(factory, false);
+    TestConn conn(server.port, false);
+    ASSERT_TRUE(conn.connected);
+    const std::string third = "GET /three HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+    ASSERT_TRUE(conn.send("GET /slow HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(conn.send("GET /two HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n" + third.substr(0, 20)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(conn.send(third.substr(20)));
+
+    for (const std::string uri : {"/slow", "/two", "/three"})
+    {
+        std::string reply;
+        ASSERT_TRUE(conn.read_reply(reply)) << uri;
+        EXPECT_EQ(reply, uri);
+    }
+    EXPECT_EQ(factory->requests, 3);
+}
@@ -113,6 +113,54 @@ TEST(Pool, AcquiringNotAvailableAddressReturnsFalse)
     ASSERT_FALSE(pool.acquire_specific_addr(IP::Addr::from_string("1.2.3.42")));
 }
 
+TEST(Pool, OverlappingRangesAreOwnedOnce)
+{
+    auto pool = IP::Pool{};
+    pool.add_range(IP::Range(IP::Addr::from_string("10.0.0.10"), 10));
+    pool.add_range(IP::Range(IP::Addr::from_string("10.0.0.5"), 20));
+    pool.add_addr(IP::Addr::from_string("10.0.0.12"));
+    pool.add_addr(IP::Addr::from_string("10.0.0.25"));
+    ASSERT_EQ(pool.n_free(), 21u);
+
+    std::string acquired;
+    IP::Addr addr;
+    while (pool.acquire_addr(addr))
+        acquired += addr.to_string() + ' ';
+    ASSERT_EQ(acquired,
+              "10.0.0.10 10.0.0.11 10.0.0.12 10.0.0.13 10.0.0.14 "
+              "10.0.0.15 10.0.0.16 10.0.0.17 10.0.0.18 10.0.0.19 "
+              "10.0.0.5 10.0.0.6 10.0.0.7 10.0.0.8 10.0.0.9 "
+              "10.0.0.20 10.0.0.21 10.0.0.22 10.0.0.23 10.0.0.24 "
+              "10.0.0.25 ");
+    ASSERT_EQ(pool.n_in_use(), 21u);
+}
+
+TEST(Pool, LargeRange)
+{
+    auto pool = IP::Pool{};
+    pool.add_range(IP::Range(IP::Addr::from_string("10.16.0.2"), (1 << 20) - 3));
+    pool.add_range(IP::Range(IP::Addr::from_string("fd00::2"), size_t(1) << 32));
+    ASSERT_EQ(pool.n_free(), (1u << 20) - 3 + (size_t(1) << 32));
+
+    ASSERT_TRUE(pool.acquire_specific_addr(IP::Addr::from_string("10.31.255.254")));
+    ASSERT_FALSE(pool.acquire_specific_addr(IP::Addr::from_string("10.31.255.254")));
+    ASSERT_FALSE(pool.acquire_specific_addr(IP::Addr::from_string("10.31.255.255")));
+    ASSERT_TRUE(pool.acquire_specific_addr(IP::Addr::from_string("fd00::1:0:1")));
+    ASSERT_FALSE(pool.acquire_specific_addr(IP::Addr::from_string("fd00::1:0:2")));
+
+    IP::Addr addr;
+    for (int i = 0; i < 10000; ++i)
+        ASSERT_TRUE(pool.acquire_addr(addr));
+    ASSERT_EQ(addr.to_string(), "10.16.39.17");
+    pool.release_addr(IP::Addr::from_string("10.16.0.2"));
+    pool.release_addr(IP::Addr::from_string("10.16.0.2"));
+    pool.release_addr(IP::Addr::from_string("10.31.255.254"));
+    pool.release_addr(IP::Addr::from_string("fd00::1:0:1"));
+    for (int i = 2; i < 10000; ++i)
+        pool.release_addr(IP::Addr::from_string("10.16.0.2") + i);
+    ASSERT_EQ(pool.to_string(), "10.16.0.3\n");
+}
+
 TEST(Range, EmptyRangeBeginEndIteratorsAreEqual)
 {
     auto empty_range = IP::Range{};
@@ -3,16 +3,9 @@
 #include <openvpn/crypto/packet_id_control.hpp>
 #include <openvpn/crypto/packet_id_data.hpp>
 
-using namespace openvpn;
+#include "pktid_data_ref.hpp"
 
-struct PacketIDDataConstruct : public PacketIDData
-{
-    explicit PacketIDDataConstruct(const PacketIDData::data_id_t v_id = PacketIDData::data_id_t{0}, bool wide = false)
-        : PacketIDData(wide)
-    {
-        id = v_id;
-    }
-};
+using namespace openvpn;
 
 template <typename PIDRecv>
 void testcase(PIDRecv &pr,
@@ -262,3 +255,51 @@ TEST(misc, pktid_data_perf)
         // ASSERT_EQ(4746439, count);
     }
 }
+
+template <unsigned int ORDER>
+void compare_bytewise(const std::uint32_t max_delay, const std::uint32_t jump)
+{
+    typedef PacketIDDataReceiveType<ORDER, 5> PIDRecv;
+    PIDRecv pr;
+    pr.init("test", 0, true, SessionStats::Ptr(new SessionStats()));
+    PacketIDDataReceiveBytewise<ORDER, 5> ref;
+
+    const std::vector<PacketIDData::data_id_t> ids = reordered_ids(200000, max_delay, jump);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        const PacketIDDataConstruct pid(ids[i], true);
+        const std::time_t t = static_cast<std::time_t>(i / 20000); // exercise id_floor expiry
+        ASSERT_EQ(pr.do_test_add(pid, t), ref.do_test_add(pid, t)) << "order=" << ORDER << " i=" << i << " id=" << ids[i];
+    }
+}
+
+TEST(misc, pktid_data_matches_bytewise)
+{
+    compare_bytewise<3>(40, 200);
+    compare_bytewise<3>(100, 0);
+    compare_bytewise<8>(1000, 5000);
+    compare_bytewise<8>(3000, 0);
+    compare_bytewise<12>(20000, 70000);
+}
+
+TEST(misc, pktid_data_large_window)
+{
+    typedef PacketIDDataReceiveType<12, 5> PIDRecv;
+    static_assert(PIDRecv::REPLAY_WINDOW_SIZE == 32768);
+    SessionStats::Ptr stats(new SessionStats());
+    PIDRecv pr;
+    pr.init("test", 0, true, stats);
+
+    testcase(pr, 1, 1, Error::SUCCESS);
+    testcase(pr, 1, 40000, Error::SUCCESS);
+    testcase(pr, 1, 7233, Error::SUCCESS);       // 32767 behind
+    testcase(pr, 1, 7232, Error::PKTID_BACKTRACK); // 32768 behind
+    testcase(pr, 1, 7233, Error::PKTID_REPLAY);
+    testcase(pr, 1, 39999, Error::SUCCESS);
+    testcase(pr, 1, 40064, Error::SUCCESS);
+    testcase(pr, 1, 7297, Error::SUCCESS);
+    testcase(pr, 1, 7296, Error::PKTID_BACKTRACK);
+    testcase(pr, 1, 100000, Error::SUCCESS);
+    testcase(pr, 1, 100000 - 32767, Error::SUCCESS);
+    testcase(pr, 1, 40064, Error::PKTID_BACKTRACK);
+}
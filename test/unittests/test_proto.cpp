@@ -446,6 +446,19 @@ class TestProto : public ProtoContextCallbackInterface
         }
     }
 
+    void data_decrypt_batch(BufferAllocated *bufs, const size_t n)
+    {
+        proto_context.data_decrypt_batch(bufs, n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (bufs[i].size())
+            {
+                data_bytes_ += bufs[i].size();
+                data_drought.event();
+            }
+        }
+    }
+
     size_t net_bytes() const
     {
         return net_bytes_;
@@ -638,7 +651,8 @@ class NoisyWire
               RandomAPI &rand_arg,
               const unsigned int reorder_prob_arg,
               const unsigned int drop_prob_arg,
-              const unsigned int corrupt_prob_arg)
+              const unsigned int corrupt_prob_arg,
+              const bool batch_decrypt_arg = false)
         : title(title_arg),
 #ifdef VERBOSE
           now(now_arg),
@@ -646,7 +660,8 @@ class NoisyWire
           random(rand_arg),
           reorder_prob(reorder_prob_arg),
           drop_prob(drop_prob_arg),
-          corrupt_prob(corrupt_prob_arg)
+          corrupt_prob(corrupt_prob_arg),
+          batch_decrypt(batch_decrypt_arg)
     {
     }
 
@@ -668,11 +683,15 @@ class NoisyWire
         // queue a control channel packet
         a.app_send_templ();
 
-        // queue a data channel packet
+        // queue a data channel packet, or several when they are
+        // decrypted as a batch
         if (a.proto_context.data_channel_ready())
         {
-            BufferPtr bp = a.data_encrypt_string("Waiting for godot A... Waiting for godot B... Waiting for godot C... Waiting for godot D... Waiting for godot E... Waiting for godot F... Waiting for godot G... Waiting for godot H... Waiting for godot I... Waiting for godot J...");
-            wire.push_back(bp);
+            for (int i = 0; i < (batch_decrypt ? 4 : 1); ++i)
+            {
+                BufferPtr bp = a.data_encrypt_string("Waiting for godot A... Waiting for godot B... Waiting for godot C... Waiting for godot D... Waiting for godot E... Waiting for godot F... Waiting for godot G... Waiting for godot H... Waiting for godot I... Waiting for godot J...");
+                wire.push_back(bp);
+            }
         }
 
         // transfer network packets from A -> wire
@@ -693,8 +712,14 @@ class NoisyWire
             if (!bp)
                 break;
             typename ProtoContext::PacketType pt = b.proto_context.packet_type(*bp);
+            if (pt.is_data() && batch_decrypt)
+            {
+                batch.emplace_back(std::move(*bp));
+                continue;
+            }
             if (pt.is_control())
             {
+                decrypt_batch(b);
 #ifdef VERBOSE
                 if (!b.control_net_validate(pt, *bp)) // not strictly necessary since control_net_recv will also validate
                     std::cout << now->raw() << " " << title << " CONTROL PACKET VALIDATION FAILED" << std::endl;
@@ -739,10 +764,30 @@ class NoisyWire
             }
 #endif
         }
+        decrypt_batch(b);
         b.proto_context.flush(true);
     }
 
   private:
+    // decrypt the data channel packets received since the last control packet
+    template <typename T>
+    void decrypt_batch(T &b)
+    {
+        if (batch.empty())
+            return;
+        try
+        {
+            b.data_decrypt_batch(batch.data(), batch.size());
+        }
+        catch ([[maybe_unused]] const std::exception &e)
+        {
+#ifdef VERBOSE
+            std::cout << now->raw() << " " << title << " Exception on data channel batch decrypt: " << e.what() << std::endl;
+#endif
+        }
+        batch.clear();
+    }
+
     BufferPtr recv()
     {
 #ifdef SIMULATE_OOO
@@ -811,7 +856,9 @@ class NoisyWire
     unsigned int reorder_prob;
     unsigned int drop_prob;
     unsigned int corrupt_prob;
+    bool batch_decrypt;
     std::deque<BufferPtr> wire;
+    std::vector<BufferAllocated> batch;
 };
 
 class MySessionStats : public SessionStats
@@ -853,7 +900,7 @@ class MySessionStats : public SessionStats
 };
 
 // execute the unit test in one thread
-int test(const int thread_num, bool use_tls_ekm)
+int test(const int thread_num, bool use_tls_ekm, bool batch_decrypt = false)
 {
     try
     {
@@ -1081,8 +1128,8 @@ int test(const int thread_num, bool use_tls_ekm)
             cli_proto.reset();
             serv_proto.reset();
 
-            NoisyWire client_to_server("Client -> Server", &time, rng_noncrypto, 8, 16, 32); // last value: 32
-            NoisyWire server_to_client("Server -> Client", &time, rng_noncrypto, 8, 16, 32); // last value: 32
+            NoisyWire client_to_server("Client -> Server", &time, rng_noncrypto, 8, 16, 32, batch_decrypt); // last value: 32
+            NoisyWire server_to_client("Server -> Client", &time, rng_noncrypto, 8, 16, 32, batch_decrypt); // last value: 32
 
             int j = -1;
             try
@@ -1150,12 +1197,12 @@ int test(const int thread_num, bool use_tls_ekm)
     return 0;
 }
 
-int test_retry(const int thread_num, const int n_retries, bool use_tls_ekm)
+int test_retry(const int thread_num, const int n_retries, bool use_tls_ekm, bool batch_decrypt = false)
 {
     int ret = 1;
     for (int i = 0; i < n_retries; ++i)
     {
-        ret = test(thread_num, use_tls_ekm);
+        ret = test(thread_num, use_tls_ekm, batch_decrypt);
         if (!ret)
             return 0;
         std::cout << "Retry " << (i + 1) << '/' << n_retries << std::endl;
@@ -1214,6 +1261,15 @@ TEST_F(ProtoUnitTest, base_single_thread_no_tls_ekm)
     EXPECT_EQ(ret, 0);
 }
 
+TEST_F(ProtoUnitTest, base_single_thread_batch_decrypt)
+{
+    int ret = 0;
+
+    ret = test_retry(1, N_RETRIES, false, true);
+
+    EXPECT_EQ(ret, 0);
+}
+
 TEST_F(ProtoUnitTest, base_multiple_thread)
 {
     unsigned int num_threads = std::thread::hardware_concurrency();
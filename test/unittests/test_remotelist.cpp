@@ -508,6 +508,212 @@ TEST(RemoteList, RemoteListBulkResolve)
 
 
 
+TEST(RemoteList, RemoteListBulkResolveParallel)
+{
+    OptionList cfg;
+    cfg.parse_from_config(
+        "remote 10.0.0.1 1111 udp\n"
+        "remote 2001:db8::2 2222 udp\n"
+        "remote 10.0.0.1 3333 tcp\n"
+        "remote 10.0.0.4 4444 udp\n"
+        "remote 2001:db8::5 5555 udp4\n",
+        nullptr);
+    cfg.update_map();
+
+    RemoteList::Ptr rl(new RemoteList(cfg, "", 0, nullptr, nullptr));
+    rl->set_enable_cache(true);
+
+    // IP literals are resolved without DNS, but still asynchronously
+    openvpn_io::io_context ioctx;
+    RemoteList::BulkResolve::Ptr bulkres(new RemoteList::BulkResolve(ioctx, rl, SessionStats::Ptr()));
+    bulkres->set_max_parallel(2);
+
+    BulkResolveNotifyLog logmsg("<<<RemoteListBulkResolveParallel>>>");
+    testLog->startCollecting();
+    bulkres->start(&logmsg);
+    ioctx.run();
+    std::string output(testLog->stopCollecting());
+    ASSERT_NE(output.find("<<<RemoteListBulkResolveParallel>>>"), std::string::npos);
+
+    // IPv6 address of the udp4 entry is incompatible, so it is pruned
+    ASSERT_EQ(4UL, rl->size())
+        << "Unexpected remote list item count" << std::endl
+        << output;
+
+    const char *expected[] = {"10.0.0.1", "2001:db8::2", "10.0.0.1", "10.0.0.4"};
+    for (size_t i = 0; i < rl->size(); ++i)
+    {
+        ASSERT_EQ(rl->get_item(i)->res_addr_list_defined(), true);
+        ASSERT_EQ(rl->get_item(i)->res_addr_list->size(), 1UL);
+        ASSERT_EQ(rl->get_item(i)->res_addr_list->at(0)->to_string(), expected[i]);
+    }
+}
+
+TEST(RemoteList, RemoteListCandidates)
+{
+    OptionList cfg;
+    cfg.parse_from_config(
+        "remote-cache-lifetime 1\n"
+        "remote 1.domain.tld 1111 udp\n"
+        "remote 2.domain.tld 2222 udp\n"
+        "remote 3.domain.tld 3333 tcp\n",
+        nullptr);
+    cfg.update_map();
+
+    RemoteList::Ptr rl(new RemoteList(cfg, "", 0, nullptr, nullptr));
+    rl->set_enable_cache(true);
+
+    openvpn_io::io_context ioctx;
+    SessionStats::Ptr stats(new SessionStats());
+    FakeAsyncResolvable<
+        RemoteList::BulkResolve,
+        openvpn_io::io_context &,
+        const RemoteList::Ptr &,
+        const SessionStats::Ptr &>
+        fake_bulkres(ioctx, rl, stats);
+
+    fake_bulkres.set_results("1.domain.tld", "1111", {{"1.1.1.1", 1111}, {"1.1.1.11", 1111}});
+    fake_bulkres.set_results("2.domain.tld", "2222", {{"2::2", 2222}, {"2.2.2.2", 2222}});
+    fake_bulkres.set_results("3.domain.tld", "3333", {{"3::3", 3333}, {"33::33", 3333}});
+
+    BulkResolveNotifyIgn ignore;
+    fake_bulkres.start(&ignore);
+
+    // address families alternate, IPv6 first, list order within a family
+    const char *expected[] = {"2::2", "1.1.1.1", "3::3", "1.1.1.11", "33::33", "2.2.2.2"};
+    const auto candidates = rl->candidates();
+    ASSERT_EQ(candidates.size(), 6UL);
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        rl->select(candidates[i]);
+        auto ep = fake_bulkres.init_endpoint();
+        rl->get_endpoint(ep);
+        ASSERT_EQ(ep.address().to_string(), expected[i]);
+        ASSERT_EQ(rl->current_server_host(), rl->get_item(candidates[i].item)->server_host);
+    }
+
+    ASSERT_THROW(rl->select({0, 2}), RemoteList::remote_list_error);
+    ASSERT_THROW(rl->select({3, 0}), RemoteList::remote_list_error);
+}
+
+TEST(RemoteList, RemoteCacheParse)
+{
+    RemoteCache cache("", 100);
+    cache.parse("1.domain.tld 1111 UDP 1000 900 1.1.1.1 1::1\n"
+                "2.domain.tld 2222 TCP 899 0 2.2.2.2\n"
+                "3.domain.tld 3333 UDP 1000 0 not-an-address\n"
+                "4.domain.tld 4444 UDP garbage\n"
+                "5.domain.tld 5555 UDPv4 950 0\n",
+                1050);
+
+    // expired, malformed and empty entries are dropped
+    ASSERT_EQ(cache.size(), 1UL);
+    const RemoteCache::Entry *entry = cache.get(RemoteCache::key("1.domain.tld", "1111", Protocol(Protocol::UDP)));
+    ASSERT_NE(entry, nullptr);
+    ASSERT_EQ(entry->resolve_time, 1000);
+    ASSERT_EQ(entry->last_success, 900);
+    ASSERT_EQ(entry->addrs.size(), 2UL);
+    ASSERT_EQ(entry->addrs[1].to_string(), "1::1");
+
+    ASSERT_EQ(cache.render(), "1.domain.tld 1111 UDP 1000 900 1.1.1.1 1::1\n");
+}
+
+TEST(RemoteList, RemoteListCache)
+{
+    OptionList cfg;
+    cfg.parse_from_config(
+        "remote 1.domain.tld 1111 udp\n"
+        "remote 2.domain.tld 2222 udp\n"
+        "remote 3.domain.tld 3333 udp4\n",
+        nullptr);
+    cfg.update_map();
+
+    RemoteList::Ptr rl(new RemoteList(cfg, "", 0, nullptr, nullptr));
+    rl->set_enable_cache(true);
+
+    openvpn_io::io_context ioctx;
+    SessionStats::Ptr stats(new SessionStats());
+    FakeAsyncResolvable<
+        RemoteList::BulkResolve,
+        openvpn_io::io_context &,
+        const RemoteList::Ptr &,
+        const SessionStats::Ptr &>
+        fake_bulkres(ioctx, rl, stats);
+
+    fake_bulkres.set_results("1.domain.tld", "1111", {{"1.1.1.1", 1111}});
+    fake_bulkres.set_results("2.domain.tld", "2222", {{"2.2.2.2", 2222}, {"2::2", 2222}});
+    fake_bulkres.set_results("3.domain.tld", "3333", {{"3.3.3.3", 3333}});
+
+    BulkResolveNotifyIgn ignore;
+    fake_bulkres.start(&ignore);
+
+    // pretend we connected to the IPv6 address of the second remote
+    rl->next();
+    rl->next();
+    auto ep = fake_bulkres.init_endpoint();
+    rl->get_endpoint(ep);
+    ASSERT_EQ(ep.address().to_string(), "2::2");
+
+    RemoteCache cache("", 3600);
+    rl->save_cache(cache, IP::Addr::from_asio(ep.address()));
+    ASSERT_EQ(cache.size(), 3UL);
+    const RemoteCache::Entry *entry = cache.get(RemoteCache::key("2.domain.tld", "2222", Protocol(Protocol::UDP)));
+    ASSERT_NE(entry, nullptr);
+    ASSERT_NE(entry->last_success, 0);
+    ASSERT_EQ(entry->addrs[0].to_string(), "2::2");
+
+    // a new instance starts from the last good address without resolving
+    RemoteCache loaded("", 3600);
+    loaded.parse(cache.render(), time(nullptr));
+    RemoteList::Ptr rl2(new RemoteList(cfg, "", 0, nullptr, nullptr));
+    rl2->set_enable_cache(true);
+    ASSERT_TRUE(rl2->load_cache(loaded));
+
+    std::string host;
+    ASSERT_TRUE(rl2->endpoint_available(&host, nullptr, nullptr));
+    ASSERT_EQ(host, "2.domain.tld");
+    rl2->get_endpoint(ep);
+    ASSERT_EQ(ep.address().to_string(), "2::2");
+    ASSERT_EQ(rl2->get_item(1)->server_host, "1.domain.tld");
+    ASSERT_EQ(rl2->get_item(2)->server_host, "3.domain.tld");
+
+    // cached addresses are stale until resolved again
+    for (size_t i = 0; i < rl2->size(); ++i)
+        ASSERT_TRUE(rl2->get_item(i)->need_resolve());
+
+    // the refresh replaces the list of the connected item and resets its
+    // address index, the connected address is still the one recorded
+    FakeAsyncResolvable<
+        RemoteList::BulkResolve,
+        openvpn_io::io_context &,
+        const RemoteList::Ptr &,
+        const SessionStats::Ptr &>
+        fake_bulkres2(ioctx, rl2, stats);
+    fake_bulkres2.set_results("1.domain.tld", "1111", {{"1.1.1.1", 1111}});
+    fake_bulkres2.set_results("2.domain.tld", "2222", {{"2.2.2.2", 2222}, {"2::2", 2222}});
+    fake_bulkres2.set_results("3.domain.tld", "3333", {{"3.3.3.3", 3333}});
+    fake_bulkres2.start(&ignore);
+    rl2->get_endpoint(ep);
+    ASSERT_EQ(ep.address().to_string(), "2.2.2.2");
+
+    RemoteCache cache2("", 3600);
+    rl2->save_cache(cache2, IP::Addr("2::2"));
+    entry = cache2.get(RemoteCache::key("2.domain.tld", "2222", Protocol(Protocol::UDP)));
+    ASSERT_NE(entry, nullptr);
+    ASSERT_NE(entry->last_success, 0);
+    ASSERT_EQ(entry->addrs.size(), 2UL);
+    ASSERT_EQ(entry->addrs[0].to_string(), "2::2");
+    ASSERT_EQ(entry->addrs[1].to_string(), "2.2.2.2");
+
+    // without a connection, nothing is recorded
+    RemoteCache cache3("", 3600);
+    rl2->save_cache(cache3);
+    entry = cache3.get(RemoteCache::key("2.domain.tld", "2222", Protocol(Protocol::UDP)));
+    ASSERT_NE(entry, nullptr);
+    ASSERT_EQ(entry->last_success, 0);
+    ASSERT_EQ(entry->addrs[0].to_string(), "2.2.2.2");
+}
+
 TEST(RemoteList, RemoteRandomHostname)
 {
     OptionList cfg;
@@ -15,6 +15,7 @@
 #include "test_common.h"
 
 #include <openvpn/client/cliemuexr.hpp>
+#include <openvpn/random/mtrandapi.hpp>
 
 
 namespace unittests {
@@ -285,4 +286,102 @@ TEST_F(RouteEmulationTest, DefaultRoute)
     ASSERT_EQ(tb->routes.at(0), "0.0.0.0/0");
 }
 
+// random canonical route of the given version, with prefix length in [min_len, max_len]
+static openvpn::IP::Route random_route(openvpn::RandomAPI &prng,
+                                       const openvpn::IP::Addr::Version ver,
+                                       const unsigned int min_len,
+                                       const unsigned int max_len)
+{
+    unsigned char bytes[16];
+    prng.rand_bytes(bytes, sizeof(bytes));
+    const openvpn::IP::Addr addr = ver == openvpn::IP::Addr::V4
+                                       ? openvpn::IP::Addr::from_ipv4(openvpn::IPv4::Addr::from_bytes(bytes))
+                                       : openvpn::IP::Addr::from_ipv6(openvpn::IPv6::Addr::from_byte_string(bytes));
+    const unsigned int prefix_len = min_len + prng.randrange32(max_len - min_len + 1);
+    return openvpn::IP::Route(addr & openvpn::IP::Addr::netmask_from_prefix_len(ver, prefix_len), prefix_len);
+}
+
+// the original quadratic algorithm, as a reference
+static void split_linear(const openvpn::IP::RouteList &in, const openvpn::IP::Route &route, openvpn::IP::RouteList &out)
+{
+    bool subroute = false;
+    for (const auto &r : in)
+    {
+        if (route != r && route.contains(r))
+            subroute = true;
+    }
+    openvpn::IP::Route r1, r2;
+    if (subroute && route.split(r1, r2))
+    {
+        split_linear(in, r1, out);
+        split_linear(in, r2, out);
+    }
+    else
+        out.push_back(route);
+}
+
+TEST(AddressSpaceSplitter, MatchesLinearSearch)
+{
+    openvpn::MTRand prng(42);
+    for (int i = 0; i < 20; ++i)
+    {
+        openvpn::IP::RouteList in;
+        for (int j = 0; j < 50; ++j)
+        {
+            in.push_back(random_route(prng, openvpn::IP::Addr::V4, 0, 32));
+            in.push_back(random_route(prng, openvpn::IP::Addr::V6, 0, 128));
+        }
+        // duplicates and nested routes
+        in.push_back(in.front());
+        in.push_back(openvpn::IP::Route(in[2].addr & openvpn::IP::Addr::netmask_from_prefix_len(in[2].version(), in[2].prefix_len / 2), in[2].prefix_len / 2));
+
+        openvpn::IP::RouteList expected;
+        split_linear(in, openvpn::IP::Route("0.0.0.0/0"), expected);
+        split_linear(in, openvpn::IP::Route("::/0"), expected);
+
+        const openvpn::IP::AddressSpaceSplitter split(in);
+        ASSERT_EQ(static_cast<const openvpn::IP::RouteList &>(split).to_string(), expected.to_string());
+    }
+}
+
+TEST_F(RouteEmulationTest, ManyExcludeRoutes)
+{
+    setup(false, false);
+
+    openvpn::MTRand prng(42);
+    std::vector<openvpn::IP::Route> incl, excl;
+    for (int i = 0; i < 200; ++i)
+        incl.push_back(random_route(prng, openvpn::IP::Addr::V4, 4, 16));
+    for (int i = 0; i < 2000; ++i)
+        excl.push_back(random_route(prng, openvpn::IP::Addr::V4, 8, 28));
+    for (const auto &r : incl)
+        emu->add_route(true, r.addr, r.prefix_len);
+    for (const auto &r : excl)
+        emu->add_route(false, r.addr, r.prefix_len);
+
+    doEmulate();
+
+    // an address is routed if its longest include route isn't
+    // outranked by a longer exclude route
+    auto longest = [](const std::vector<openvpn::IP::Route> &routes, const openvpn::IP::Addr &addr)
+    {
+        int len = -1;
+        for (const auto &r : routes)
+        {
+            if (r.contains(addr) && static_cast<int>(r.prefix_len) > len)
+                len = r.prefix_len;
+        }
+        return len;
+    };
+    for (int i = 0; i < 1000; ++i)
+    {
+        // pick addresses near the routes, random ones would hardly hit them
+        const auto &r = (i & 1) ? incl[prng.randrange32(incl.size())] : excl[prng.randrange32(excl.size())];
+        const openvpn::IP::Addr addr = r.addr + prng.randrange32(static_cast<std::uint32_t>(r.extent()));
+        const int incl_len = longest(incl, addr);
+        const bool expected = incl_len >= 0 && longest(excl, addr) <= incl_len;
+        ASSERT_EQ(tb->containsIP(addr), expected) << addr;
+    }
+}
+
 } // namespace unittests
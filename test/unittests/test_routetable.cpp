@@ -0,0 +1,202 @@
+#include "test_common.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <openvpn/addr/routetable.hpp>
+#include <openvpn/random/mtrandapi.hpp>
+
+using namespace openvpn;
+
+namespace {
+IP::Addr random_addr(RandomAPI &prng, const IP::Addr::Version ver)
+{
+    unsigned char bytes[16];
+    prng.rand_bytes(bytes, sizeof(bytes));
+    if (ver == IP::Addr::V4)
+        return IP::Addr::from_ipv4(IPv4::Addr::from_bytes(bytes));
+    return IP::Addr::from_ipv6(IPv6::Addr::from_byte_string(bytes));
+}
+
+// longest-prefix match by linear search
+int lpm(const std::vector<std::pair<IP::Route, int>> &routes, const IP::Addr &addr)
+{
+    int value = -1;
+    unsigned int len = 0;
+    for (const auto &r : routes)
+    {
+        if (r.first.contains(addr) && (value < 0 || r.first.prefix_len >= len))
+        {
+            value = r.second;
+            len = r.first.prefix_len;
+        }
+    }
+    return value;
+}
+} // namespace
+
+TEST(RouteTable, Lookup)
+{
+    IP::RouteTable<int> table;
+    IP::RouteTable<int>::Reader reader(table);
+    table.add(IP::Route("10.0.0.0/8"), 1);
+    table.add(IP::Route("10.8.0.0/16"), 2);
+    table.add(IP::Route("10.8.0.0/17"), 3);
+    table.add(IP::Route("10.8.1.0/24"), 4);
+    table.add(IP::Route("10.8.1.6/32"), 5);
+    table.add(IP::Route("10.8.1.128/25"), 6);
+    table.add(IP::Route("fd00::/64"), 7);
+    table.add(IP::Route("fd00::1000/116"), 8);
+
+    int value = 0;
+    ASSERT_FALSE(reader.lookup(IP::Addr("10.8.1.6"), value));
+    table.commit();
+
+    ASSERT_FALSE(reader.lookup(IP::Addr("11.0.0.1"), value));
+    ASSERT_FALSE(reader.lookup(IP::Addr("fd01::1"), value));
+    const std::pair<const char *, int> expected[] = {
+        {"10.255.0.1", 1},
+        {"10.8.200.1", 2},
+        {"10.8.0.1", 3},
+        {"10.8.1.5", 4},
+        {"10.8.1.6", 5},
+        {"10.8.1.7", 4},
+        {"10.8.1.255", 6},
+        {"fd00::1", 7},
+        {"fd00::1fff", 8},
+        {"fd00::2000", 7},
+    };
+    for (const auto &e : expected)
+    {
+        ASSERT_TRUE(reader.lookup(IP::Addr(e.first), value)) << e.first;
+        ASSERT_EQ(value, e.second) << e.first;
+    }
+
+    ASSERT_TRUE(table.remove(IP::Route("10.8.1.6/32")));
+    ASSERT_FALSE(table.remove(IP::Route("10.8.1.6/32")));
+    table.add(IP::Route("10.8.1.7/32"), 9);
+    ASSERT_EQ(table.remove_value(7), 1u);
+    table.commit();
+    ASSERT_TRUE(reader.lookup(IP::Addr("10.8.1.6"), value));
+    ASSERT_EQ(value, 4);
+    ASSERT_TRUE(reader.lookup(IP::Addr("10.8.1.7"), value));
+    ASSERT_EQ(value, 9);
+    ASSERT_FALSE(reader.lookup(IP::Addr("fd00::1"), value));
+    ASSERT_EQ(table.size(), 7u);
+
+    table.add(IP::Route("0.0.0.0/0"), 10);
+    table.commit();
+    ASSERT_TRUE(reader.lookup(IP::Addr("11.0.0.1"), value));
+    ASSERT_EQ(value, 10);
+
+    ASSERT_THROW(table.add(IP::Route("10.8.1.1/24"), 0), IP::Route::route_error);
+}
+
+TEST(RouteTable, LookupPacket)
+{
+    IP::RouteTable<int> table;
+    IP::RouteTable<int>::Reader reader(table);
+    table.add(IP::Route("10.8.0.2/32"), 1);
+    table.add(IP::Route("fd00::2/128"), 2);
+    table.commit();
+
+    int value = 0;
+    unsigned char pkt4[20] = {0x45};
+    const std::uint32_t daddr = IPv4::Addr::from_string("10.8.0.2").to_uint32_net();
+    std::memcpy(pkt4 + 16, &daddr, sizeof(daddr));
+    ASSERT_TRUE(reader.lookup_packet(pkt4, sizeof(pkt4), value));
+    ASSERT_EQ(value, 1);
+    ASSERT_FALSE(reader.lookup_packet(pkt4, sizeof(pkt4) - 1, value));
+
+    unsigned char pkt6[40] = {0x60};
+    pkt6[24] = 0xfd;
+    pkt6[39] = 2;
+    ASSERT_TRUE(reader.lookup_packet(pkt6, sizeof(pkt6), value));
+    ASSERT_EQ(value, 2);
+
+    pkt6[0] = 0x50;
+    ASSERT_FALSE(reader.lookup_packet(pkt6, sizeof(pkt6), value));
+    ASSERT_FALSE(reader.lookup_packet(pkt6, 0, value));
+}
+
+TEST(RouteTable, MatchesLinearSearch)
+{
+    MTRand prng(42);
+    for (const auto ver : {IP::Addr::V4, IP::Addr::V6})
+    {
+        const unsigned int bits = ver == IP::Addr::V4 ? 32 : 128;
+        IP::RouteTable<int> table;
+        IP::RouteTable<int>::Reader reader(table);
+        std::vector<std::pair<IP::Route, int>> routes;
+        for (int i = 0; i < 500; ++i)
+        {
+            // every other route is based on an earlier one, so that routes overlap
+            IP::Addr base = random_addr(prng, ver);
+            if (i % 2 && !routes.empty())
+                base = routes[prng.randrange32(static_cast<std::uint32_t>(routes.size()))].first.addr;
+            const unsigned int prefix_len = prng.randrange32(bits + 1);
+            IP::Route route(base & IP::Addr::netmask_from_prefix_len(ver, prefix_len), prefix_len);
+            table.add(route, i);
+            routes.erase(std::remove_if(routes.begin(), routes.end(), [&route](const auto &r)
+                                        { return r.first == route; }),
+                         routes.end());
+            routes.emplace_back(route, i);
+        }
+        table.commit();
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            // addresses near the routes, or random ones
+            IP::Addr addr = random_addr(prng, ver);
+            if (i % 2)
+                addr = routes[prng.randrange32(static_cast<std::uint32_t>(routes.size()))].first.addr + (i % 7);
+            int value = -1;
+            if (!reader.lookup(addr, value))
+                value = -1;
+            ASSERT_EQ(value, lpm(routes, addr)) << addr;
+        }
+    }
+}
+
+TEST(RouteTable, ConcurrentReaders)
+{
+    // commits map addresses to increasing values, readers
+    // must never see an older commit after a newer one
+    IP::RouteTable<int> table;
+    std::atomic<bool> stop{false};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&table, &stop, &errors, t]()
+                             {
+            IP::RouteTable<int>::Reader reader(table);
+            const IP::Addr addr(t % 2 ? "10.8.3.1" : "fd00::1");
+            int last = 0;
+            while (!stop.load())
+            {
+                int value = 0;
+                if (reader.lookup(addr, value))
+                {
+                    if (value < last)
+                        ++errors;
+                    last = value;
+                }
+            } });
+    }
+
+    for (int i = 1; i <= 1000; ++i)
+    {
+        table.clear();
+        table.add(IP::Route("10.8.0.0/16"), i);
+        table.add(IP::Route(i % 2 ? "10.8.3.1/32" : "10.8.3.0/24"), i);
+        table.add(IP::Route("fd00::/64"), i);
+        table.commit();
+    }
+    stop = true;
+    for (auto &thread : threads)
+        thread.join();
+    ASSERT_EQ(errors.load(), 0);
+}
@@ -0,0 +1,221 @@
+#include "test_common.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <openvpn/server/servshard.hpp>
+
+using namespace openvpn;
+
+namespace {
+BufferAllocated packet(const std::vector<unsigned char> &bytes)
+{
+    BufferAllocated buf(bytes.size(), 0);
+    buf.write(bytes.data(), bytes.size());
+    return buf;
+}
+
+// counts handed off packets, and checks that they arrive on the
+// shard's thread, in the order each sender pushed them
+struct CountShard : public ShardedServer::Shard
+{
+    CountShard(ShardedServer &server_arg, const unsigned int index_arg)
+        : server(server_arg),
+          index(index_arg)
+    {
+    }
+
+    void start() override
+    {
+    }
+
+    void stop() override
+    {
+        stopped = true;
+    }
+
+    std::string local_endpoint_info() const override
+    {
+        return "shard";
+    }
+
+    IP::Addr local_endpoint_addr() const override
+    {
+        return IP::Addr();
+    }
+
+    void handoff_recv(ShardedServer::Packet &pkt) override
+    {
+        if (thread_id == std::thread::id())
+            thread_id = std::this_thread::get_id();
+        if (std::this_thread::get_id() != thread_id || pkt.buf.size() != 2)
+            ++errors;
+        else
+        {
+            const unsigned int sender = pkt.buf[0];
+            if (pkt.buf[1] != static_cast<unsigned char>(next[sender]++))
+                ++errors;
+        }
+
+        const int peer_id = server.new_peer_id(index);
+        if (peer_id < 0 || peer_id % 4 != static_cast<int>(index))
+            ++errors;
+        server.release_peer_id(index, peer_id);
+        ++received;
+    }
+
+    ShardedServer &server;
+    const unsigned int index;
+    std::thread::id thread_id;
+    unsigned int next[4] = {};
+    std::atomic<int> received{0};
+    std::atomic<int> errors{0};
+    std::atomic<bool> stopped{false};
+};
+
+struct CountShardFactory : public ShardedServer::ShardFactory
+{
+    ShardedServer::Shard::Ptr new_shard(ShardedServer &server,
+                                        const unsigned int shard,
+                                        openvpn_io::io_context &io_context) override
+    {
+        shards.emplace_back(new CountShard(server, shard));
+        return shards.back();
+    }
+
+    std::vector<RCPtr<CountShard>> shards;
+};
+} // namespace
+
+TEST(MPMCQueue, PushPop)
+{
+    MPMCQueue<int> queue(3);
+    ASSERT_EQ(queue.capacity(), 4u);
+    int value = 0;
+    ASSERT_FALSE(queue.pop(value));
+    for (int lap = 0; lap < 3; ++lap)
+    {
+        for (int i = 0; i < 4; ++i)
+            ASSERT_TRUE(queue.push(lap * 10 + i));
+        ASSERT_FALSE(queue.push(99));
+        for (int i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.pop(value));
+            ASSERT_EQ(value, lap * 10 + i);
+        }
+        ASSERT_FALSE(queue.pop(value));
+    }
+}
+
+TEST(ShardedServer, Owner)
+{
+    CountShardFactory factory;
+    ShardedServer::Ptr server(new ShardedServer(4, factory));
+
+    // DATA_V2 by peer ID, unless undefined
+    ASSERT_EQ(server->owner(0, packet({9 << 3, 0, 0, 7, 0})), 3u);
+    ASSERT_EQ(server->owner(0, packet({(9 << 3) | 2, 0, 1, 0})), 0u);
+    ASSERT_EQ(server->owner(2, packet({9 << 3, 0xff, 0xff, 0xff})), 2u);
+    ASSERT_EQ(server->owner(2, packet({9 << 3, 0, 0})), 2u);
+
+    // DATA_V1 and unknown sessions stay local
+    ASSERT_EQ(server->owner(1, packet({6 << 3, 1, 2, 3})), 1u);
+    ASSERT_EQ(server->owner(1, packet({})), 1u);
+
+    // control packets by registered session ID
+    const std::vector<unsigned char> id = {1, 2, 3, 4, 5, 6, 7, 8};
+    BufferAllocated idbuf = packet(id);
+    const ProtoSessionID psid(idbuf);
+    std::vector<unsigned char> ctrl = {4 << 3};
+    ctrl.insert(ctrl.end(), id.begin(), id.end());
+    ASSERT_EQ(server->owner(1, packet(ctrl)), 1u);
+    server->register_psid(psid, 3);
+    ASSERT_EQ(server->owner(1, packet(ctrl)), 3u);
+    ctrl[0] = (7 << 3);
+    ASSERT_EQ(server->owner(1, packet(ctrl)), 3u);
+    ctrl.pop_back();
+    ASSERT_EQ(server->owner(1, packet(ctrl)), 1u);
+    server->unregister_psid(psid);
+    ctrl.push_back(8);
+    ASSERT_EQ(server->owner(1, packet(ctrl)), 1u);
+}
+
+TEST(ShardedServer, Handoff)
+{
+    const int n_packets = 20000;
+    CountShardFactory factory;
+    ShardedServer::Ptr server(new ShardedServer(4, factory, 64));
+    server->start();
+    ASSERT_EQ(server->size(), 4u);
+
+    // each sender hands off to every shard, retrying when its queue is full
+    std::vector<std::thread> senders;
+    for (unsigned int s = 0; s < 4; ++s)
+    {
+        senders.emplace_back([&server, s]()
+                             {
+            for (int i = 0; i < n_packets; ++i)
+            {
+                const unsigned int shard = (s + i) % 4;
+                ShardedServer::Packet pkt;
+                pkt.buf = packet({static_cast<unsigned char>(s), static_cast<unsigned char>(i / 4)});
+                while (!server->handoff(shard, std::move(pkt)))
+                    std::this_thread::yield();
+            } });
+    }
+    for (auto &sender : senders)
+        sender.join();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    for (const auto &shard : factory.shards)
+    {
+        while (shard->received < n_packets && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::uint64_t handoffs = 0;
+    for (unsigned int i = 0; i < 4; ++i)
+        handoffs += server->n_handoff(i);
+    ASSERT_EQ(handoffs, 4u * n_packets);
+    server->stop();
+
+    for (const auto &shard : factory.shards)
+    {
+        ASSERT_EQ(shard->received, n_packets);
+        ASSERT_EQ(shard->errors, 0);
+    }
+    ASSERT_EQ(server->size(), 0u);
+}
+
+TEST(ShardedServer, WorkerFailure)
+{
+    // a shard whose thread dies stops all shards, and handoffs
+    // to it are dropped instead of queued
+    CountShardFactory factory;
+    ShardedServer::Ptr server(new ShardedServer(3, factory, 64));
+    server->start();
+    ASSERT_FALSE(server->failed());
+    openvpn_io::post(server->workers[1]->io_context, []()
+                     { throw Exception("shard test failure"); });
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    for (const auto &w : server->workers)
+    {
+        while (w->running && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_FALSE(w->running);
+    }
+    ASSERT_TRUE(server->failed());
+    for (const auto &shard : factory.shards)
+        ASSERT_TRUE(shard->stopped);
+
+    ShardedServer::Packet pkt;
+    pkt.buf = packet({0, 0});
+    ASSERT_FALSE(server->handoff(1, std::move(pkt)));
+    ASSERT_EQ(server->n_dropped(1), 1u);
+    ASSERT_EQ(server->n_handoff(1), 0u);
+
+    server->stop();
+    ASSERT_EQ(server->size(), 0u);
+}
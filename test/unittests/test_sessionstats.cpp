@@ -0,0 +1,103 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+#include "test_common.h"
+
+#include <vector>
+
+#include <openvpn/log/sessionstats.hpp>
+
+using namespace openvpn;
+
+TEST(sessionstats, inc_stat)
+{
+    SessionStats::Ptr stats(new SessionStats());
+    stats->inc_stat(SessionStats::BYTES_IN, 100);
+    stats->inc_stat(SessionStats::BYTES_IN, 50);
+    stats->inc_stat(SessionStats::PACKETS_IN, 2);
+    stats->inc_stat(SessionStats::N_STATS, 1000); // ignored
+
+    EXPECT_EQ(stats->get_stat(SessionStats::BYTES_IN), 150u);
+    EXPECT_EQ(stats->get_stat(SessionStats::PACKETS_IN), 2u);
+    EXPECT_EQ(stats->get_stat(SessionStats::BYTES_OUT), 0u);
+    EXPECT_EQ(stats->get_stat(SessionStats::N_STATS), 0u);
+
+    const SessionStats::Snapshot snap = stats->snapshot();
+    for (size_t i = 0; i < SessionStats::N_STATS; ++i)
+        EXPECT_EQ(snap[i], stats->get_stat(i));
+}
+
+TEST(sessionstats, inc_callback_unbatched)
+{
+    SessionStats::Ptr stats(new SessionStats());
+    std::vector<count_t> calls;
+
+    auto cb = stats->set_inc_callback(SessionStats::TUN_BYTES_IN,
+                                      [&calls](const count_t value)
+                                      { calls.push_back(value); });
+
+    stats->inc_stat(SessionStats::TUN_BYTES_IN, 10);
+    stats->inc_stat(SessionStats::TUN_BYTES_OUT, 10); // no callback registered
+    stats->inc_stat(SessionStats::TUN_BYTES_IN, 20);
+    EXPECT_EQ(calls, (std::vector<count_t>{10, 20}));
+
+    // releasing the callback unregisters it
+    cb.reset();
+    stats->inc_stat(SessionStats::TUN_BYTES_IN, 30);
+    EXPECT_EQ(calls.size(), 2u);
+    EXPECT_EQ(stats->get_stat(SessionStats::TUN_BYTES_IN), 60u);
+}
+
+TEST(sessionstats, inc_callback_batched)
+{
+    SessionStats::Ptr stats(new SessionStats());
+    std::vector<count_t> calls;
+
+    auto cb = stats->set_inc_callback(SessionStats::TUN_BYTES_OUT,
+                                      [&calls](const count_t value)
+                                      { calls.push_back(value); },
+                                      100);
+
+    for (int i = 0; i < 5; ++i)
+        stats->inc_stat(SessionStats::TUN_BYTES_OUT, 40);
+
+    // delivered once 120 bytes had accumulated, 80 still pending
+    EXPECT_EQ(calls, (std::vector<count_t>{120}));
+
+    stats->flush_inc_callbacks();
+    EXPECT_EQ(calls, (std::vector<count_t>{120, 80}));
+
+    // nothing pending, so nothing to deliver
+    stats->flush_inc_callbacks();
+    EXPECT_EQ(calls.size(), 2u);
+    EXPECT_EQ(stats->get_stat(SessionStats::TUN_BYTES_OUT), 200u);
+}
+
+TEST(sessionstats, inc_callback_flush_reaches_threshold)
+{
+    // Like the "inactive" directive: both tun directions are batched
+    // at half the minimum, and together they moved exactly the minimum.
+    // What was delivered falls short, flushing the remainder doesn't.
+    const count_t minimum = 1000;
+    SessionStats::Ptr stats(new SessionStats());
+    count_t total = 0;
+    auto add = [&total](const count_t value)
+    { total += value; };
+    auto out_cb = stats->set_inc_callback(SessionStats::TUN_BYTES_OUT, add, minimum / 2);
+    auto in_cb = stats->set_inc_callback(SessionStats::TUN_BYTES_IN, add, minimum / 2);
+
+    stats->inc_stat(SessionStats::TUN_BYTES_OUT, minimum / 2 - 1);
+    stats->inc_stat(SessionStats::TUN_BYTES_IN, minimum / 2 + 1);
+    EXPECT_EQ(total, minimum / 2 + 1);
+
+    stats->flush_inc_callbacks();
+    EXPECT_EQ(total, minimum);
+}
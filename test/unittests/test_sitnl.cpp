@@ -275,6 +275,56 @@ TEST_F(SitnlTest, TestAddRoute6)
 	  } });
 }
 
+TEST_F(SitnlTest, TestRouteBatch4)
+{
+    // add address
+    auto broadcast = IPv4::Addr::from_string(addr4) | ~IPv4::Addr::netmask_from_prefix_len(ipv4_prefix_len);
+    ASSERT_EQ(SITNL::net_addr_add(dev, IPv4::Addr::from_string(addr4), static_cast<unsigned char>(ipv4_prefix_len), broadcast), 0);
+
+    // up interface
+    ASSERT_EQ(SITNL::net_iface_up(dev, true), 0);
+
+    // add more routes than fit into a single batch
+    const int n_routes = SITNL::RouteBatch::BATCH_MAX * 2 + 10;
+    const IP::Addr gw = IP::Addr::from_string(gw4);
+    auto net = [](const int i)
+    { return "10." + std::to_string(111 + i / 256) + "." + std::to_string(i % 256); };
+    SITNL::RouteBatch batch;
+    for (int i = 0; i < n_routes; ++i)
+        ASSERT_EQ(batch.route_add(IP::Route(net(i) + ".0/24"), gw, dev, 0, 0), 0);
+
+    // adding an existing route succeeds, as with net_route_add()
+    ASSERT_EQ(batch.route_add(IP::Route(net(0) + ".0/24"), gw, dev, 0, 0), 0);
+    ASSERT_EQ(batch.size(), static_cast<size_t>(n_routes + 1));
+    ASSERT_EQ(batch.commit(), 0);
+    ASSERT_EQ(batch.results().size(), static_cast<size_t>(n_routes + 1));
+    for (int i = 0; i <= n_routes; ++i)
+        ASSERT_EQ(batch.results()[i], 0);
+
+    std::string dst{net(n_routes - 1) + ".100"};
+
+    ip_route_get(dst, [this, &dst](std::vector<std::string> &v, const std::string &out, bool &called)
+                 {
+	if (v[0] == dst)
+	{
+	  called = true;
+	  v.resize(7);
+	  auto expected = std::vector<std::string>{dst, "via", gw4, "dev", dev, "src", addr4};
+	  ASSERT_EQ(v, expected) << out;
+	} });
+
+    // the socket is reused for further commits, and a failed
+    // request doesn't affect the other ones
+    for (int i = 0; i < n_routes; ++i)
+        ASSERT_EQ(batch.route_del(IP::Route(net(i) + ".0/24"), gw, dev, 0, 0), 0);
+    ASSERT_EQ(batch.route_del(IP::Route(net(n_routes) + ".0/24"), gw, dev, 0, 0), 0);
+    ASSERT_EQ(batch.commit(), -ESRCH);
+    ASSERT_EQ(batch.size(), 0u);
+    for (int i = 0; i < n_routes; ++i)
+        ASSERT_EQ(batch.results()[i], 0);
+    ASSERT_EQ(batch.results()[n_routes], -ESRCH);
+}
+
 TEST_F(SitnlTest, TestBestGw4)
 {
     // add address
@@ -0,0 +1,282 @@
+#include "test_common.h"
+
+#include <functional>
+
+#include <openvpn/common/bigmutex.hpp>
+#include <openvpn/transport/udplink.hpp>
+
+#ifdef OPENVPN_UDPLINK_BATCH
+
+using namespace openvpn;
+
+namespace {
+
+// SessionStats that also counts errors
+struct Stats : public SessionStats
+{
+    typedef RCPtr<Stats> Ptr;
+
+    void error(const size_t type, const std::string *text = nullptr) override
+    {
+        ++errors[type];
+    }
+
+    count_t errors[Error::N_ERRORS] = {};
+};
+
+struct Peer : public RC<thread_unsafe_refcount>
+{
+    typedef RCPtr<Peer> Ptr;
+    typedef UDPTransport::UDPLink<Peer *> Link;
+
+    Peer(openvpn_io::io_context &io_context, const Frame::Context &frame_context)
+        : socket(io_context),
+          stats(new Stats())
+    {
+        socket.open(openvpn_io::ip::udp::v4());
+        socket.bind(UDPTransport::AsioEndpoint(openvpn_io::ip::address_v4::loopback(), 0));
+        link.reset(new Link(this, socket, frame_context, stats));
+    }
+
+    void udp_read_handler(UDPTransport::PacketFrom::SPtr &pf)
+    {
+        if (in_batch)
+            ++batched;
+        received.emplace_back(pf->buf.c_data(), pf->buf.c_data() + pf->buf.size());
+        from = pf->sender_endpoint;
+        if (on_read)
+            on_read(*pf);
+    }
+
+    void udp_read_batch_begin()
+    {
+        EXPECT_FALSE(in_batch);
+        in_batch = true;
+        ++batches;
+    }
+
+    void udp_read_batch_end()
+    {
+        EXPECT_TRUE(in_batch);
+        in_batch = false;
+    }
+
+    openvpn_io::ip::udp::socket socket;
+    Stats::Ptr stats;
+    Link::Ptr link;
+    std::vector<std::vector<std::uint8_t>> received;
+    UDPTransport::AsioEndpoint from;
+    std::function<void(UDPTransport::PacketFrom &)> on_read;
+    bool in_batch = false;
+    size_t batches = 0;
+    size_t batched = 0;
+};
+
+std::vector<std::uint8_t> payload(const int i, const size_t size)
+{
+    return std::vector<std::uint8_t>(size, std::uint8_t(i & 0xFF));
+}
+
+// a sends n packets of payload(i, size(i)) to b, which echoes them back,
+// until all have returned or the timeout expires.  a sends window packets
+// at a time, and the next ones once they have returned, so that bursts
+// don't overrun the default socket buffers.
+void echo_test(Peer &a, Peer &b, const int n, const int window, const std::function<size_t(int)> &size)
+{
+    openvpn_io::io_context &io_context = static_cast<openvpn_io::io_context &>(a.socket.get_executor().context());
+    const UDPTransport::AsioEndpoint a_ep = a.socket.local_endpoint();
+    const UDPTransport::AsioEndpoint b_ep = b.socket.local_endpoint();
+
+    b.on_read = [&](UDPTransport::PacketFrom &pf)
+    { b.link->send(pf.buf, &pf.sender_endpoint); };
+    openvpn_io::steady_timer timeout(io_context, std::chrono::seconds(5));
+
+    // as the transports do, close the sockets to cancel the pending reads
+    auto stop = [&]()
+    {
+        a.link->stop();
+        b.link->stop();
+        a.socket.close();
+        b.socket.close();
+        timeout.cancel();
+    };
+    int sent = 0;
+    auto send_window = [&]()
+    {
+        for (const int end = std::min(sent + window, n); sent < end; ++sent)
+        {
+            const std::vector<std::uint8_t> data = payload(sent, size(sent));
+            const Buffer buf(const_cast<std::uint8_t *>(data.data()), data.size(), true);
+            EXPECT_EQ(a.link->send(buf, &b_ep), 0);
+        }
+    };
+    a.on_read = [&](UDPTransport::PacketFrom &)
+    {
+        if (a.received.size() == size_t(n))
+            stop();
+        else if (a.received.size() == size_t(sent))
+            send_window();
+    };
+    timeout.async_wait([&](const openvpn_io::error_code &error)
+                       {
+        if (!error)
+            stop(); });
+
+    send_window();
+
+    io_context.run();
+
+    ASSERT_EQ(a.received.size(), size_t(n));
+    ASSERT_EQ(b.received.size(), size_t(n));
+    EXPECT_EQ(a.from, b_ep);
+    EXPECT_EQ(b.from, a_ep);
+    for (int i = 0; i < n; ++i)
+    {
+        EXPECT_EQ(b.received[i], payload(i, size(i))) << i;
+        EXPECT_EQ(a.received[i], payload(i, size(i))) << i;
+    }
+    EXPECT_EQ(a.stats->get_stat(SessionStats::PACKETS_OUT), count_t(n));
+    EXPECT_EQ(b.stats->get_stat(SessionStats::PACKETS_IN), count_t(n));
+    EXPECT_EQ(b.stats->get_stat(SessionStats::PACKETS_OUT), count_t(n));
+    EXPECT_EQ(a.stats->get_stat(SessionStats::PACKETS_IN), count_t(n));
+}
+
+} // namespace
+
+TEST(udplink, batch_loopback)
+{
+    // several times the batch size, so that both recvmmsg() and
+    // sendmmsg() run over more than one batch
+    openvpn_io::io_context io_context(1);
+    const Frame::Context fc(128, 1500, 128, 0, 16, 0);
+    Peer::Ptr a(new Peer(io_context, fc));
+    Peer::Ptr b(new Peer(io_context, fc));
+    a->link->start_batch(8);
+    b->link->start_batch(8);
+    echo_test(*a, *b, 100, 100, [](const int i)
+              { return size_t(1 + i % 64); });
+}
+
+TEST(udplink, batch_read_bracketed)
+{
+    // every packet of a recvmmsg() read is delivered between
+    // udp_read_batch_begin() and udp_read_batch_end()
+    openvpn_io::io_context io_context(1);
+    const Frame::Context fc(128, 1500, 128, 0, 16, 0);
+    Peer::Ptr a(new Peer(io_context, fc));
+    Peer::Ptr b(new Peer(io_context, fc));
+    a->link->start_batch(8);
+    b->link->start_batch(8);
+    echo_test(*a, *b, 50, 50, [](const int)
+              { return size_t(100); });
+    EXPECT_EQ(b->batched, size_t(50));
+    EXPECT_GT(b->batches, 0u);
+    EXPECT_LE(b->batches, size_t(50));
+    EXPECT_FALSE(b->in_batch);
+}
+
+TEST(udplink, batch_stop_flushes_queued)
+{
+    openvpn_io::io_context io_context(1);
+    const Frame::Context fc(128, 1500, 128, 0, 16, 0);
+    Peer::Ptr a(new Peer(io_context, fc));
+    openvpn_io::ip::udp::socket b(io_context);
+    b.open(openvpn_io::ip::udp::v4());
+    b.bind(UDPTransport::AsioEndpoint(openvpn_io::ip::address_v4::loopback(), 0));
+    const UDPTransport::AsioEndpoint b_ep = b.local_endpoint();
+
+    // fewer packets than the batch size stay queued until the next
+    // event loop turn, which never comes
+    a->link->start_batch(16);
+    const int n = 5;
+    for (int i = 0; i < n; ++i)
+    {
+        const std::vector<std::uint8_t> data = payload(i, 100);
+        const Buffer buf(const_cast<std::uint8_t *>(data.data()), data.size(), true);
+        ASSERT_EQ(a->link->send(buf, &b_ep), 0);
+    }
+    EXPECT_EQ(a->stats->get_stat(SessionStats::PACKETS_OUT), 0u);
+
+    a->link->stop();
+    EXPECT_EQ(a->stats->get_stat(SessionStats::PACKETS_OUT), count_t(n));
+    const std::uint8_t byte = 0;
+    EXPECT_EQ(a->link->send(Buffer(const_cast<std::uint8_t *>(&byte), 1, true), &b_ep), UDPTransport::SEND_SOCKET_HALTED);
+
+    b.non_blocking(true);
+    for (int i = 0; i < n; ++i)
+    {
+        std::uint8_t data[200];
+        openvpn_io::error_code error;
+        const size_t len = b.receive(openvpn_io::buffer(data), 0, error);
+        ASSERT_FALSE(error) << i << ": " << error.message();
+        EXPECT_EQ(std::vector<std::uint8_t>(data, data + len), payload(i, 100)) << i;
+    }
+
+    // the flush posted by send() finds nothing left to send
+    io_context.poll();
+    std::uint8_t data[200];
+    openvpn_io::error_code error;
+    b.receive(openvpn_io::buffer(data), 0, error);
+    EXPECT_EQ(error, openvpn_io::error::would_block);
+}
+
+TEST(udplink, gro_split)
+{
+    openvpn_io::io_context io_context(1);
+    const Frame::Context fc(128, 1500, 128, 0, 16, 0);
+    Peer::Ptr a(new Peer(io_context, fc));
+    a->link->start_batch(4);
+
+    // a coalesced read of three full segments and a short one
+    UDPTransport::PacketFrom from;
+    from.buf.reset(4 * 100, 0);
+    for (int i = 0; i < 4; ++i)
+    {
+        const std::vector<std::uint8_t> seg = payload(i, i < 3 ? 100 : 37);
+        from.buf.write(seg.data(), seg.size());
+    }
+    from.sender_endpoint = UDPTransport::AsioEndpoint(openvpn_io::ip::make_address("127.0.0.2"), 1194);
+
+    for (int round = 0; round < 2; ++round)
+    {
+        a->received.clear();
+        a->link->gro_split(from, 100);
+        ASSERT_EQ(a->received.size(), 4u);
+        for (int i = 0; i < 4; ++i)
+            EXPECT_EQ(a->received[i], payload(i, i < 3 ? 100 : 37)) << i;
+        EXPECT_EQ(a->from, from.sender_endpoint);
+
+        // the segment buffers are recycled
+        EXPECT_EQ(a->link->batch->rx_spare.size(), 1u);
+    }
+
+    // segments that don't fit a frame are dropped
+    a->received.clear();
+    from.buf.reset(4000, 0);
+    from.buf.write(payload(0, 4000).data(), 4000);
+    a->link->gro_split(from, 2000);
+    EXPECT_TRUE(a->received.empty());
+    EXPECT_EQ(a->stats->errors[Error::NETWORK_RECV_ERROR], 1u);
+
+    a->link->stop();
+}
+
+TEST(udplink, offload_loopback)
+{
+    // runs of equal-sized packets, each ended by a shorter one, so that
+    // with GSO a message may carry a short last segment, and with GRO
+    // reads are coalesced and split by gro_split()
+    openvpn_io::io_context io_context(1);
+    const Frame::Context fc(128, 1500, 128, 0, 16, 0);
+    Peer::Ptr a(new Peer(io_context, fc));
+    Peer::Ptr b(new Peer(io_context, fc));
+    a->link->start_batch(64, true);
+    b->link->start_batch(64, true);
+    if (!a->link->batch->gso || !a->link->batch->gro)
+        std::cout << "UDP GSO=" << a->link->batch->gso << " GRO=" << a->link->batch->gro
+                  << ", testing the fallback" << std::endl;
+    echo_test(*a, *b, 500, 64, [](const int i)
+              { return i % 20 == 19 ? size_t(1 + i % 300) : size_t(1000); });
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "test_common.h"
+
+#include <functional>
+
+#include <openvpn/common/bigmutex.hpp>
+#include <openvpn/transport/udplink.hpp>
+
+#ifdef OPENVPN_IO_URING
+
+using namespace openvpn;
+
+namespace {
+
+struct Echo : public RC<thread_unsafe_refcount>
+{
+    typedef RCPtr<Echo> Ptr;
+    typedef UDPTransport::UDPLink<Echo *> Link;
+
+    Echo(openvpn_io::io_context &io_context, const Frame::Context &frame_context)
+        : socket(io_context)
+    {
+        socket.open(openvpn_io::ip::udp::v4());
+        socket.bind(UDPTransport::AsioEndpoint(openvpn_io::ip::address_v4::loopback(), 0));
+        link.reset(new Link(this, socket, frame_context, SessionStats::Ptr(new SessionStats())));
+    }
+
+    void udp_read_handler(UDPTransport::PacketFrom::SPtr &pf)
+    {
+        received.emplace_back(pf->buf.c_data(), pf->buf.c_data() + pf->buf.size());
+        from = pf->sender_endpoint;
+        if (on_read)
+            on_read(*pf);
+    }
+
+    openvpn_io::ip::udp::socket socket;
+    Link::Ptr link;
+    std::vector<std::vector<std::uint8_t>> received;
+    UDPTransport::AsioEndpoint from;
+    std::function<void(UDPTransport::PacketFrom &)> on_read;
+};
+
+} // namespace
+
+TEST(uring, udplink_loopback)
+{
+    openvpn_io::io_context io_context(1);
+    if (!IOUring::Service::get(io_context))
+        GTEST_SKIP() << "io_uring not available";
+
+    const Frame::Context fc(128, 1500, 128, 0, 16, 0);
+    Echo::Ptr a(new Echo(io_context, fc));
+    Echo::Ptr b(new Echo(io_context, fc));
+    ASSERT_TRUE(a->link->start_uring(2));
+    ASSERT_TRUE(b->link->start_uring(2));
+
+    const int n = 200;
+    const UDPTransport::AsioEndpoint a_ep = a->socket.local_endpoint();
+    const UDPTransport::AsioEndpoint b_ep = b->socket.local_endpoint();
+
+    // b echoes every packet back to a, a stops both links once all have returned
+    b->on_read = [&](UDPTransport::PacketFrom &pf)
+    { b->link->send(pf.buf, &pf.sender_endpoint); };
+    openvpn_io::steady_timer timeout(io_context, std::chrono::seconds(5));
+    auto stop = [&]()
+    {
+        a->link->stop();
+        b->link->stop();
+        timeout.cancel();
+    };
+    a->on_read = [&](UDPTransport::PacketFrom &)
+    {
+        if (a->received.size() == n)
+            stop();
+    };
+    timeout.async_wait([&](const openvpn_io::error_code &error)
+                       {
+        if (!error)
+            stop(); });
+
+    for (int i = 0; i < n; ++i)
+    {
+        std::uint8_t data[64];
+        std::memset(data, i & 0xFF, sizeof(data));
+        Buffer buf(data, 1 + i % sizeof(data), true);
+        ASSERT_EQ(a->link->send(buf, &b_ep), 0);
+    }
+
+    io_context.run();
+
+    ASSERT_EQ(a->received.size(), n);
+    ASSERT_EQ(b->received.size(), n);
+    EXPECT_EQ(a->from, b_ep);
+    EXPECT_EQ(b->from, a_ep);
+    for (int i = 0; i < n; ++i)
+    {
+        const std::vector<std::uint8_t> expect(1 + i % 64, std::uint8_t(i & 0xFF));
+        EXPECT_EQ(b->received[i], expect);
+    }
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include "test_common.h"
+
+#include <openvpn/tun/linux/vnethdr.hpp>
+
+using namespace openvpn;
+
+namespace {
+
+// verify an L4 checksum by summing the pseudo header and segment
+std::uint16_t l4_verify(const std::uint8_t *pkt, const size_t size, const size_t l4_off, const std::uint8_t proto)
+{
+    const size_t l4_len = size - l4_off;
+    std::uint32_t sum;
+    if (IPCommon::version(pkt[0]) == IPCommon::IPv4)
+    {
+        const std::uint8_t pseudo[4] = {0, proto, std::uint8_t(l4_len >> 8), std::uint8_t(l4_len)};
+        sum = IPChecksum::compute(pkt + 12, 8);
+        sum = IPChecksum::partial(pseudo, sizeof(pseudo), sum);
+    }
+    else
+    {
+        const std::uint8_t pseudo[8] = {0, 0, std::uint8_t(l4_len >> 8), std::uint8_t(l4_len), 0, 0, 0, proto};
+        sum = IPChecksum::compute(pkt + 8, 32);
+        sum = IPChecksum::partial(pseudo, sizeof(pseudo), sum);
+    }
+    return IPChecksum::cfold(IPChecksum::partial(pkt + l4_off, l4_len, sum));
+}
+
+// build an IPv4/TCP super-packet with a payload of the given size
+BufferAllocated make_tcp4(const size_t payload, const std::uint8_t flags)
+{
+    BufferAllocated buf(sizeof(IPv4Header) + sizeof(TCPHeader) + payload, 0);
+    IPv4Header *ip = (IPv4Header *)buf.write_alloc(sizeof(IPv4Header));
+    std::memset(ip, 0, sizeof(IPv4Header));
+    ip->version_len = IPv4Header::ver_len(4, sizeof(IPv4Header));
+    ip->tot_len = htons(static_cast<std::uint16_t>(buf.capacity()));
+    ip->id = htons(100);
+    ip->ttl = 64;
+    ip->protocol = IPCommon::TCP;
+    ip->saddr = htonl(0x0a000001);
+    ip->daddr = htonl(0x0a000002);
+
+    TCPHeader *tcp = (TCPHeader *)buf.write_alloc(sizeof(TCPHeader));
+    std::memset(tcp, 0, sizeof(TCPHeader));
+    tcp->source = htons(1234);
+    tcp->dest = htons(80);
+    tcp->seq = htonl(0xFFFFFF00); // wraps while segmenting
+    tcp->doff_res = (sizeof(TCPHeader) / 4) << 4;
+    tcp->flags = flags;
+
+    std::uint8_t *data = buf.write_alloc(payload);
+    for (size_t i = 0; i < payload; ++i)
+        data[i] = static_cast<std::uint8_t>(i);
+    return buf;
+}
+
+} // namespace
+
+TEST(vnethdr, tcp4_segment)
+{
+    const size_t payload = 3500;
+    const size_t mss = 1000;
+    const size_t hlen = sizeof(IPv4Header) + sizeof(TCPHeader);
+    BufferAllocated pkt = make_tcp4(payload, 0x80 | 0x08 | 0x01 | 0x10); // CWR|PSH|FIN|ACK
+
+    VirtioNet::Header vh = {};
+    vh.flags = VirtioNet::Header::F_NEEDS_CSUM;
+    vh.gso_type = VirtioNet::Header::GSO_TCPV4;
+    vh.hdr_len = hlen;
+    vh.gso_size = mss;
+    vh.csum_start = sizeof(IPv4Header);
+    vh.csum_offset = 16;
+
+    VirtioNet::Segmenter seg;
+    ASSERT_TRUE(seg.init(vh, pkt.data(), pkt.size()));
+
+    size_t n = 0;
+    size_t offset = 0;
+    while (!seg.done())
+    {
+        BufferAllocated out(2048, 0);
+        ASSERT_TRUE(seg.next(out));
+        const size_t expect = hlen + std::min(mss, payload - offset);
+        ASSERT_EQ(out.size(), expect);
+
+        const IPv4Header *ip = (const IPv4Header *)out.c_data();
+        EXPECT_EQ(ntohs(ip->tot_len), expect);
+        EXPECT_EQ(ntohs(ip->id), 100 + n);
+        EXPECT_EQ(IPChecksum::checksum(ip, sizeof(IPv4Header)), 0);
+
+        const TCPHeader *tcp = (const TCPHeader *)(out.c_data() + sizeof(IPv4Header));
+        EXPECT_EQ(ntohl(tcp->seq), std::uint32_t(0xFFFFFF00 + offset));
+        const bool last = offset + mss >= payload;
+        EXPECT_EQ((tcp->flags & 0x09) != 0, last);
+        EXPECT_EQ((tcp->flags & 0x80) != 0, n == 0);
+        EXPECT_TRUE(tcp->flags & 0x10);
+        EXPECT_EQ(l4_verify(out.c_data(), out.size(), sizeof(IPv4Header), IPCommon::TCP), 0);
+
+        for (size_t i = hlen; i < out.size(); ++i)
+            ASSERT_EQ(out[i], static_cast<std::uint8_t>(offset + i - hlen));
+
+        offset += out.size() - hlen;
+        ++n;
+    }
+    EXPECT_EQ(n, 4);
+    EXPECT_EQ(offset, payload);
+}
+
+TEST(vnethdr, udp6_segment)
+{
+    const size_t payload = 2500;
+    const size_t seg_size = 1200;
+    const size_t l4_off = sizeof(IPv6Header);
+    BufferAllocated pkt(l4_off + sizeof(UDPHeader) + payload, 0);
+
+    IPv6Header *ip = (IPv6Header *)pkt.write_alloc(sizeof(IPv6Header));
+    std::memset(ip, 0, sizeof(IPv6Header));
+    ip->version_prio = 6 << 4;
+    ip->nexthdr = IPCommon::UDP;
+    ip->hop_limit = 64;
+    ip->saddr.s6_addr[15] = 1;
+    ip->daddr.s6_addr[15] = 2;
+    UDPHeader *udp = (UDPHeader *)pkt.write_alloc(sizeof(UDPHeader));
+    std::memset(udp, 0, sizeof(UDPHeader));
+    udp->source = htons(5000);
+    udp->dest = htons(53);
+    std::memset(pkt.write_alloc(payload), 0xAB, payload);
+
+    VirtioNet::Header vh = {};
+    vh.flags = VirtioNet::Header::F_NEEDS_CSUM;
+    vh.gso_type = VirtioNet::Header::GSO_UDP_L4;
+    vh.gso_size = seg_size;
+    vh.csum_start = l4_off;
+    vh.csum_offset = 6;
+
+    VirtioNet::Segmenter seg;
+    ASSERT_TRUE(seg.init(vh, pkt.data(), pkt.size()));
+
+    std::vector<size_t> sizes;
+    while (!seg.done())
+    {
+        BufferAllocated out(2048, 0);
+        ASSERT_TRUE(seg.next(out));
+        const IPv6Header *oip = (const IPv6Header *)out.c_data();
+        const UDPHeader *oudp = (const UDPHeader *)(out.c_data() + l4_off);
+        EXPECT_EQ(ntohs(oip->payload_len), out.size() - l4_off);
+        EXPECT_EQ(ntohs(oudp->len), out.size() - l4_off);
+        EXPECT_EQ(l4_verify(out.c_data(), out.size(), l4_off, IPCommon::UDP), 0);
+        sizes.push_back(out.size() - l4_off - sizeof(UDPHeader));
+    }
+    EXPECT_EQ(sizes, std::vector<size_t>({1200, 1200, 100}));
+}
+
+TEST(vnethdr, passthrough_csum)
+{
+    BufferAllocated pkt = make_tcp4(100, 0x10);
+    const size_t l4_off = sizeof(IPv4Header);
+
+    // the kernel leaves the pseudo-header sum in the checksum field
+    const size_t l4_len = pkt.size() - l4_off;
+    const std::uint8_t pseudo[4] = {0, IPCommon::TCP, 0, std::uint8_t(l4_len)};
+    TCPHeader *tcp = (TCPHeader *)(pkt.data() + l4_off);
+    tcp->check = IPChecksum::fold(IPChecksum::partial(pseudo, sizeof(pseudo), IPChecksum::compute(pkt.c_data() + 12, 8)));
+
+    VirtioNet::Header vh = {};
+    vh.flags = VirtioNet::Header::F_NEEDS_CSUM;
+    vh.csum_start = l4_off;
+    vh.csum_offset = 16;
+
+    VirtioNet::Segmenter seg;
+    ASSERT_TRUE(seg.init(vh, pkt.data(), pkt.size()));
+    BufferAllocated out(2048, 0);
+    ASSERT_TRUE(seg.next(out));
+    EXPECT_TRUE(seg.done());
+    ASSERT_EQ(out.size(), pkt.size());
+    EXPECT_EQ(l4_verify(out.c_data(), out.size(), l4_off, IPCommon::TCP), 0);
+
+    // no room for the segment
+    ASSERT_TRUE(seg.init(vh, pkt.data(), pkt.size()));
+    BufferAllocated small(64, 0);
+    EXPECT_FALSE(seg.next(small));
+}
+
+TEST(vnethdr, malformed)
+{
+    BufferAllocated pkt = make_tcp4(100, 0x10);
+    VirtioNet::Header vh = {};
+    VirtioNet::Segmenter seg;
+
+    vh.gso_type = VirtioNet::Header::GSO_TCPV4;
+    vh.csum_start = sizeof(IPv4Header);
+    EXPECT_FALSE(seg.init(vh, pkt.data(), pkt.size())); // zero gso_size
+
+    vh.gso_size = 1000;
+    vh.csum_start = 24;
+    EXPECT_FALSE(seg.init(vh, pkt.data(), pkt.size())); // L4 offset doesn't match IHL
+
+    vh.csum_start = sizeof(IPv4Header);
+    vh.gso_type = VirtioNet::Header::GSO_UDP_L4;
+    EXPECT_FALSE(seg.init(vh, pkt.data(), pkt.size())); // protocol mismatch
+
+    vh.gso_type = VirtioNet::Header::GSO_UDP;
+    EXPECT_FALSE(seg.init(vh, pkt.data(), pkt.size())); // UFO not supported
+}
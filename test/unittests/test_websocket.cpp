@@ -0,0 +1,83 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2024- OpenVPN Inc.
+//
+//    SPDX-License-Identifier: MPL-2.0 OR AGPL-3.0-only WITH openvpn3-openssl-exception
+//
+
+#include "test_common.h"
+
+#include <vector>
+
+#include <openvpn/ssl/sslchoose.hpp>
+#include <openvpn/random/mtrandapi.hpp>
+#include <openvpn/ws/websocket.hpp>
+
+using namespace openvpn;
+
+TEST(websocket, xor_data_matches_bytewise)
+{
+    MTRand rng;
+    const std::uint32_t mask = rng.rand_get<std::uint32_t>();
+    const std::uint8_t *mask8 = reinterpret_cast<const std::uint8_t *>(&mask);
+    const WebSocket::Protocol::MaskingKey mk(mask);
+
+    std::vector<std::uint8_t> orig(256 + 16);
+    rng.rand_bytes(orig.data(), orig.size());
+
+    for (size_t align = 0; align < 8; ++align)
+        for (size_t pos = 0; pos < 4; ++pos)
+            for (size_t len = 0; len <= 256; ++len)
+            {
+                std::vector<std::uint8_t> data(orig);
+                mk.xor_data(data.data() + align, len, pos);
+                for (size_t i = 0; i < data.size(); ++i)
+                {
+                    const bool inside = i >= align && i < align + len;
+                    const std::uint8_t expect = inside ? orig[i] ^ mask8[(pos + i - align) & 3] : orig[i];
+                    ASSERT_EQ(data[i], expect) << "align=" << align << " pos=" << pos << " len=" << len << " i=" << i;
+                }
+            }
+}
+
+// a masked client frame delivered to the server in arbitrary pieces
+TEST(websocket, receiver_fragmented)
+{
+    StrongRandomAPI::Ptr rng(new SSLLib::RandomAPI());
+    MTRand prng;
+    const WebSocket::Sender sender(rng);
+
+    for (const size_t payload_size : {0, 1, 7, 125, 126, 1000, 70000})
+    {
+        std::string payload(payload_size, '\0');
+        for (auto &c : payload)
+            c = static_cast<char>('a' + prng.randrange(26));
+
+        BufferAllocated frame(payload_size + WebSocket::Protocol::MAX_HEAD * 2, 0);
+        frame.init_headroom(WebSocket::Protocol::MAX_HEAD);
+        buf_append_string(frame, payload);
+        sender.frame(frame, WebSocket::Status(WebSocket::Protocol::Text));
+
+        for (const size_t chunk : {1, 3, 64, 1000000})
+        {
+            WebSocket::Receiver recv(false);
+            size_t off = 0;
+            bool complete = false;
+            do
+            {
+                const size_t n = std::min(chunk, frame.size() - off);
+                recv.add_buf(BufferAllocated(frame.c_data() + off, n, 0));
+                off += n;
+                complete = recv.complete();
+            } while (!complete && off < frame.size());
+
+            ASSERT_TRUE(complete) << "size=" << payload_size << " chunk=" << chunk;
+            EXPECT_EQ(recv.status().opcode(), WebSocket::Protocol::Text);
+            EXPECT_EQ(buf_to_string(recv.buf_unframed()), payload) << "size=" << payload_size << " chunk=" << chunk;
+        }
+    }
+}